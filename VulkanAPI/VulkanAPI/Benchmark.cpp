@@ -0,0 +1,343 @@
+#include "Benchmark.h"
+#include<fstream>
+#include<iomanip>
+#include<cmath>
+#include<random>
+
+Benchmark::Benchmark(VulkanRender* newRenderer, GLFWwindow* newWindow, BenchmarkOptions newOptions)
+{
+	renderer = newRenderer;
+	window = newWindow;
+	options = newOptions;
+}
+
+const std::vector<BenchmarkScene>& Benchmark::getScenes()
+{
+	static const std::vector<BenchmarkScene> scenes = {
+		{ "chopper", { "Models/chopper.obj" } },
+		{ "tree", { "Models/Tree.obj" } },
+		{ "mixed", { "Models/chopper.obj", "Models/Tree.obj" } },
+	};
+	return scenes;
+}
+
+SampleSummary Benchmark::summarize(const std::vector<double>& samples)
+{
+	SampleSummary summary;
+	summary.count = samples.size();
+	if (samples.empty()) return summary;
+
+	double total = 0.0;
+	for (double sample : samples)
+	{
+		total += sample;
+		summary.max = std::max(summary.max, sample);
+	}
+	summary.mean = total / samples.size();
+	summary.p50 = percentile(samples, 0.50);
+	summary.p95 = percentile(samples, 0.95);
+	summary.p99 = percentile(samples, 0.99);
+
+	return summary;
+}
+
+int Benchmark::run()
+{
+	const BenchmarkScene* scene = nullptr;
+	for (const auto& candidate : getScenes())
+	{
+		if (candidate.name == options.scene)
+		{
+			scene = &candidate;
+		}
+	}
+	if (scene == nullptr)
+	{
+		printf("ERROR: Unknown benchmark scene \"%s\" \n", options.scene.c_str());
+		return EXIT_FAILURE;
+	}
+
+	if (run(*scene) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!options.traceFile.empty())
+	{
+		renderer->writeTrace(options.traceFile, firstMeasuredFrame, lastMeasuredFrame);
+	}
+
+	if (!writeResults(options.outputFile, renderer->getDeviceName(), options, { result }))
+	{
+		return EXIT_FAILURE;
+	}
+
+	printf("Benchmark (%s, %s textures) | startup %.1f ms, pipelines %.1f ms | cpu frame: mean %.3f ms, p99 %.3f ms | gpu frame: mean %.3f ms, p99 %.3f ms | written to %s\n",
+		result.backend.c_str(), result.textureBinding.c_str(), result.startupMs, result.pipelineMs, result.cpuFrame.mean, result.cpuFrame.p99, result.gpuFrame.mean,
+		result.gpuFrame.p99, options.outputFile.c_str());
+	return EXIT_SUCCESS;
+}
+
+int Benchmark::run(const BenchmarkScene& scene)
+{
+	try
+	{
+		int64_t loadStart = CpuProfiler::now();
+		loadScene(scene);
+		result.loadMs = (CpuProfiler::now() - loadStart) / 1000000.0;
+
+		printf("Benchmark \"%s\": %u warmup + %u measured frames, timestep %.4f s\n",
+			scene.name.c_str(), options.warmupFrames, options.measuredFrames, options.timestep);
+
+		uint32_t totalFrames = options.warmupFrames + options.measuredFrames;
+		firstMeasuredFrame = renderer->getFrameNumber() + options.warmupFrames;
+		lastMeasuredFrame = firstMeasuredFrame + options.measuredFrames - 1;
+
+		for (uint32_t i = 0; i < totalFrames; i++)
+		{
+			//Headless runs have no window to poll or close
+			if (window != nullptr)
+			{
+				if (glfwWindowShouldClose(window)) break;
+				glfwPollEvents();
+			}
+
+			int64_t frameStart = CpuProfiler::now();
+			updateScene(scene, i);
+			renderer->draw();
+			double frameMs = (CpuProfiler::now() - frameStart) / 1000000.0;
+
+			if (i >= options.warmupFrames)
+			{
+				const FrameWaitTimes& waitTimes = renderer->getLastWaitTimes();
+				cpuFrameMs.push_back(frameMs);
+				cpuSubmitMs.push_back(waitTimes.submitMs);
+				fenceWaitMs.push_back(waitTimes.fenceWaitMs);
+				acquireMs.push_back(waitTimes.acquireMs);
+				presentMs.push_back(waitTimes.presentMs);
+			}
+
+			//GPU times arrive a few frames late, take them before the profiler history drops them
+			collectGpuTimes();
+		}
+
+		renderer->flushFrames();
+		collectGpuTimes();
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("ERROR: %s \n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (cpuFrameMs.size() < options.measuredFrames)
+	{
+		printf("ERROR: Benchmark interrupted after %zu measured frames \n", cpuFrameMs.size());
+		return EXIT_FAILURE;
+	}
+
+	result.scene = scene.name;
+	result.backend = getRenderBackendName(renderer->getBackend());
+	result.textureBinding = getTextureBindingName(renderer->getTextureBinding());
+	result.startupMs = renderer->getStartupTimes().initMs;
+	result.pipelineMs = renderer->getStartupTimes().pipelineMs;
+	result.objectCount = static_cast<uint32_t>(objectPlacement.size());
+	result.descriptorPools = renderer->getDescriptorPoolCount();
+	result.descriptorSetWrites = renderer->getDescriptorSetCache().getWrites();
+	result.descriptorSetHits = renderer->getDescriptorSetCache().getHits();
+	result.textureCacheHits = renderer->getTextureCache().getHits();
+	result.textureBytes = renderer->getTextureCache().getUniqueBytes();
+	result.textureBytesSaved = renderer->getTextureCache().getSavedBytes();
+	result.cpuFrame = summarize(cpuFrameMs);
+	result.cpuSubmit = summarize(cpuSubmitMs);
+	result.gpuFrame = summarize(gpuFrameMs);
+	result.fenceWait = summarize(fenceWaitMs);
+	result.acquireWait = summarize(acquireMs);
+	result.presentWait = summarize(presentMs);
+	result.deviceMemory = MemoryStats::getDeviceUsage();
+	result.processMemoryBytes = MemoryStats::getProcessResidentBytes();
+
+	return EXIT_SUCCESS;
+}
+
+void Benchmark::loadScene(const BenchmarkScene& scene)
+{
+	for (const auto& modelFile : scene.modelFiles)
+	{
+		modelIds.push_back(renderer->createMeshModel(modelFile));
+	}
+
+	if (scene.instanceCount == 0)
+	{
+		//Spread models along x so they don't overlap
+		for (size_t i = 0; i < modelIds.size(); i++)
+		{
+			float offset = (static_cast<float>(i) - (modelIds.size() - 1) * 0.5f) * 3.0f;
+			objectPlacement.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f, 0.0f)));
+		}
+	}
+	else
+	{
+		createInstances(scene);
+	}
+
+	//Static scenes write their transforms once
+	if (!scene.animated)
+	{
+		updateScene(scene, 0);
+	}
+}
+
+void Benchmark::createInstances(const BenchmarkScene& scene)
+{
+	if (scene.instanceCount < modelIds.size())
+	{
+		throw std::runtime_error("Benchmark scene needs at least one instance per model!");
+	}
+
+	//Square grid over the visible area, objects shrink as the grid grows
+	uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(scene.instanceCount))));
+	float spacing = 6.0f / gridSize;
+	float scale = 1.0f / gridSize;
+	for (uint32_t i = 0; i < scene.instanceCount; i++)
+	{
+		float x = (static_cast<float>(i % gridSize) - (gridSize - 1) * 0.5f) * spacing;
+		float z = (static_cast<float>(i / gridSize) - (gridSize - 1) * 0.5f) * spacing;
+		glm::mat4 placement = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+		objectPlacement.push_back(glm::scale(placement, glm::vec3(scale)));
+	}
+
+	//Same texture choices for both orders, so only the draw order differs between sorted and random runs
+	struct InstanceDesc
+	{
+		int modelId;
+		int texture;
+	};
+	std::vector<InstanceDesc> descs;
+	std::mt19937 random(1234);
+	int textureCount = static_cast<int>(renderer->getTextureCount());
+	for (size_t i = modelIds.size(); i < scene.instanceCount; i++)
+	{
+		InstanceDesc desc = {};
+		desc.modelId = modelIds[i % modelIds.size()];
+		desc.texture = textureCount > 0 ? static_cast<int>(random() % textureCount) : -1;
+		descs.push_back(desc);
+	}
+
+	if (scene.randomTextures)
+	{
+		std::shuffle(descs.begin(), descs.end(), random);
+	}
+	else
+	{
+		std::stable_sort(descs.begin(), descs.end(), [](const InstanceDesc& a, const InstanceDesc& b) { return a.texture < b.texture; });
+	}
+
+	for (const auto& desc : descs)
+	{
+		instanceIds.push_back(renderer->createModelInstance(desc.modelId, glm::mat4(1.0f), desc.texture));
+	}
+}
+
+void Benchmark::updateScene(const BenchmarkScene& scene, uint32_t frameIndex)
+{
+	if (!scene.animated && frameIndex > 0) return;
+
+	//Animation only depends on the frame index, never on wall clock time
+	double time = frameIndex * options.timestep;
+	float angle = static_cast<float>(std::fmod(10.0 * time, 360.0));
+
+	//Models come first in the placement list, then the instances
+	for (size_t i = 0; i < objectPlacement.size(); i++)
+	{
+		glm::mat4 model = glm::rotate(objectPlacement[i], glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+		if (i < modelIds.size())
+		{
+			renderer->updateModel(modelIds[i], model);
+		}
+		else
+		{
+			renderer->updateModelInstance(instanceIds[i - modelIds.size()], model);
+		}
+	}
+}
+
+void Benchmark::collectGpuTimes()
+{
+	for (const auto& frame : renderer->getGpuProfiler().getFrameHistory())
+	{
+		if (static_cast<int64_t>(frame.frameNumber) <= lastGpuFrame) continue;
+		lastGpuFrame = static_cast<int64_t>(frame.frameNumber);
+
+		if (frame.frameNumber < firstMeasuredFrame || frame.frameNumber > lastMeasuredFrame) continue;
+
+		//The first scope always covers the whole frame
+		if (!frame.scopes.empty())
+		{
+			gpuFrameMs.push_back((frame.scopes[0].endNs - frame.scopes[0].beginNs) / 1000000.0);
+		}
+	}
+}
+
+//Write one summary as a JSON object member
+static void writeSummary(std::ofstream& file, const char* name, const SampleSummary& summary, bool last = false)
+{
+	file << "\t\t\t\t\"" << jsonEscape(name) << "\": { \"count\": " << summary.count << ", \"mean\": " << summary.mean << ", \"p50\": " << summary.p50
+		<< ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }" << (last ? "\n" : ",\n");
+}
+
+bool Benchmark::writeResults(const std::string& fileName, const std::string& deviceName, const BenchmarkOptions& options,
+	const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("ERROR: Failed to open benchmark output %s \n", fileName.c_str());
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "\t\"device\": \"" << jsonEscape(deviceName) << "\",\n";
+	file << "\t\"warmupFrames\": " << options.warmupFrames << ",\n";
+	file << "\t\"measuredFrames\": " << options.measuredFrames << ",\n";
+	file << "\t\"timestep\": " << options.timestep << ",\n";
+	file << "\t\"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		file << "\t\t{\n";
+		file << "\t\t\t\"scene\": \"" << jsonEscape(result.scene) << "\",\n";
+		file << "\t\t\t\"objects\": " << result.objectCount << ",\n";
+		file << "\t\t\t\"backend\": \"" << jsonEscape(result.backend) << "\",\n";
+		file << "\t\t\t\"textureBinding\": \"" << jsonEscape(result.textureBinding) << "\",\n";
+		file << "\t\t\t\"startupMs\": " << result.startupMs << ",\n";
+		file << "\t\t\t\"pipelineMs\": " << result.pipelineMs << ",\n";
+		file << "\t\t\t\"loadMs\": " << result.loadMs << ",\n";
+		file << "\t\t\t\"descriptorPools\": " << result.descriptorPools << ",\n";
+		file << "\t\t\t\"descriptorSetWrites\": " << result.descriptorSetWrites << ",\n";
+		file << "\t\t\t\"descriptorSetHits\": " << result.descriptorSetHits << ",\n";
+		file << "\t\t\t\"textureCacheHits\": " << result.textureCacheHits << ",\n";
+		file << "\t\t\t\"milliseconds\": {\n";
+		writeSummary(file, "cpuFrame", result.cpuFrame);
+		writeSummary(file, "cpuSubmit", result.cpuSubmit);
+		writeSummary(file, "gpuFrame", result.gpuFrame);
+		writeSummary(file, "fenceWait", result.fenceWait);
+		writeSummary(file, "acquireWait", result.acquireWait);
+		writeSummary(file, "presentWait", result.presentWait, true);
+		file << "\t\t\t},\n";
+		file << "\t\t\t\"memory\": { \"deviceBytes\": " << result.deviceMemory.allocatedBytes << ", \"devicePeakBytes\": " << result.deviceMemory.peakBytes
+			<< ", \"deviceAllocations\": " << result.deviceMemory.allocationCount << ", \"processResidentBytes\": " << result.processMemoryBytes
+			<< ", \"textureBytes\": " << result.textureBytes << ", \"textureBytesSaved\": " << result.textureBytesSaved << " }\n";
+		file << "\t\t}" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "\t]\n";
+	file << "}\n";
+	file.close();
+
+	return true;
+}
+
+Benchmark::~Benchmark()
+{
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include"VulkanRender.h"
+
+//Command line selected benchmark run
+struct BenchmarkOptions
+{
+	std::string scene = "chopper";
+	uint32_t warmupFrames = 100;
+	uint32_t measuredFrames = 1000;
+	double timestep = 1.0 / 60.0;		//Fixed animation time per frame in seconds, keeps runs comparable
+	std::string outputFile = "benchmark.json";
+	std::string traceFile;					//Chrome trace of the measured frames (empty = none)
+};
+
+//Models making up a named benchmark scene
+struct BenchmarkScene
+{
+	std::string name;
+	std::vector<std::string> modelFiles;
+
+	//-Instanced scenes (instanceCount = 0 draws each model once at the origin)
+	uint32_t instanceCount = 0;		//Total objects drawn, spread over the models on a grid
+	bool randomTextures = false;	//Each object gets a random texture, drawn in random order instead of sorted by texture
+	bool animated = true;			//Transforms are rewritten every frame, otherwise only once
+};
+
+//Distribution of one measured value, in milliseconds
+struct SampleSummary
+{
+	size_t count = 0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+//Everything measured for one scene
+struct BenchmarkResult
+{
+	std::string scene;
+	uint32_t objectCount = 0;
+	std::string backend;				//Render backend actually used (after any fallback)
+	std::string textureBinding;			//Texture binding actually used (after any fallback)
+	double startupMs = 0.0;				//VulkanRender::init
+	double pipelineMs = 0.0;			//Pipelines or shader objects, part of startupMs
+	double loadMs = 0.0;				//Loading models, textures and creating instances
+	size_t descriptorPools = 0;			//Pools the descriptor allocators grew to
+	uint64_t descriptorSetWrites = 0;	//Sets written through the descriptor set cache
+	uint64_t descriptorSetHits = 0;		//Requests answered with an existing set
+	uint64_t textureCacheHits = 0;		//Texture references answered with a loaded texture
+	uint64_t textureBytes = 0;			//Device memory of the unique textures
+	uint64_t textureBytesSaved = 0;		//What loading every reference separately would have added
+	SampleSummary cpuFrame;
+	SampleSummary cpuSubmit;			//Recording + vkQueueSubmit
+	SampleSummary gpuFrame;
+	SampleSummary fenceWait;
+	SampleSummary acquireWait;
+	SampleSummary presentWait;
+	DeviceMemoryUsage deviceMemory;		//Taken after the measured frames
+	uint64_t processMemoryBytes = 0;
+};
+
+class Benchmark
+{
+public:
+	//newWindow is nullptr for a headless renderer
+	Benchmark(VulkanRender* newRenderer, GLFWwindow* newWindow, BenchmarkOptions newOptions);
+
+	static const std::vector<BenchmarkScene>& getScenes();
+	static SampleSummary summarize(const std::vector<double>& samples);
+
+	//Load the scene named in the options, render warmup + measured frames and write the results, returns EXIT_SUCCESS/EXIT_FAILURE
+	int run();
+
+	//Same for any scene, without writing a file (see getResult / writeResults)
+	int run(const BenchmarkScene& scene);
+	const BenchmarkResult& getResult() { return result; };
+
+	//Write one JSON file holding all results, returns false if it can't be written
+	static bool writeResults(const std::string& fileName, const std::string& deviceName, const BenchmarkOptions& options,
+		const std::vector<BenchmarkResult>& results);
+
+	~Benchmark();
+
+private:
+	VulkanRender* renderer;
+	GLFWwindow* window;
+	BenchmarkOptions options;
+
+	std::vector<int> modelIds;
+	std::vector<int> instanceIds;		//Objects after the models themselves
+	std::vector<glm::mat4> objectPlacement;		//Grid transform of every object (models first)
+
+	BenchmarkResult result;
+	std::vector<double> cpuFrameMs;
+	std::vector<double> cpuSubmitMs;
+	std::vector<double> gpuFrameMs;
+	std::vector<double> fenceWaitMs;
+	std::vector<double> acquireMs;
+	std::vector<double> presentMs;
+
+	uint64_t firstMeasuredFrame = 0;
+	uint64_t lastMeasuredFrame = 0;
+	int64_t lastGpuFrame = -1;		//Last frame whose GPU time was taken from the profiler history
+
+	void loadScene(const BenchmarkScene& scene);
+	void createInstances(const BenchmarkScene& scene);
+	void updateScene(const BenchmarkScene& scene, uint32_t frameIndex);
+	void collectGpuTimes();
+};
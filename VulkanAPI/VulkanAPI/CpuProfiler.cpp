@@ -0,0 +1,193 @@
+#include "CpuProfiler.h"
+#include "GpuProfiler.h"
+#include<fstream>
+#include<iomanip>
+#include<algorithm>
+
+CpuProfiler& CpuProfiler::get()
+{
+	static CpuProfiler profiler;
+	return profiler;
+}
+
+void CpuProfiler::recordZone(const char* name, int64_t startNs, int64_t endNs)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	//Single writer per ring. The fence orders the previous index publish before this slot's stores,
+	//so an exporter that sees any of them also sees writeIndex past the event it replaces
+	uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	ZoneSlot& slot = buffer->events[index & (CPU_PROFILER_EVENTS_PER_THREAD - 1)];
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.startNs.store(startNs, std::memory_order_relaxed);
+	slot.endNs.store(endNs, std::memory_order_relaxed);
+	buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::markFrame(uint64_t frameNumber)
+{
+	FrameMarker marker = {};
+	marker.frameNumber = frameNumber;
+	marker.startNs = now();
+
+	std::lock_guard<std::mutex> lock(frameMutex);
+	frameMarkers.push_back(marker);
+	if (frameMarkers.size() > CPU_PROFILER_FRAME_HISTORY)
+	{
+		frameMarkers.pop_front();
+	}
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(registerMutex);
+	buffer->threadName = name;
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::getThreadBuffer()
+{
+	//Each thread registers its ring once, after that recording never locks
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+	if (threadBuffer == nullptr)
+	{
+		std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+		newBuffer->events.reset(new ZoneSlot[CPU_PROFILER_EVENTS_PER_THREAD]);
+
+		std::lock_guard<std::mutex> lock(registerMutex);
+		newBuffer->threadId = static_cast<uint32_t>(threadBuffers.size()) + 1;
+		newBuffer->threadName = "Thread " + std::to_string(newBuffer->threadId);
+		threadBuffer = newBuffer.get();
+		threadBuffers.push_back(std::move(newBuffer));
+	}
+
+	return threadBuffer;
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string& fileName, uint64_t firstFrame, uint64_t lastFrame,
+	const std::deque<GpuFrameTiming>* gpuFrames)
+{
+	//Find the time window covered by the frame range
+	int64_t windowBegin = 0;
+	int64_t windowEnd = now();
+	bool foundFirst = false;
+	std::vector<FrameMarker> markers;
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+		for (const auto& marker : frameMarkers)
+		{
+			if (marker.frameNumber > lastFrame)
+			{
+				windowEnd = marker.startNs;
+				break;
+			}
+			if (marker.frameNumber >= firstFrame)
+			{
+				if (!foundFirst)
+				{
+					windowBegin = marker.startNs;
+					foundFirst = true;
+				}
+				markers.push_back(marker);
+			}
+		}
+	}
+
+	if (!foundFirst)
+	{
+		printf("Trace not written: frames %llu-%llu are no longer (or not yet) in the frame history\n",
+			static_cast<unsigned long long>(firstFrame), static_cast<unsigned long long>(lastFrame));
+		return false;
+	}
+
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Trace not written: failed to open %s\n", fileName.c_str());
+		return false;
+	}
+
+	//Trace timestamps are microseconds from the start of the first exported frame
+	auto toMicro = [windowBegin](int64_t ns) { return static_cast<double>(ns - windowBegin) / 1000.0; };
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"VulkanAPI\"}}";
+
+	for (const auto& marker : markers)
+	{
+		file << ",\n{\"name\":\"Frame " << marker.frameNumber << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+			<< toMicro(marker.startNs) << "}";
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(registerMutex);
+		for (const auto& buffer : threadBuffers)
+		{
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"args\":{\"name\":\"" << jsonEscape(buffer->threadName) << "\"}}";
+
+			//Copy the last ring's worth of events, the owning thread may keep recording meanwhile
+			uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+			uint64_t begin = end > CPU_PROFILER_EVENTS_PER_THREAD ? end - CPU_PROFILER_EVENTS_PER_THREAD : 0;
+			std::vector<CpuZoneEvent> events(static_cast<size_t>(end - begin));
+			for (uint64_t i = begin; i < end; i++)
+			{
+				const ZoneSlot& slot = buffer->events[i & (CPU_PROFILER_EVENTS_PER_THREAD - 1)];
+				CpuZoneEvent& event = events[static_cast<size_t>(i - begin)];
+				event.name = slot.name.load(std::memory_order_relaxed);
+				event.startNs = slot.startNs.load(std::memory_order_relaxed);
+				event.endNs = slot.endNs.load(std::memory_order_relaxed);
+			}
+
+			//Slot of event i is rewritten by event i + ring size, which starts once writeIndex reaches it.
+			//Anything at or below the new writeIndex minus the ring size may be torn, drop it
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t newEnd = buffer->writeIndex.load(std::memory_order_relaxed);
+			uint64_t firstIntact = newEnd >= CPU_PROFILER_EVENTS_PER_THREAD ? newEnd - CPU_PROFILER_EVENTS_PER_THREAD + 1 : 0;
+
+			for (uint64_t i = std::max(begin, firstIntact); i < end; i++)
+			{
+				const CpuZoneEvent& event = events[static_cast<size_t>(i - begin)];
+				if (event.endNs < windowBegin || event.startNs > windowEnd)
+				{
+					continue;
+				}
+
+				file << ",\n{\"name\":\"" << jsonEscape(event.name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"ts\":" << toMicro(event.startNs) << ",\"dur\":" << static_cast<double>(event.endNs - event.startNs) / 1000.0 << "}";
+			}
+		}
+	}
+
+	//GPU frames start at their submit time, so GPU zones show the earliest point the work could have started
+	if (gpuFrames != nullptr)
+	{
+		const uint32_t gpuTrackId = 1000;
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpuTrackId << ",\"args\":{\"name\":\"GPU Graphics Queue\"}}";
+
+		for (const auto& frame : *gpuFrames)
+		{
+			if (frame.frameNumber < firstFrame || frame.frameNumber > lastFrame)
+			{
+				continue;
+			}
+
+			for (const auto& scope : frame.scopes)
+			{
+				file << ",\n{\"name\":\"" << jsonEscape(scope.name) << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << gpuTrackId
+					<< ",\"ts\":" << toMicro(frame.submitNs + scope.beginNs) << ",\"dur\":" << static_cast<double>(scope.endNs - scope.beginNs) / 1000.0
+					<< ",\"args\":{\"frame\":" << frame.frameNumber << "}}";
+			}
+		}
+	}
+
+	file << "\n]}\n";
+	file.close();
+
+	printf("Trace of frames %llu-%llu written to %s\n",
+		static_cast<unsigned long long>(firstFrame), static_cast<unsigned long long>(lastFrame), fileName.c_str());
+	return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include<chrono>
+#include<atomic>
+#include<mutex>
+#include<memory>
+#include<string>
+#include<vector>
+#include<deque>
+
+struct GpuFrameTiming;
+
+//Zones only exist when ENABLE_CPU_PROFILER is defined (see project Preprocessor Definitions), otherwise they compile to nothing
+#ifdef ENABLE_CPU_PROFILER
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_ZONE(name) CpuProfileZone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+#define CPU_PROFILE_FUNCTION() CPU_PROFILE_ZONE(__FUNCTION__)
+#define CPU_PROFILE_FRAME(frameNumber) CpuProfiler::get().markFrame(frameNumber)
+#define CPU_PROFILE_THREAD(name) CpuProfiler::get().setThreadName(name)
+#else
+#define CPU_PROFILE_ZONE(name)
+#define CPU_PROFILE_FUNCTION()
+#define CPU_PROFILE_FRAME(frameNumber)
+#define CPU_PROFILE_THREAD(name)
+#endif
+
+const size_t CPU_PROFILER_EVENTS_PER_THREAD = 1 << 16;		//Ring size of each thread, must be a power of two
+const size_t CPU_PROFILER_FRAME_HISTORY = 1024;			//Number of frame markers kept for range export
+
+//One finished zone, name must outlive the profiler (string literal or __FUNCTION__)
+struct CpuZoneEvent
+{
+	const char* name;
+	int64_t startNs;
+	int64_t endNs;
+};
+
+class CpuProfiler
+{
+public:
+	static CpuProfiler& get();
+
+	//Timestamp in nanoseconds on the steady clock, shared with the GPU submit times
+	static int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	};
+
+	void recordZone(const char* name, int64_t startNs, int64_t endNs);
+	void markFrame(uint64_t frameNumber);
+	void setThreadName(const char* name);
+
+	//Write zones of frames [firstFrame, lastFrame] as Chrome trace JSON (chrome://tracing / Perfetto)
+	//GPU scopes are merged onto the same timeline when a frame history is given
+	bool writeChromeTrace(const std::string& fileName, uint64_t firstFrame, uint64_t lastFrame,
+		const std::deque<GpuFrameTiming>* gpuFrames = nullptr);
+
+private:
+	CpuProfiler() {};
+	CpuProfiler(const CpuProfiler&) = delete;
+	CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+	//Ring slot, atomic because the exporter reads slots the owning thread may be overwriting
+	struct ZoneSlot
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<int64_t> startNs{ 0 };
+		std::atomic<int64_t> endNs{ 0 };
+	};
+
+	//Ring written only by its own thread, the exporter copies up to writeIndex and drops what was overwritten meanwhile
+	struct ThreadBuffer
+	{
+		uint32_t threadId;
+		std::string threadName;
+		std::unique_ptr<ZoneSlot[]> events;
+		std::atomic<uint64_t> writeIndex{ 0 };
+	};
+
+	struct FrameMarker
+	{
+		uint64_t frameNumber;
+		int64_t startNs;
+	};
+
+	std::mutex registerMutex;		//Only taken when a thread records its first zone, or on export
+	std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+
+	std::mutex frameMutex;
+	std::deque<FrameMarker> frameMarkers;
+
+	ThreadBuffer* getThreadBuffer();
+};
+
+//Records the time between construction and destruction as a zone
+class CpuProfileZone
+{
+public:
+	CpuProfileZone(const char* zoneName) : name(zoneName), startNs(CpuProfiler::now()) {};
+	~CpuProfileZone() { CpuProfiler::get().recordZone(name, startNs, CpuProfiler::now()); };
+
+private:
+	const char* name;
+	int64_t startNs;
+};
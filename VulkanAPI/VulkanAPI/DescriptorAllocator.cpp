@@ -0,0 +1,197 @@
+#include "DescriptorAllocator.h"
+#include<algorithm>
+
+DescriptorAllocator::DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::init(VkDevice newDevice, uint32_t firstPoolSets, VkDescriptorPoolCreateFlags newFlags)
+{
+	device = newDevice;
+	flags = newFlags;
+	nextPoolSets = std::max(firstPoolSets, 1u);
+	setCount = 0;
+}
+
+void DescriptorAllocator::destroy()
+{
+	if (currentPool != VK_NULL_HANDLE)
+	{
+		usedPools.push_back(currentPool);
+		currentPool = VK_NULL_HANDLE;
+	}
+	for (VkDescriptorPool pool : usedPools)
+	{
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	for (VkDescriptorPool pool : freePools)
+	{
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	usedPools.clear();
+	freePools.clear();
+	layouts.clear();
+	setCount = 0;
+}
+
+void DescriptorAllocator::registerLayout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes)
+{
+	layouts[layout].setSizes = setSizes;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const void* pNext)
+{
+	auto usage = layouts.find(layout);
+	if (usage == layouts.end())
+	{
+		throw std::runtime_error("Failed to allocate a Descriptor Set, its layout was not registered!");
+	}
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.pNext = pNext;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+	if (currentPool != VK_NULL_HANDLE)
+	{
+		setAllocInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(device, &setAllocInfo, &descriptorSet);
+	}
+
+	//Full pool: OUT_OF_POOL_MEMORY / FRAGMENTED_POOL, but before maintenance1 drivers may report anything,
+	//so any failure moves on to the next pool (reset ones first), only a failure in a brand new pool is an error
+	while (result != VK_SUCCESS)
+	{
+		if (currentPool != VK_NULL_HANDLE)
+		{
+			usedPools.push_back(currentPool);
+		}
+
+		bool newPool = freePools.empty();
+		if (newPool)
+		{
+			currentPool = createPool(usage->second);
+		}
+		else
+		{
+			currentPool = freePools.back();
+			freePools.pop_back();
+		}
+
+		setAllocInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(device, &setAllocInfo, &descriptorSet);
+		if (result != VK_SUCCESS && newPool)
+		{
+			throw std::runtime_error("Failed to allocate a Descriptor Set!");
+		}
+	}
+
+	usage->second.setCount++;
+	usage->second.totalSetCount++;
+	setCount++;
+	return descriptorSet;
+}
+
+void DescriptorAllocator::reset()
+{
+	//Resetting a pool frees all of its sets in one call, no need to free them one by one
+	if (currentPool != VK_NULL_HANDLE)
+	{
+		usedPools.push_back(currentPool);
+		currentPool = VK_NULL_HANDLE;
+	}
+	for (VkDescriptorPool pool : usedPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+		freePools.push_back(pool);
+	}
+	usedPools.clear();
+
+	for (auto& layout : layouts)
+	{
+		layout.second.setCount = 0;
+	}
+	setCount = 0;
+}
+
+uint32_t DescriptorAllocator::getSetCount(VkDescriptorSetLayout layout)
+{
+	auto usage = layouts.find(layout);
+	return usage != layouts.end() ? usage->second.setCount : 0;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(const LayoutUsage& requested)
+{
+	uint32_t maxSets = nextPoolSets;
+	nextPoolSets = std::min(nextPoolSets * 2, std::max(DESCRIPTOR_POOL_MAX_SETS, nextPoolSets));
+
+	//Share of the sets per layout follows how much each has been used, layouts never used yet count once
+	uint64_t totalWeight = 0;
+	for (auto& layout : layouts)
+	{
+		totalWeight += std::max<uint64_t>(layout.second.totalSetCount, 1);
+	}
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	auto addDescriptors = [&poolSizes](VkDescriptorType type, uint32_t count)
+	{
+		auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(),
+			[type](const VkDescriptorPoolSize& size) { return size.type == type; });
+		if (poolSize == poolSizes.end())
+		{
+			poolSizes.push_back({ type, count });
+		}
+		else
+		{
+			poolSize->descriptorCount += count;
+		}
+	};
+	for (auto& layout : layouts)
+	{
+		uint64_t weight = std::max<uint64_t>(layout.second.totalSetCount, 1);
+		for (auto& setSize : layout.second.setSizes)
+		{
+			uint64_t count = (static_cast<uint64_t>(setSize.descriptorCount) * maxSets * weight + totalWeight - 1) / totalWeight;
+			addDescriptors(setSize.type, static_cast<uint32_t>(count));
+		}
+	}
+
+	//Whatever the mix, the set that asked for this pool must fit
+	for (auto& setSize : requested.setSizes)
+	{
+		auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(),
+			[&setSize](const VkDescriptorPoolSize& size) { return size.type == setSize.type; });
+		if (poolSize == poolSizes.end())
+		{
+			poolSizes.push_back(setSize);
+		}
+		else if (poolSize->descriptorCount < setSize.descriptorCount)
+		{
+			poolSize->descriptorCount = setSize.descriptorCount;
+		}
+	}
+	poolSizes.erase(std::remove_if(poolSizes.begin(), poolSizes.end(),
+		[](const VkDescriptorPoolSize& size) { return size.descriptorCount == 0; }), poolSizes.end());
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = flags;
+	poolCreateInfo.maxSets = maxSets;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &pool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Descriptor Pool!");
+	}
+	return pool;
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
@@ -0,0 +1,57 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<vector>
+#include<unordered_map>
+#include<stdexcept>
+
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;		//Pools stop growing at this many sets
+
+//Descriptor sets from a chain of pools, a new pool is made whenever the current one runs out
+//so nothing has to be sized at startup. Each new pool holds twice the sets of the last one, with
+//descriptor counts for the mix of layouts allocated so far.
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator();
+
+	//firstPoolSets: sets in the first pool, flags: for every pool (e.g. update after bind)
+	void init(VkDevice newDevice, uint32_t firstPoolSets, VkDescriptorPoolCreateFlags newFlags = 0);
+	void destroy();
+
+	//Descriptors one set of the layout needs (ShaderLayout::getPoolSizes(set, 1)), before allocating with it
+	void registerLayout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes);
+
+	//pNext is passed to the allocation (e.g. variable descriptor counts)
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr);
+
+	//Frees every set at once and keeps the pools for the next allocations, for sets that only live one batch of
+	//work (the mipmap generator's), the renderer's own sets are long lived and come through DescriptorSetCache
+	void reset();
+
+	size_t getPoolCount() { return usedPools.size() + freePools.size() + (currentPool != VK_NULL_HANDLE ? 1 : 0); };
+	uint32_t getSetCount() { return setCount; };		//Allocated since the last reset
+	uint32_t getSetCount(VkDescriptorSetLayout layout);
+
+	~DescriptorAllocator();
+
+private:
+	struct LayoutUsage
+	{
+		std::vector<VkDescriptorPoolSize> setSizes;
+		uint32_t setCount = 0;		//Since the last reset
+		uint64_t totalSetCount = 0;		//Ever, weights the pool sizes
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkDescriptorPoolCreateFlags flags = 0;
+	uint32_t nextPoolSets = 0;
+	uint32_t setCount = 0;
+
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> usedPools;		//Full, or replaced by a newer pool
+	std::vector<VkDescriptorPool> freePools;		//Reset, reused before creating new ones
+	std::unordered_map<VkDescriptorSetLayout, LayoutUsage> layouts;
+
+	VkDescriptorPool createPool(const LayoutUsage& requested);
+};
@@ -0,0 +1,308 @@
+#include "DescriptorSetCache.h"
+#include<algorithm>
+#include<cstddef>
+
+namespace
+{
+	//FNV-1a, handles only have to hash the same within one run
+	void hashValue(uint64_t* hash, uint64_t value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		for (size_t i = 0; i < sizeof(value); i++)
+		{
+			*hash ^= bytes[i];
+			*hash *= 1099511628211ull;
+		}
+	}
+}
+
+DescriptorSetContents::DescriptorSetContents()
+{
+}
+
+DescriptorSetContents& DescriptorSetContents::addBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	Binding newBinding = {};
+	newBinding.binding = binding;
+	newBinding.type = type;
+	newBinding.isImage = false;
+	newBinding.bufferInfo.buffer = buffer;		//Buffer to get data from
+	newBinding.bufferInfo.offset = offset;		//Position of start of data
+	newBinding.bufferInfo.range = range;		//Size of data
+	addBinding(newBinding);
+	return *this;
+}
+
+DescriptorSetContents& DescriptorSetContents::addImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+	Binding newBinding = {};
+	newBinding.binding = binding;
+	newBinding.type = type;
+	newBinding.isImage = true;
+	newBinding.imageInfo.imageLayout = imageLayout;		//Image layout when in use
+	newBinding.imageInfo.imageView = imageView;
+	newBinding.imageInfo.sampler = sampler;		//VK_NULL_HANDLE for input attachments
+	addBinding(newBinding);
+	return *this;
+}
+
+void DescriptorSetContents::addBinding(const Binding& newBinding)
+{
+	auto position = std::lower_bound(bindings.begin(), bindings.end(), newBinding.binding,
+		[](const Binding& a, uint32_t b) { return a.binding < b; });
+	if (position != bindings.end() && position->binding == newBinding.binding)
+	{
+		*position = newBinding;
+	}
+	else
+	{
+		bindings.insert(position, newBinding);
+	}
+}
+
+std::vector<VkWriteDescriptorSet> DescriptorSetContents::getWrites(VkDescriptorSet set) const
+{
+	std::vector<VkWriteDescriptorSet> setWrites(bindings.size());
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		VkWriteDescriptorSet& setWrite = setWrites[i];
+		setWrite = {};
+		setWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		setWrite.dstSet = set;		//Descriptor Set to update
+		setWrite.dstBinding = bindings[i].binding;		//Binding to update (mateches with binding on layout)
+		setWrite.dstArrayElement = 0;		//Index in array to update
+		setWrite.descriptorType = bindings[i].type;
+		setWrite.descriptorCount = 1;
+		if (bindings[i].isImage)
+		{
+			setWrite.pImageInfo = &bindings[i].imageInfo;
+		}
+		else
+		{
+			setWrite.pBufferInfo = &bindings[i].bufferInfo;
+		}
+	}
+	return setWrites;
+}
+
+std::vector<VkDescriptorUpdateTemplateEntryKHR> DescriptorSetContents::getTemplateEntries() const
+{
+	//Bindings are read in place, each one's info sits at its offset inside the Binding array
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> entries(bindings.size());
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		entries[i] = {};
+		entries[i].dstBinding = bindings[i].binding;
+		entries[i].dstArrayElement = 0;
+		entries[i].descriptorCount = 1;
+		entries[i].descriptorType = bindings[i].type;
+		entries[i].offset = i * sizeof(Binding) + (bindings[i].isImage ? offsetof(Binding, imageInfo) : offsetof(Binding, bufferInfo));
+		entries[i].stride = sizeof(Binding);
+	}
+	return entries;
+}
+
+bool DescriptorSetContents::references(uint64_t handle) const
+{
+	for (auto& binding : bindings)
+	{
+		if (binding.isImage ? ((uint64_t)binding.imageInfo.imageView == handle || (uint64_t)binding.imageInfo.sampler == handle) :
+			(uint64_t)binding.bufferInfo.buffer == handle)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t DescriptorSetContents::getHash() const
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (auto& binding : bindings)
+	{
+		hashValue(&hash, binding.binding);
+		hashValue(&hash, static_cast<uint64_t>(binding.type));
+		if (binding.isImage)
+		{
+			hashValue(&hash, (uint64_t)binding.imageInfo.imageView);
+			hashValue(&hash, (uint64_t)binding.imageInfo.sampler);
+			hashValue(&hash, static_cast<uint64_t>(binding.imageInfo.imageLayout));
+		}
+		else
+		{
+			hashValue(&hash, (uint64_t)binding.bufferInfo.buffer);
+			hashValue(&hash, binding.bufferInfo.offset);
+			hashValue(&hash, binding.bufferInfo.range);
+		}
+	}
+	return hash;
+}
+
+bool DescriptorSetContents::operator==(const DescriptorSetContents& other) const
+{
+	if (bindings.size() != other.bindings.size()) return false;
+
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const Binding& a = bindings[i];
+		const Binding& b = other.bindings[i];
+		if (a.binding != b.binding || a.type != b.type || a.isImage != b.isImage) return false;
+		if (a.isImage)
+		{
+			if (a.imageInfo.imageView != b.imageInfo.imageView || a.imageInfo.sampler != b.imageInfo.sampler ||
+				a.imageInfo.imageLayout != b.imageInfo.imageLayout) return false;
+		}
+		else
+		{
+			if (a.bufferInfo.buffer != b.bufferInfo.buffer || a.bufferInfo.offset != b.bufferInfo.offset ||
+				a.bufferInfo.range != b.bufferInfo.range) return false;
+		}
+	}
+	return true;
+}
+
+DescriptorSetContents::~DescriptorSetContents()
+{
+}
+
+size_t DescriptorSetCache::KeyHasher::operator()(const Key& key) const
+{
+	uint64_t hash = key.contents.getHash();
+	hashValue(&hash, (uint64_t)key.layout);
+	return static_cast<size_t>(hash);
+}
+
+DescriptorSetCache::DescriptorSetCache()
+{
+}
+
+template<typename Function>
+void DescriptorSetCache::loadFunction(Function* function, const char* name)
+{
+	*function = reinterpret_cast<Function>(vkGetDeviceProcAddr(device, name));
+	if (*function == nullptr)
+	{
+		throw std::runtime_error(std::string("Failed to load ") + name + "!");
+	}
+}
+
+void DescriptorSetCache::init(VkDevice newDevice, bool useUpdateTemplates)
+{
+	device = newDevice;
+	updateTemplatesEnabled = useUpdateTemplates;
+	if (updateTemplatesEnabled)
+	{
+		loadFunction(&createDescriptorUpdateTemplateKHR, "vkCreateDescriptorUpdateTemplateKHR");
+		loadFunction(&destroyDescriptorUpdateTemplateKHR, "vkDestroyDescriptorUpdateTemplateKHR");
+		loadFunction(&updateDescriptorSetWithTemplateKHR, "vkUpdateDescriptorSetWithTemplateKHR");
+	}
+}
+
+void DescriptorSetCache::destroy()
+{
+	for (auto& updateTemplate : updateTemplates)
+	{
+		destroyDescriptorUpdateTemplateKHR(device, updateTemplate.second.handle, nullptr);
+	}
+	updateTemplates.clear();
+	sets.clear();
+	freeSets.clear();
+}
+
+VkDescriptorSet DescriptorSetCache::get(DescriptorAllocator& allocator, VkDescriptorSetLayout layout, const DescriptorSetContents& contents)
+{
+	Key key = { layout, contents };
+	auto cached = sets.find(key);
+	if (cached != sets.end())
+	{
+		hits++;
+		return cached->second;
+	}
+
+	//Reuse a set whose resources were destroyed before allocating another
+	VkDescriptorSet set;
+	std::vector<VkDescriptorSet>& layoutFreeSets = freeSets[layout];
+	if (!layoutFreeSets.empty())
+	{
+		set = layoutFreeSets.back();
+		layoutFreeSets.pop_back();
+	}
+	else
+	{
+		set = allocator.allocate(layout);
+	}
+
+	writeSet(set, layout, contents);
+	sets.emplace(key, set);
+	return set;
+}
+
+VkDescriptorUpdateTemplateKHR DescriptorSetCache::getUpdateTemplate(VkDescriptorSetLayout layout, const DescriptorSetContents& contents)
+{
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> entries = contents.getTemplateEntries();
+
+	auto existing = updateTemplates.find(layout);
+	if (existing != updateTemplates.end())
+	{
+		const std::vector<VkDescriptorUpdateTemplateEntryKHR>& templateEntries = existing->second.entries;
+		bool sameBindings = templateEntries.size() == entries.size() && std::equal(entries.begin(), entries.end(), templateEntries.begin(),
+			[](const VkDescriptorUpdateTemplateEntryKHR& a, const VkDescriptorUpdateTemplateEntryKHR& b)
+			{ return a.dstBinding == b.dstBinding && a.descriptorType == b.descriptorType && a.offset == b.offset; });
+		return sameBindings ? existing->second.handle : VK_NULL_HANDLE;
+	}
+
+	VkDescriptorUpdateTemplateCreateInfoKHR templateCreateInfo = {};
+	templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+	templateCreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateCreateInfo.pDescriptorUpdateEntries = entries.data();
+	templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+	templateCreateInfo.descriptorSetLayout = layout;		//Only a layout for DESCRIPTOR_SET templates, no pipeline layout or bind point
+
+	UpdateTemplate updateTemplate;
+	VkResult result = createDescriptorUpdateTemplateKHR(device, &templateCreateInfo, nullptr, &updateTemplate.handle);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Descriptor Update Template!");
+	}
+	updateTemplate.entries = entries;
+	updateTemplates.emplace(layout, updateTemplate);
+	return updateTemplate.handle;
+}
+
+void DescriptorSetCache::writeSet(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorSetContents& contents)
+{
+	writes++;
+
+	//Whole set in one call straight from the packed bindings
+	VkDescriptorUpdateTemplateKHR updateTemplate = updateTemplatesEnabled ? getUpdateTemplate(layout, contents) : VK_NULL_HANDLE;
+	if (updateTemplate != VK_NULL_HANDLE)
+	{
+		updateDescriptorSetWithTemplateKHR(device, set, updateTemplate, contents.getData());
+		return;
+	}
+
+	//Update the descriptor set with new buffer/image binding info
+	std::vector<VkWriteDescriptorSet> setWrites = contents.getWrites(set);
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+}
+
+void DescriptorSetCache::evictHandle(uint64_t handle)
+{
+	//Linear, resources are destroyed far less often than sets are looked up
+	for (auto entry = sets.begin(); entry != sets.end();)
+	{
+		if (entry->first.contents.references(handle))
+		{
+			freeSets[entry->first.layout].push_back(entry->second);
+			entry = sets.erase(entry);
+		}
+		else
+		{
+			++entry;
+		}
+	}
+}
+
+DescriptorSetCache::~DescriptorSetCache()
+{
+}
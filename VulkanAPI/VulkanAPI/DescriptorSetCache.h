@@ -0,0 +1,113 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<vector>
+#include<string>
+#include<unordered_map>
+#include<stdexcept>
+#include"DescriptorAllocator.h"
+
+//What the bindings of one descriptor set point at
+class DescriptorSetContents
+{
+public:
+	DescriptorSetContents();
+
+	//Adding a binding again replaces it
+	DescriptorSetContents& addBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	DescriptorSetContents& addImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout);
+
+	//One write per binding into the set, pointing into this object
+	std::vector<VkWriteDescriptorSet> getWrites(VkDescriptorSet set) const;
+
+	//Update template entries reading every binding from getData(), equal for all contents with the same bindings
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> getTemplateEntries() const;
+	const void* getData() const { return bindings.data(); };
+
+	//Handle of a buffer, image view or sampler
+	bool references(uint64_t handle) const;
+
+	uint64_t getHash() const;
+	bool operator==(const DescriptorSetContents& other) const;
+
+	~DescriptorSetContents();
+
+private:
+	struct Binding
+	{
+		uint32_t binding;
+		VkDescriptorType type;
+		bool isImage;
+		VkDescriptorBufferInfo bufferInfo;
+		VkDescriptorImageInfo imageInfo;
+	};
+	std::vector<Binding> bindings;		//Sorted by binding number, also the packed data update templates read
+
+	void addBinding(const Binding& newBinding);
+};
+
+//Hands out one descriptor set per layout + contents: the first request allocates and writes it, later
+//identical requests (e.g. models sharing a texture) get the same set without another vkUpdateDescriptorSets
+class DescriptorSetCache
+{
+public:
+	DescriptorSetCache();
+
+	//useUpdateTemplates: VK_KHR_descriptor_update_template is enabled, sets are written with one template per layout
+	void init(VkDevice newDevice, bool useUpdateTemplates);
+
+	//Forgets every set, they are freed with the allocators' pools, and destroys the update templates
+	void destroy();
+
+	//The layout must be registered with the allocator
+	VkDescriptorSet get(DescriptorAllocator& allocator, VkDescriptorSetLayout layout, const DescriptorSetContents& contents);
+
+	//Drops every set that references the buffer, image view or sampler, call before destroying it and only once no
+	//frame in flight uses those sets. Dropped sets are rewritten for later requests with the same layout.
+	template<typename Handle>
+	void evict(Handle handle) { evictHandle((uint64_t)handle); };
+
+	size_t getSetCount() { return sets.size(); };
+	uint64_t getHits() { return hits; };
+	uint64_t getWrites() { return writes; };		//Sets written, one vkUpdateDescriptorSetWithTemplateKHR or vkUpdateDescriptorSets each
+	size_t getUpdateTemplateCount() { return updateTemplates.size(); };
+
+	~DescriptorSetCache();
+
+private:
+	struct Key
+	{
+		VkDescriptorSetLayout layout;
+		DescriptorSetContents contents;
+		bool operator==(const Key& other) const { return layout == other.layout && contents == other.contents; };
+	};
+	struct KeyHasher
+	{
+		size_t operator()(const Key& key) const;
+	};
+	struct UpdateTemplate
+	{
+		VkDescriptorUpdateTemplateKHR handle = VK_NULL_HANDLE;
+		std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;		//Bindings it was made for
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::unordered_map<Key, VkDescriptorSet, KeyHasher> sets;
+	std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeSets;		//Evicted, per layout
+	uint64_t hits = 0;
+	uint64_t writes = 0;
+
+	bool updateTemplatesEnabled = false;
+	std::unordered_map<VkDescriptorSetLayout, UpdateTemplate> updateTemplates;
+	PFN_vkCreateDescriptorUpdateTemplateKHR createDescriptorUpdateTemplateKHR = nullptr;
+	PFN_vkDestroyDescriptorUpdateTemplateKHR destroyDescriptorUpdateTemplateKHR = nullptr;
+	PFN_vkUpdateDescriptorSetWithTemplateKHR updateDescriptorSetWithTemplateKHR = nullptr;
+
+	template<typename Function>
+	void loadFunction(Function* function, const char* name);
+
+	//Made on the first write with the layout, VK_NULL_HANDLE if the contents don't have the bindings it was made for
+	VkDescriptorUpdateTemplateKHR getUpdateTemplate(VkDescriptorSetLayout layout, const DescriptorSetContents& contents);
+	void writeSet(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorSetContents& contents);
+	void evictHandle(uint64_t handle);
+};
@@ -0,0 +1,185 @@
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+#include "CpuProfiler.h"
+
+FrameCapture::FrameCapture()
+{
+}
+
+bool FrameCapture::start(CaptureSettings newSettings)
+{
+	settings = newSettings;
+	if (settings.frameInterval == 0) settings.frameInterval = 1;
+	if (settings.maxQueuedFrames == 0) settings.maxQueuedFrames = 1;
+
+	const std::string extension = ".y4m";
+	y4m = settings.output.size() > extension.size() &&
+		settings.output.compare(settings.output.size() - extension.size(), extension.size(), extension) == 0;
+	if (y4m)
+	{
+		y4mFile.open(settings.output, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!y4mFile.is_open())
+		{
+			printf("Capture not started: failed to open %s\n", settings.output.c_str());
+			return false;
+		}
+	}
+
+	stopping = false;
+	running = true;
+	worker = std::thread(&FrameCapture::workerLoop, this);
+	return true;
+}
+
+void FrameCapture::submit(const ReadbackFrame& frame)
+{
+	if (!running || frame.frameNumber % settings.frameInterval != 0) return;
+
+	CPU_PROFILE_ZONE("Capture Copy");
+	CapturedFrame captured;
+	captured.frameNumber = frame.frameNumber;
+	captured.width = frame.width;
+	captured.height = frame.height;
+	captured.bgra = frame.format == VK_FORMAT_B8G8R8A8_UNORM || frame.format == VK_FORMAT_B8G8R8A8_SRGB;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		//Never wait for the worker: a full queue means it can't keep up, so this frame is skipped
+		if (queue.size() >= settings.maxQueuedFrames)
+		{
+			droppedFrames++;
+			return;
+		}
+		if (!freeBuffers.empty())
+		{
+			captured.pixels = std::move(freeBuffers.back());
+			freeBuffers.pop_back();
+		}
+	}
+
+	//The readback buffer is reused by the renderer after the callback, so the pixels are copied out here
+	size_t rowBytes = static_cast<size_t>(frame.width) * 4;
+	captured.pixels.resize(rowBytes * frame.height);
+	for (uint32_t y = 0; y < frame.height; y++)
+	{
+		memcpy(captured.pixels.data() + y * rowBytes, frame.pixels + static_cast<size_t>(y) * frame.rowPitch, rowBytes);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(std::move(captured));
+	}
+	queueCondition.notify_one();
+}
+
+void FrameCapture::stop()
+{
+	if (!running) return;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_one();
+	worker.join();
+	running = false;
+
+	if (y4mFile.is_open())
+	{
+		y4mFile.close();
+	}
+
+	printf("Capture: %llu frames written to %s, %llu dropped\n", static_cast<unsigned long long>(writtenFrames.load()),
+		settings.output.c_str(), static_cast<unsigned long long>(droppedFrames.load()));
+}
+
+void FrameCapture::workerLoop()
+{
+	CPU_PROFILE_THREAD("Capture");
+
+	while (true)
+	{
+		CapturedFrame frame;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return stopping || !queue.empty(); });
+
+			//Queued frames are still written after stop was requested
+			if (queue.empty()) return;
+			frame = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		writeFrame(frame);
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		freeBuffers.push_back(std::move(frame.pixels));
+	}
+}
+
+void FrameCapture::writeFrame(CapturedFrame& frame)
+{
+	if (frame.bgra)
+	{
+		for (size_t i = 0; i < frame.pixels.size(); i += 4)
+		{
+			std::swap(frame.pixels[i], frame.pixels[i + 2]);
+		}
+	}
+
+	if (y4m)
+	{
+		writeY4mFrame(frame);
+	}
+	else
+	{
+		CPU_PROFILE_ZONE("Encode PNG");
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), "_%06llu.png", static_cast<unsigned long long>(frame.frameNumber));
+		if (!ImageWriter::writePng(settings.output + suffix, frame.width, frame.height, frame.pixels.data(), frame.width * 4))
+		{
+			printf("Capture: failed to write %s%s\n", settings.output.c_str(), suffix);
+			return;
+		}
+	}
+
+	writtenFrames++;
+}
+
+void FrameCapture::writeY4mFrame(const CapturedFrame& frame)
+{
+	CPU_PROFILE_ZONE("Write Y4M");
+
+	//A stream has one size, the first frame decides it
+	if (y4mWidth == 0)
+	{
+		y4mWidth = frame.width;
+		y4mHeight = frame.height;
+		y4mFile << "YUV4MPEG2 W" << y4mWidth << " H" << y4mHeight << " F" << settings.frameRate << ":1 Ip A1:1 C444\n";
+	}
+	if (frame.width != y4mWidth || frame.height != y4mHeight)
+	{
+		return;
+	}
+
+	//BT.601 limited range, full resolution chroma so no filtering is needed
+	size_t pixelCount = static_cast<size_t>(frame.width) * frame.height;
+	std::vector<uint8_t> planes(pixelCount * 3);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		int r = frame.pixels[i * 4];
+		int g = frame.pixels[i * 4 + 1];
+		int b = frame.pixels[i * 4 + 2];
+		planes[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		planes[pixelCount + i] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		planes[pixelCount * 2 + i] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	}
+
+	y4mFile << "FRAME\n";
+	y4mFile.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+}
+
+FrameCapture::~FrameCapture()
+{
+	stop();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<deque>
+#include<fstream>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include"VulkanRender.h"
+
+//Writes frames handed out by VulkanRender's readback on a worker thread, so encoding never stalls rendering
+struct CaptureSettings
+{
+	std::string output;				//"name.y4m" writes one raw video stream, anything else is a PNG file prefix (name_000042.png)
+	uint32_t frameRate = 60;		//Stored in the Y4M header
+	uint32_t frameInterval = 1;		//Keep every n-th frame
+	uint32_t maxQueuedFrames = 8;	//Frames waiting for the worker before new ones are dropped
+};
+
+class FrameCapture
+{
+public:
+	FrameCapture();
+
+	//Opens the output and starts the worker, returns false if the output can't be written
+	bool start(CaptureSettings newSettings);
+
+	//Call from the readback callback: copies the pixels and returns, drops the frame if the worker is behind
+	void submit(const ReadbackFrame& frame);
+
+	//Writes all queued frames and stops the worker
+	void stop();
+
+	uint64_t getWrittenFrames() { return writtenFrames; };
+	uint64_t getDroppedFrames() { return droppedFrames; };
+
+	~FrameCapture();
+
+private:
+	struct CapturedFrame
+	{
+		uint64_t frameNumber = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		bool bgra = false;		//Swapchain byte order, swizzled on the worker
+		std::vector<uint8_t> pixels;		//Tightly packed, 4 bytes per pixel
+	};
+
+	CaptureSettings settings;
+	bool y4m = false;
+	std::ofstream y4mFile;
+	uint32_t y4mWidth = 0;
+	uint32_t y4mHeight = 0;
+
+	std::thread worker;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::deque<CapturedFrame> queue;
+	std::vector<std::vector<uint8_t>> freeBuffers;		//Pixel storage reused between frames
+	bool running = false;
+	bool stopping = false;
+
+	std::atomic<uint64_t> writtenFrames{ 0 };
+	std::atomic<uint64_t> droppedFrames{ 0 };
+
+	void workerLoop();
+	void writeFrame(CapturedFrame& frame);
+	void writeY4mFrame(const CapturedFrame& frame);
+};
@@ -0,0 +1,271 @@
+#include "GpuProfiler.h"
+
+GpuProfiler::GpuProfiler()
+{
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, uint32_t frameSlotCount)
+{
+	device = newDevice;
+
+	//Queue family must be able to write timestamps at all
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyList.data());
+
+	uint32_t validBits = queueFamilyList[queueFamilyIndex].timestampValidBits;
+	if (validBits == 0)
+	{
+		printf("GPU profiler disabled: queue family does not support timestamps\n");
+		return;
+	}
+	timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	//One range of queries per frame slot, so a slot can be read back while others are still in flight
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = MAX_GPU_QUERIES_PER_FRAME * frameSlotCount;
+
+	VkResult result = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Timestamp Query Pool!");
+	}
+
+	frameSlots.resize(frameSlotCount);
+	enabled = true;
+}
+
+void GpuProfiler::destroy()
+{
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	enabled = false;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameNumber)
+{
+	if (!enabled) return;
+
+	recordingSlot = frameSlot;
+	frameSlots[frameSlot].scopes.clear();
+	frameSlots[frameSlot].queryCount = 0;
+	frameSlots[frameSlot].frameNumber = frameNumber;
+	frameSlots[frameSlot].submitNs = 0;
+	openScopes.clear();
+
+	//Queries must be reset before being written again (outside of a render pass)
+	vkCmdResetQueryPool(commandBuffer, queryPool, frameSlot * MAX_GPU_QUERIES_PER_FRAME, MAX_GPU_QUERIES_PER_FRAME);
+
+	beginScope(commandBuffer, "Frame");
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!enabled) return;
+
+	FrameSlot& slot = frameSlots[recordingSlot];
+
+	//Drop the scope if there is no room left for both of its queries
+	if (slot.queryCount + 2 > MAX_GPU_QUERIES_PER_FRAME)
+	{
+		openScopes.push_back(-1);
+		return;
+	}
+
+	RecordedScope scope = {};
+	scope.scopeId = getScopeId(name);
+	scope.beginQuery = recordingSlot * MAX_GPU_QUERIES_PER_FRAME + slot.queryCount;
+	scope.endQuery = scope.beginQuery + 1;
+	slot.queryCount += 2;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, scope.beginQuery);
+
+	openScopes.push_back(static_cast<int>(slot.scopes.size()));
+	slot.scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer)
+{
+	if (!enabled || openScopes.empty()) return;
+
+	int scopeIndex = openScopes.back();
+	openScopes.pop_back();
+	if (scopeIndex < 0) return;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+		frameSlots[recordingSlot].scopes[scopeIndex].endQuery);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer)
+{
+	if (!enabled) return;
+
+	//Close anything left open, including the "Frame" scope
+	while (!openScopes.empty())
+	{
+		endScope(commandBuffer);
+	}
+}
+
+void GpuProfiler::markSubmit(uint32_t frameSlot, int64_t cpuTimeNs)
+{
+	if (!enabled) return;
+
+	frameSlots[frameSlot].submitNs = cpuTimeNs;
+}
+
+void GpuProfiler::collect(uint32_t frameSlot)
+{
+	if (!enabled) return;
+
+	FrameSlot& slot = frameSlots[frameSlot];
+	if (slot.queryCount == 0) return;
+
+	//Each query returns its value followed by its availability, no WAIT bit so this can never stall
+	uint32_t firstQuery = frameSlot * MAX_GPU_QUERIES_PER_FRAME;
+	std::vector<uint64_t> results(slot.queryCount * 2);
+	VkResult result = vkGetQueryPoolResults(device, queryPool, firstQuery, slot.queryCount,
+		results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		return;
+	}
+
+	//The first scope is always "Frame", everything else is resolved relative to its begin
+	GpuFrameTiming frameTiming = {};
+	frameTiming.frameNumber = slot.frameNumber;
+	frameTiming.submitNs = slot.submitNs;
+	uint64_t frameBegin = results[1] != 0 ? results[0] : 0;
+
+	for (const auto& recorded : slot.scopes)
+	{
+		size_t beginIndex = (recorded.beginQuery - firstQuery) * 2;
+		size_t endIndex = (recorded.endQuery - firstQuery) * 2;
+
+		//Skip scopes whose timestamps are not both available yet
+		if (results[beginIndex + 1] == 0 || results[endIndex + 1] == 0)
+		{
+			continue;
+		}
+
+		uint64_t ticks = (results[endIndex] - results[beginIndex]) & timestampMask;
+		double ms = static_cast<double>(ticks) * timestampPeriod / 1000000.0;
+
+		if (results[1] != 0)
+		{
+			GpuScopeTiming timing = {};
+			timing.name = scopes[recorded.scopeId].name;
+			timing.depth = scopes[recorded.scopeId].depth;
+			timing.beginNs = static_cast<int64_t>(((results[beginIndex] - frameBegin) & timestampMask) * timestampPeriod);
+			timing.endNs = static_cast<int64_t>(((results[endIndex] - frameBegin) & timestampMask) * timestampPeriod);
+			frameTiming.scopes.push_back(timing);
+		}
+
+		ScopeHistory& history = scopes[recorded.scopeId];
+		history.samples[history.nextSample] = ms;
+		history.nextSample = (history.nextSample + 1) % GPU_PROFILER_SAMPLE_WINDOW;
+		history.sampleCount++;
+		history.lastMs = ms;
+	}
+
+	if (!frameTiming.scopes.empty() && slot.submitNs != 0)
+	{
+		frameHistory.push_back(frameTiming);
+		if (frameHistory.size() > GPU_PROFILER_FRAME_HISTORY)
+		{
+			frameHistory.pop_front();
+		}
+	}
+
+	//Slot results consumed, don't read them again
+	slot.queryCount = 0;
+	collectedFrames++;
+
+	if (logInterval > 0 && collectedFrames % logInterval == 0)
+	{
+		printStats();
+	}
+}
+
+std::vector<GpuScopeStats> GpuProfiler::getScopeStats()
+{
+	std::vector<GpuScopeStats> statsList;
+
+	for (const auto& history : scopes)
+	{
+		GpuScopeStats stats = {};
+		stats.name = history.name;
+		stats.depth = history.depth;
+		stats.sampleCount = history.sampleCount;
+		stats.lastMs = history.lastMs;
+
+		//Only the filled part of the window holds real samples
+		size_t filled = static_cast<size_t>(std::min<uint64_t>(history.sampleCount, GPU_PROFILER_SAMPLE_WINDOW));
+		if (filled > 0)
+		{
+			std::vector<double> window(history.samples.begin(), history.samples.begin() + filled);
+
+			double total = 0.0;
+			stats.minMs = window[0];
+			for (double sample : window)
+			{
+				total += sample;
+				stats.minMs = std::min(stats.minMs, sample);
+			}
+			stats.avgMs = total / filled;
+			stats.p99Ms = percentile(window, 0.99);
+		}
+
+		statsList.push_back(stats);
+	}
+
+	return statsList;
+}
+
+void GpuProfiler::printStats()
+{
+	std::vector<GpuScopeStats> statsList = getScopeStats();
+
+	printf("GPU");
+	for (const auto& stats : statsList)
+	{
+		printf(" | %s: avg %.3f ms (min %.3f, p99 %.3f)", stats.name.c_str(), stats.avgMs, stats.minMs, stats.p99Ms);
+	}
+	printf("\n");
+}
+
+GpuProfiler::~GpuProfiler()
+{
+}
+
+int GpuProfiler::getScopeId(const char* name)
+{
+	auto found = scopeIds.find(name);
+	if (found != scopeIds.end())
+	{
+		return found->second;
+	}
+
+	//First time this scope is seen, register it at the current nesting depth
+	ScopeHistory history;
+	history.name = name;
+	history.depth = static_cast<int>(openScopes.size());
+	history.samples.resize(GPU_PROFILER_SAMPLE_WINDOW, 0.0);
+
+	int scopeId = static_cast<int>(scopes.size());
+	scopes.push_back(history);
+	scopeIds[history.name] = scopeId;
+
+	return scopeId;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<unordered_map>
+#include<deque>
+#include<stdexcept>
+#include"Utilities.h"
+
+const uint32_t MAX_GPU_QUERIES_PER_FRAME = 128;		//Timestamp queries available to one frame (2 per scope)
+const uint32_t GPU_PROFILER_SAMPLE_WINDOW = 256;	//Number of recent samples each scope keeps for min/avg/p99
+const uint32_t GPU_PROFILER_FRAME_HISTORY = 256;	//Number of resolved frames kept for trace export
+
+//Timing summary of one profiled scope over its recent samples
+struct GpuScopeStats
+{
+	std::string name;
+	int depth;						//Nesting depth (0 = whole frame)
+	uint64_t sampleCount;		//Total samples collected since start
+	double lastMs;
+	double minMs;
+	double avgMs;
+	double p99Ms;
+};
+
+//Resolved begin/end of one scope, in nanoseconds from the start of its frame
+struct GpuScopeTiming
+{
+	std::string name;
+	int depth;
+	int64_t beginNs;
+	int64_t endNs;
+};
+
+//All scopes of one collected frame, placed on the CPU timeline at the time it was submitted
+struct GpuFrameTiming
+{
+	uint64_t frameNumber;
+	int64_t submitNs;
+	std::vector<GpuScopeTiming> scopes;
+};
+
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, uint32_t frameSlotCount);
+	void destroy();
+
+	bool isEnabled() { return enabled; };
+
+	//Print stats every given number of collected frames (0 disables the log line)
+	void setLogInterval(uint32_t frames) { logInterval = frames; };
+
+	//-Record Functions (called while recording the frame's command buffer)
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameNumber);
+	void beginScope(VkCommandBuffer commandBuffer, const char* name);
+	void endScope(VkCommandBuffer commandBuffer);
+	void endFrame(VkCommandBuffer commandBuffer);
+
+	//CPU time (CpuProfiler::now) at which the frame slot was submitted, used to align GPU scopes with CPU zones
+	//Only called when ENABLE_CPU_PROFILER is defined, otherwise frames keep a submit time of 0
+	void markSubmit(uint32_t frameSlot, int64_t cpuTimeNs);
+
+	//-Readback Function (only call once the fence of the frame slot has signalled, never waits on the GPU)
+	void collect(uint32_t frameSlot);
+
+	std::vector<GpuScopeStats> getScopeStats();
+	void printStats();
+
+	const std::deque<GpuFrameTiming>& getFrameHistory() { return frameHistory; };
+
+	~GpuProfiler();
+
+private:
+	//A begin/end timestamp pair written into a frame slot
+	struct RecordedScope
+	{
+		int scopeId;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	//Queries written by the frame that last used this slot of the ring
+	struct FrameSlot
+	{
+		std::vector<RecordedScope> scopes;
+		uint32_t queryCount = 0;
+		uint64_t frameNumber = 0;
+		int64_t submitNs = 0;
+	};
+
+	//Rolling sample history of one named scope
+	struct ScopeHistory
+	{
+		std::string name;
+		int depth;
+		std::vector<double> samples;
+		size_t nextSample = 0;
+		uint64_t sampleCount = 0;
+		double lastMs = 0.0;
+	};
+
+	bool enabled = false;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+
+	double timestampPeriod = 1.0;		//Nanoseconds per timestamp tick
+	uint64_t timestampMask = ~0ull;	//Only timestampValidBits of a result are meaningful
+
+	std::vector<FrameSlot> frameSlots;
+	uint32_t recordingSlot = 0;
+	std::vector<int> openScopes;		//Index into recording slot scopes (-1 if scope was dropped)
+
+	std::vector<ScopeHistory> scopes;
+	std::unordered_map<std::string, int> scopeIds;
+
+	std::deque<GpuFrameTiming> frameHistory;
+
+	uint64_t collectedFrames = 0;
+	uint32_t logInterval = 0;
+
+	int getScopeId(const char* name);
+};
@@ -0,0 +1,118 @@
+#include "ImageWriter.h"
+#include<fstream>
+#include<array>
+#include<algorithm>
+
+//Big endian, as everything in PNG
+static void appendUint32(std::vector<uint8_t>& bytes, uint32_t value)
+{
+	bytes.push_back(static_cast<uint8_t>(value >> 24));
+	bytes.push_back(static_cast<uint8_t>(value >> 16));
+	bytes.push_back(static_cast<uint8_t>(value >> 8));
+	bytes.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ImageWriter::crc32(const uint8_t* data, size_t length, uint32_t crc)
+{
+	static const std::array<uint32_t, 256> table = []()
+	{
+		std::array<uint32_t, 256> newTable;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+			}
+			newTable[i] = value;
+		}
+		return newTable;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+void ImageWriter::appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+{
+	appendUint32(png, static_cast<uint32_t>(data.size()));
+
+	size_t typeStart = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+
+	//CRC covers type and data, not the length
+	appendUint32(png, crc32(png.data() + typeStart, png.size() - typeStart));
+}
+
+std::vector<uint8_t> ImageWriter::encodePng(uint32_t width, uint32_t height, const uint8_t* pixels, uint32_t rowPitch)
+{
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	std::vector<uint8_t> header;
+	appendUint32(header, width);
+	appendUint32(header, height);
+	header.push_back(8);		//Bit depth
+	header.push_back(6);		//Color type RGBA
+	header.push_back(0);		//Compression
+	header.push_back(0);		//Filter method
+	header.push_back(0);		//No interlace
+	appendChunk(png, "IHDR", header);
+
+	//Every row starts with filter type 0 (none)
+	size_t rowBytes = static_cast<size_t>(width) * 4;
+	std::vector<uint8_t> raw;
+	raw.reserve((rowBytes + 1) * height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		const uint8_t* row = pixels + static_cast<size_t>(y) * rowPitch;
+		raw.insert(raw.end(), row, row + rowBytes);
+	}
+
+	//zlib stream of stored deflate blocks (max 65535 bytes each) and the adler32 of the raw data
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+		bool lastBlock = offset + blockSize == raw.size();
+		zlib.push_back(lastBlock ? 1 : 0);
+		zlib.push_back(static_cast<uint8_t>(blockSize));
+		zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+		zlib.push_back(static_cast<uint8_t>(~blockSize));
+		zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < raw.size());
+
+	uint32_t adlerA = 1, adlerB = 0;
+	for (uint8_t byte : raw)
+	{
+		adlerA = (adlerA + byte) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	appendUint32(zlib, (adlerB << 16) | adlerA);
+	appendChunk(png, "IDAT", zlib);
+
+	appendChunk(png, "IEND", std::vector<uint8_t>());
+	return png;
+}
+
+bool ImageWriter::writePng(const std::string& fileName, uint32_t width, uint32_t height, const uint8_t* pixels, uint32_t rowPitch)
+{
+	std::vector<uint8_t> png = encodePng(width, height, pixels, rowPitch);
+
+	std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(png.data()), png.size());
+	return file.good();
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include<string>
+#include<vector>
+#include<cstdint>
+
+//Encoders for rendered frames (8 bit RGBA in, rows rowPitch bytes apart)
+class ImageWriter
+{
+public:
+	//Uncompressed (stored deflate) PNG: fast to write, any PNG reader can load it
+	static std::vector<uint8_t> encodePng(uint32_t width, uint32_t height, const uint8_t* pixels, uint32_t rowPitch);
+	static bool writePng(const std::string& fileName, uint32_t width, uint32_t height, const uint8_t* pixels, uint32_t rowPitch);
+
+private:
+	static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+	static void appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data);
+};
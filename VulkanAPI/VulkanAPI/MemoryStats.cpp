@@ -0,0 +1,101 @@
+#include "MemoryStats.h"
+#include<algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include<windows.h>
+#include<psapi.h>
+#else
+#include<fstream>
+#include<unistd.h>
+#endif
+
+VkResult MemoryStats::allocate(VkDevice device, const VkMemoryAllocateInfo* allocateInfo, VkDeviceMemory* memory)
+{
+	VkResult result = vkAllocateMemory(device, allocateInfo, nullptr, memory);
+	if (result != VK_SUCCESS)
+	{
+		return result;
+	}
+
+	std::lock_guard<std::mutex> lock(getMutex());
+	getAllocations()[*memory] = allocateInfo->allocationSize;
+
+	DeviceMemoryUsage& usage = getUsage();
+	usage.allocatedBytes += allocateInfo->allocationSize;
+	usage.peakBytes = std::max(usage.peakBytes, usage.allocatedBytes);
+	usage.allocationCount++;
+
+	return result;
+}
+
+void MemoryStats::free(VkDevice device, VkDeviceMemory memory)
+{
+	if (memory != VK_NULL_HANDLE)
+	{
+		std::lock_guard<std::mutex> lock(getMutex());
+		auto allocation = getAllocations().find(memory);
+		if (allocation != getAllocations().end())
+		{
+			DeviceMemoryUsage& usage = getUsage();
+			usage.allocatedBytes -= allocation->second;
+			usage.allocationCount--;
+			getAllocations().erase(allocation);
+		}
+	}
+
+	vkFreeMemory(device, memory, nullptr);
+}
+
+DeviceMemoryUsage MemoryStats::getDeviceUsage()
+{
+	std::lock_guard<std::mutex> lock(getMutex());
+	return getUsage();
+}
+
+void MemoryStats::resetPeak()
+{
+	std::lock_guard<std::mutex> lock(getMutex());
+	DeviceMemoryUsage& usage = getUsage();
+	usage.peakBytes = usage.allocatedBytes;
+}
+
+uint64_t MemoryStats::getProcessResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	//Second field of statm is the resident set size in pages
+	std::ifstream statm("/proc/self/statm");
+	uint64_t totalPages = 0;
+	uint64_t residentPages = 0;
+	if (statm >> totalPages >> residentPages)
+	{
+		return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	}
+	return 0;
+#endif
+}
+
+std::mutex& MemoryStats::getMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+std::unordered_map<VkDeviceMemory, VkDeviceSize>& MemoryStats::getAllocations()
+{
+	static std::unordered_map<VkDeviceMemory, VkDeviceSize> allocations;
+	return allocations;
+}
+
+DeviceMemoryUsage& MemoryStats::getUsage()
+{
+	static DeviceMemoryUsage usage;
+	return usage;
+}
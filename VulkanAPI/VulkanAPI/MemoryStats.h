@@ -0,0 +1,32 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<unordered_map>
+#include<mutex>
+
+//Device memory currently held by the renderer
+struct DeviceMemoryUsage
+{
+	uint64_t allocatedBytes = 0;
+	uint64_t peakBytes = 0;			//Highest allocatedBytes seen since start
+	uint32_t allocationCount = 0;		//Live vkAllocateMemory allocations
+};
+
+//Tracks every vkAllocateMemory/vkFreeMemory made through allocate/free, so benchmarks can report device memory
+class MemoryStats
+{
+public:
+	static VkResult allocate(VkDevice device, const VkMemoryAllocateInfo* allocateInfo, VkDeviceMemory* memory);
+	static void free(VkDevice device, VkDeviceMemory memory);
+
+	static DeviceMemoryUsage getDeviceUsage();
+	static void resetPeak();		//Start peak tracking again from the current usage
+
+	//Resident memory of the whole process (0 if the platform can't tell)
+	static uint64_t getProcessResidentBytes();
+
+private:
+	static std::mutex& getMutex();
+	static std::unordered_map<VkDeviceMemory, VkDeviceSize>& getAllocations();
+	static DeviceMemoryUsage& getUsage();
+};
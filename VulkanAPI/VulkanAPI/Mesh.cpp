@@ -32,10 +32,10 @@ Model& Mesh::getModel()
 void Mesh::destroyBuffers()
 {
 	vkDestroyBuffer(device,vertexBuffer,nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	MemoryStats::free(device, vertexBufferMemory);
 
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
+	MemoryStats::free(device, indexBufferMemory);
 }
 
 Mesh::~Mesh()
@@ -72,7 +72,7 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 
 	//Clean up staging buffer parts
 	vkDestroyBuffer(device, stagingBuffer,nullptr);
-	vkFreeMemory(device, stagingBufferMemory,nullptr);
+	MemoryStats::free(device, stagingBufferMemory);
 }
 
 void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices)
@@ -102,7 +102,7 @@ void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
 
 	//Destory + Release Staging Buffer resources
 	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	MemoryStats::free(device, stagingBufferMemory);
 }
 
 
@@ -1,4 +1,5 @@
 #include "MeshModel.h"
+#include "CpuProfiler.h"
 
 MeshModel::MeshModel()
 {
@@ -29,6 +30,8 @@ void MeshModel::destroyModel()
 
 std::vector<std::string> MeshModel::LoadMaterials(const aiScene* scene)
 {
+	CPU_PROFILE_FUNCTION();
+
 	//Create 1:1 sized list of texture
 	std::vector<std::string> textureList(scene->mNumMaterials);
 
@@ -62,6 +65,8 @@ std::vector<std::string> MeshModel::LoadMaterials(const aiScene* scene)
 
 std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newLogicalDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode* node, const aiScene* scene, std::vector<int> matToTex)
 {
+	CPU_PROFILE_FUNCTION();
+
 	std::vector<Mesh> meshList;
 
 	//Go through each mesh at this node and create it, then add it to our meshList
@@ -82,8 +87,43 @@ std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevi
 
 Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newLogicalDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh* mesh, const aiScene* scene, std::vector<int> matToTex)
 {
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+	CPU_PROFILE_FUNCTION();
+
+	MeshData meshData = ExtractMesh(mesh);
+
+	//Create new mesh with details and return it
+	Mesh newMesh = Mesh(newPhysicalDevice, newLogicalDevice, transferQueue, transferCommandPool,&meshData.vertices,&meshData.indices,matToTex[meshData.materialIndex]);
+
+	return newMesh;
+}
+
+std::vector<MeshData> MeshModel::ExtractNode(aiNode* node, const aiScene* scene)
+{
+	std::vector<MeshData> meshDataList;
+
+	//Same traversal order as LoadNode, so mesh order matches
+	for (size_t i = 0; i < node->mNumMeshes; i++)
+	{
+		meshDataList.push_back(ExtractMesh(scene->mMeshes[node->mMeshes[i]]));
+	}
+
+	for (size_t i = 0; i < node->mNumChildren; i++)
+	{
+		std::vector<MeshData> newList = ExtractNode(node->mChildren[i], scene);
+		meshDataList.insert(meshDataList.end(), std::make_move_iterator(newList.begin()), std::make_move_iterator(newList.end()));
+	}
+
+	return meshDataList;
+}
+
+MeshData MeshModel::ExtractMesh(aiMesh* mesh)
+{
+	CPU_PROFILE_FUNCTION();
+
+	MeshData meshData;
+	std::vector<Vertex>& vertices = meshData.vertices;
+	std::vector<uint32_t>& indices = meshData.indices;
+	meshData.materialIndex = mesh->mMaterialIndex;
 
 	//Resize vertex list to hold all vertices for mesh
 	vertices.resize(mesh->mNumVertices);
@@ -121,11 +161,7 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newLogical
 		}
 	}
 
-
-	//Create new mesh with details and return it
-	Mesh newMesh = Mesh(newPhysicalDevice, newLogicalDevice, transferQueue, transferCommandPool,&vertices,&indices,matToTex[mesh->mMaterialIndex]);
-
-	return newMesh;
+	return meshData;
 }
 
 MeshModel::~MeshModel()
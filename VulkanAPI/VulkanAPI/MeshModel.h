@@ -4,6 +4,15 @@
 #include<glm/glm.hpp>
 #include"Mesh.h"
 #include<assimp/scene.h>
+
+//CPU side data of one mesh, ready to be uploaded
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	unsigned int materialIndex = 0;
+};
+
 class MeshModel
 {
 public:
@@ -19,6 +28,12 @@ public:
 	void destroyModel();
 
 	static std::vector<std::string> LoadMaterials(const aiScene* scene);
+
+	//-Extract Functions (CPU only, no device needed)
+	static std::vector<MeshData> ExtractNode(aiNode* node, const aiScene* scene);
+	static MeshData ExtractMesh(aiMesh* mesh);
+
+	//-Load Functions (extract + upload)
 	static std::vector<Mesh> LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newLogicalDevice, VkQueue transferQueue, VkCommandPool transferCommandPool,
 		aiNode* node, const aiScene* scene, std::vector<int> matToTex);
 	static Mesh LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newLogicalDevice, VkQueue transferQueue, VkCommandPool transferCommandPool,
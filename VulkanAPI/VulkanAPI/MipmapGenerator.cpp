@@ -0,0 +1,332 @@
+#include "MipmapGenerator.h"
+
+namespace
+{
+	const uint32_t MIPMAP_GROUP_SIZE = 8;		//local_size_x/y of mipmap.comp
+
+	void recordLevelBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel, uint32_t levelCount,
+		VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+		VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+	{
+		VkImageMemoryBarrier imageMemoryBarrier = {};
+		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageMemoryBarrier.oldLayout = oldLayout;
+		imageMemoryBarrier.newLayout = newLayout;
+		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.image = image;
+		imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageMemoryBarrier.subresourceRange.baseMipLevel = baseLevel;
+		imageMemoryBarrier.subresourceRange.levelCount = levelCount;
+		imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+		imageMemoryBarrier.subresourceRange.layerCount = 1;
+		imageMemoryBarrier.srcAccessMask = srcAccess;
+		imageMemoryBarrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+	}
+}
+
+MipmapGenerator::MipmapGenerator()
+{
+}
+
+void MipmapGenerator::init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, ShaderReflection* newShaderReflection)
+{
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+	shaderReflection = newShaderReflection;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyList.data());
+	computeQueue = queueFamilyIndex < queueFamilyCount && (queueFamilyList[queueFamilyIndex].queueFlags & VK_QUEUE_COMPUTE_BIT);
+}
+
+void MipmapGenerator::destroy()
+{
+	releaseUploadResources();
+	descriptorAllocator.destroy();
+	if (computePipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, computePipeline, nullptr);
+		vkDestroyPipelineLayout(device, computePipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, computeSetLayout, nullptr);
+		computePipeline = VK_NULL_HANDLE;
+		computePipelineLayout = VK_NULL_HANDLE;
+		computeSetLayout = VK_NULL_HANDLE;
+	}
+	formatPaths.clear();
+}
+
+uint32_t MipmapGenerator::getMipLevels(VkFormat format, uint32_t width, uint32_t height)
+{
+	if (getPath(format) == Path::None) return 1;
+
+	//Halve the larger side until it reaches 1
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+	{
+		levels++;
+	}
+	return levels;
+}
+
+VkImageUsageFlags MipmapGenerator::getImageUsage(VkFormat format)
+{
+	switch (getPath(format))
+	{
+	case Path::Blit: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;		//Each level is the source of the next
+	case Path::Compute: return VK_IMAGE_USAGE_STORAGE_BIT;
+	default: return 0;
+	}
+}
+
+void MipmapGenerator::record(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	if (mipLevels > 1 && getPath(format) == Path::Blit)
+	{
+		recordBlit(commandBuffer, image, width, height, mipLevels);
+	}
+	else if (mipLevels > 1 && getPath(format) == Path::Compute)
+	{
+		recordCompute(commandBuffer, image, format, width, height, mipLevels);
+	}
+	else
+	{
+		recordLevelBarrier(commandBuffer, image, 0, mipLevels,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+}
+
+void MipmapGenerator::releaseUploadResources()
+{
+	for (VkImageView imageView : uploadImageViews)
+	{
+		vkDestroyImageView(device, imageView, nullptr);
+	}
+	uploadImageViews.clear();
+
+	//Sets only live for one upload, resetting keeps the pools for the next one
+	if (computePipeline != VK_NULL_HANDLE)
+	{
+		descriptorAllocator.reset();
+	}
+}
+
+MipmapGenerator::Path MipmapGenerator::getPath(VkFormat format)
+{
+	auto known = formatPaths.find(static_cast<int>(format));
+	if (known != formatPaths.end()) return known->second;
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	VkFormatFeatureFlags features = formatProperties.optimalTilingFeatures;
+
+	//Linear filtering is what makes a blit a box filter, without it levels would be point sampled
+	const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+		VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	//The compute shader declares its images rgba8
+	Path path = Path::None;
+	if ((features & blitFeatures) == blitFeatures)
+	{
+		path = Path::Blit;
+	}
+	else if (computeQueue && format == VK_FORMAT_R8G8B8A8_UNORM && (features & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+	{
+		path = Path::Compute;
+	}
+
+	formatPaths[static_cast<int>(format)] = path;
+	return path;
+}
+
+void MipmapGenerator::recordBlit(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	int32_t levelWidth = static_cast<int32_t>(width);
+	int32_t levelHeight = static_cast<int32_t>(height);
+
+	for (uint32_t level = 1; level < mipLevels; level++)
+	{
+		//Previous level has been written, read it as the blit source
+		recordLevelBarrier(commandBuffer, image, level - 1, 1,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		int32_t nextWidth = std::max(levelWidth / 2, 1);
+		int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+		VkImageBlit blit = {};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { levelWidth, levelHeight, 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+
+		//Source level is finished
+		recordLevelBarrier(commandBuffer, image, level - 1, 1,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	//Last level was only ever written
+	recordLevelBarrier(commandBuffer, image, mipLevels - 1, 1,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void MipmapGenerator::recordCompute(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	if (computePipeline == VK_NULL_HANDLE)
+	{
+		createComputePipeline();
+	}
+
+	//Whole chain is read and written as storage images
+	recordLevelBarrier(commandBuffer, image, 0, mipLevels,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	for (uint32_t level = 1; level < mipLevels; level++)
+	{
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+
+		VkDescriptorImageInfo levelInfos[2] = {};
+		levelInfos[0].imageView = createLevelView(image, format, level - 1);
+		levelInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelInfos[1].imageView = createLevelView(image, format, level);
+		levelInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		//srcLevel = binding 0, dstLevel = binding 1
+		VkDescriptorSet descriptorSet = descriptorAllocator.allocate(computeSetLayout);
+		VkWriteDescriptorSet setWrites[2] = {};
+		for (uint32_t binding = 0; binding < 2; binding++)
+		{
+			setWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			setWrites[binding].dstSet = descriptorSet;
+			setWrites[binding].dstBinding = binding;
+			setWrites[binding].dstArrayElement = 0;
+			setWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			setWrites[binding].descriptorCount = 1;
+			setWrites[binding].pImageInfo = &levelInfos[binding];
+		}
+		vkUpdateDescriptorSets(device, 2, setWrites, 0, nullptr);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		vkCmdDispatch(commandBuffer, (levelWidth + MIPMAP_GROUP_SIZE - 1) / MIPMAP_GROUP_SIZE, (levelHeight + MIPMAP_GROUP_SIZE - 1) / MIPMAP_GROUP_SIZE, 1);
+
+		//Next dispatch reads this level
+		recordLevelBarrier(commandBuffer, image, level, 1,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	}
+
+	recordLevelBarrier(commandBuffer, image, 0, mipLevels,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void MipmapGenerator::createComputePipeline()
+{
+	//Layout reflected from the shader like the graphics passes: set 0 = srcLevel, dstLevel
+	const ShaderLayout& layout = shaderReflection->getLayout({ MIPMAP_COMPUTE_SHADER });
+	computeSetLayout = layout.createSetLayout(device, 0);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &computeSetLayout;
+	VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &computePipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Mipmap Pipeline Layout!");
+	}
+
+	std::vector<char> code = readFile(MIPMAP_COMPUTE_SHADER);
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = code.size();
+	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	result = vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to craate a shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = shaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.layout = computePipelineLayout;
+	result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &computePipeline);
+
+	//Module is only needed while creating the pipeline
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the Mipmap Compute Pipeline!");
+	}
+
+	//One set per level, a 4k texture has 13 levels
+	descriptorAllocator.init(device, 16);
+	descriptorAllocator.registerLayout(computeSetLayout, layout.getPoolSizes(0, 1));
+}
+
+VkImageView MipmapGenerator::createLevelView(VkImage image, VkFormat format, uint32_t level)
+{
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = image;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = format;
+	viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewCreateInfo.subresourceRange.baseMipLevel = level;		//Storage image views may only see one level
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+
+	VkImageView imageView;
+	VkResult result = vkCreateImageView(device, &viewCreateInfo, nullptr, &imageView);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create an Image View!");
+	}
+	uploadImageViews.push_back(imageView);
+	return imageView;
+}
+
+MipmapGenerator::~MipmapGenerator()
+{
+}
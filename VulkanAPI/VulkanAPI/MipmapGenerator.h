@@ -0,0 +1,62 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<vector>
+#include<unordered_map>
+#include<stdexcept>
+#include"Utilities.h"
+#include"ShaderReflection.h"
+#include"DescriptorAllocator.h"
+
+//Fills the mip chain of an uploaded texture on the GPU. Formats with linear blit support are downsampled
+//with vkCmdBlitImage, RGBA8 images without it with a compute shader, anything else keeps a single level.
+class MipmapGenerator
+{
+public:
+	MipmapGenerator();
+
+	//queueFamilyIndex: family the upload commands are submitted to, the compute path needs it to support compute
+	void init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, ShaderReflection* newShaderReflection);
+	void destroy();
+
+	//Levels down to 1x1, or 1 when the format can't be downsampled
+	uint32_t getMipLevels(VkFormat format, uint32_t width, uint32_t height);
+
+	//Usage the image needs on top of TRANSFER_DST | SAMPLED
+	VkImageUsageFlags getImageUsage(VkFormat format);
+
+	//Every level in TRANSFER_DST_OPTIMAL with level 0 written, leaves every level SHADER_READ_ONLY_OPTIMAL
+	void record(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+	//Once the recorded commands have finished: frees the per level views and sets of the compute path
+	void releaseUploadResources();
+
+	~MipmapGenerator();
+
+private:
+	enum class Path
+	{
+		None,
+		Blit,
+		Compute
+	};
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	ShaderReflection* shaderReflection = nullptr;
+	bool computeQueue = false;
+	std::unordered_map<int, Path> formatPaths;		//By VkFormat, queried once
+
+	//-Compute path, created on first use
+	VkDescriptorSetLayout computeSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout computePipelineLayout = VK_NULL_HANDLE;
+	VkPipeline computePipeline = VK_NULL_HANDLE;
+	DescriptorAllocator descriptorAllocator;
+	std::vector<VkImageView> uploadImageViews;		//Single level views of uploads in flight
+
+	Path getPath(VkFormat format);
+	void recordBlit(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+	void recordCompute(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+	void createComputePipeline();
+	VkImageView createLevelView(VkImage image, VkFormat format, uint32_t level);
+};
@@ -0,0 +1,580 @@
+#include "PipelineBuilder.h"
+#include "CpuProfiler.h"
+#include<array>
+
+//FNV-1a, so hashes can be compared between runs and machines
+static void hashBytes(uint64_t* hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		*hash ^= bytes[i];
+		*hash *= 1099511628211ull;
+	}
+}
+
+static void hashValue(uint64_t* hash, uint32_t value)
+{
+	hashBytes(hash, &value, sizeof(value));
+}
+
+uint64_t PipelineDescription::getHash() const
+{
+	uint64_t hash = 14695981039346656037ull;
+	hashBytes(&hash, vertexShaderFile.data(), vertexShaderFile.size());
+	hashValue(&hash, 0);		//Separator, so "ab"+"c" and "a"+"bc" differ
+	hashBytes(&hash, fragmentShaderFile.data(), fragmentShaderFile.size());
+	hashValue(&hash, 0);
+	uint64_t permutationHashes[] = { vertexPermutation.getHash(), fragmentPermutation.getHash() };
+	hashBytes(&hash, permutationHashes, sizeof(permutationHashes));
+	hashValue(&hash, subpass);
+	hashValue(&hash, extent.width);
+	hashValue(&hash, extent.height);
+	hashValue(&hash, static_cast<uint32_t>(vertexLayout));
+	hashValue(&hash, static_cast<uint32_t>(state.cullMode));
+	hashValue(&hash, static_cast<uint32_t>(state.polygonMode));
+	hashValue(&hash, static_cast<uint32_t>(state.topology));
+	hashValue(&hash, static_cast<uint32_t>(state.blend));
+	hashValue(&hash, state.depthTest ? 1 : 0);
+	hashValue(&hash, state.depthWrite ? 1 : 0);
+	return hash;
+}
+
+bool PipelineDescription::operator==(const PipelineDescription& other) const
+{
+	//Name is only a label, two materials with the same state share one pipeline
+	return vertexShaderFile == other.vertexShaderFile && fragmentShaderFile == other.fragmentShaderFile &&
+		vertexPermutation == other.vertexPermutation && fragmentPermutation == other.fragmentPermutation &&
+		layout == other.layout && renderPass == other.renderPass && subpass == other.subpass &&
+		extent.width == other.extent.width && extent.height == other.extent.height && vertexLayout == other.vertexLayout &&
+		state == other.state;
+}
+
+//Fixed-function state of one description, kept in one place so the pointers between the structs stay valid
+struct PipelineState
+{
+	VkVertexInputBindingDescription bindingDescription;
+	std::array<VkVertexInputAttributeDescription, 3> attritubeDescriptions;
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
+	VkViewport viewPort;
+	VkRect2D scissor;
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo;
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateinfo;
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo;
+	VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
+	VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo;
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo;
+
+	PipelineState(const PipelineDescription& description);
+	PipelineState(const PipelineState&) = delete;
+};
+
+PipelineState::PipelineState(const PipelineDescription& description)
+{
+	// how the data for a single vertex (including info such as position, color, texture, coords, normals, etc) is as a whole 
+	bindingDescription = {};
+	bindingDescription.binding = 0;		//Can bind multiple streams of data, this defines which one
+	bindingDescription.stride = sizeof(Vertex);		//Size of single vertex object
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		//How to move between data after each vertex
+
+	//Postion Attritube
+	attritubeDescriptions[0].binding = 0;		//Which binding the data is at (should be same as above)
+	attritubeDescriptions[0].location = 0;		//Location in shader where data will be read from
+	attritubeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;		//Format the data will take (also helps defines size of data)
+	attritubeDescriptions[0].offset = offsetof(Vertex, pos);			//Where this attritube is defined in the data for a single vertex
+
+	//Color Attribute
+	attritubeDescriptions[1].binding = 0;	
+	attritubeDescriptions[1].location = 1;
+	attritubeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attritubeDescriptions[1].offset = offsetof(Vertex, color);			
+
+	//Texture Attribute
+	attritubeDescriptions[2].binding = 0;
+	attritubeDescriptions[2].location = 2;
+	attritubeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+	attritubeDescriptions[2].offset = offsetof(Vertex, tex);
+
+	//--Vertex Input 
+	vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	if (description.vertexLayout == VertexLayout::Standard)
+	{
+		vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+		vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;		//List of Vertex Binding Descriptions(data spacing/stride info)
+		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attritubeDescriptions.size());
+		vertexInputCreateInfo.pVertexAttributeDescriptions = attritubeDescriptions.data();		//List of Vertex Attribute Description(data format)
+	}
+
+	//--Input Assembly--
+	inputAssemblyCreateInfo = {};
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.topology = description.state.topology;		//Primitive type to assemble vertices as
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;		//Allow overriding of "strip" topology to start new primitives
+
+	//--ViewPort & Scissor
+	viewPort = {};
+	viewPort.x = 0.0f;
+	viewPort.y = 0.0f;
+	viewPort.width = (float)description.extent.width;
+	viewPort.height = (float)description.extent.height;
+	viewPort.minDepth = 0.0f;
+	viewPort.maxDepth = 1.0f;
+
+	scissor = {};
+	scissor.offset = { 0,0 };		//offset to use region from
+	scissor.extent = description.extent;		//extent to describe region to use, starting at offset
+
+	viewportStateCreateInfo = {};
+	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportStateCreateInfo.viewportCount = 1;
+	viewportStateCreateInfo.pViewports = &viewPort;
+	viewportStateCreateInfo.scissorCount = 1;
+	viewportStateCreateInfo.pScissors = &scissor;
+
+	//--Resterizer
+	rasterizerCreateinfo = {};
+	rasterizerCreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateinfo.depthClampEnable = VK_FALSE;		//change if fragements beyond near/far planes are clipped (default) or clamped to plane
+	rasterizerCreateinfo.rasterizerDiscardEnable = VK_FALSE;		//Whether to discard data and skip rasterizer. Never creates fragments, only suitable for pipeline without famebuffer output
+	rasterizerCreateinfo.polygonMode = description.state.polygonMode;		//How to handle filling points between vertices
+	rasterizerCreateinfo.lineWidth = 1.0f;		//How thick lines should be when drawn
+	rasterizerCreateinfo.cullMode = description.state.cullMode;		//which face of a tri to cull
+	rasterizerCreateinfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;		//winding to determine which side is front
+	rasterizerCreateinfo.depthBiasEnable = VK_FALSE;		//Whether to add depth bias to fragments
+
+	//--MultiSampling
+	multisamplingCreateInfo = {};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;		//enable multisample shading or not
+	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;		//Number of samples to use per fragment
+
+	//--Blending--
+	//Blend Attachment State (how blending is handled)
+	colorBlendAttachmentState = {};
+	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT		
+		| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;		//colors to apply blending to
+	colorBlendAttachmentState.blendEnable = description.state.blend != BlendMode::Opaque ? VK_TRUE : VK_FALSE;		//enable blending
+
+	//Blending uses equation:(srcColorBlendFactor * new color)  color BlendOp (dstColorBlendFactor * old color)
+	colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+	//Sumarized: (new color alpha * new color)+((1- new color alpha)*old color)
+	if (description.state.blend == BlendMode::Additive)
+	{
+		colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	}
+
+	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+	//Summarized: (1* new color alpha)+(0* old alpha)=new alpha
+
+	colorBlendStateCreateInfo = {};
+	colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;		//Alternative to calculation is to use logical operations
+	colorBlendStateCreateInfo.attachmentCount = 1;
+	colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
+
+	//--Depth Stencil Testing--
+	depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = description.state.depthTest ? VK_TRUE : VK_FALSE;		//Enable checking depth to determine fragment write
+	depthStencilCreateInfo.depthWriteEnable = description.state.depthWrite ? VK_TRUE : VK_FALSE;		//Enable writing to depth buffer (to replace old values)
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;		//Comparison operation that alllows an overwrite ( is in front)
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;		//Depth Bounds Test: Does the depth value exist between two bounds
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;		//Enable Stencil Test
+}
+
+//specializationInfo has to stay alive until the pipeline is created
+static VkPipelineShaderStageCreateInfo getShaderStage(VkShaderStageFlagBits stage, VkShaderModule shaderModule,
+	const VkSpecializationInfo* specializationInfo)
+{
+	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {};
+	shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStageCreateInfo.stage = stage;		//shader stage name
+	shaderStageCreateInfo.module = shaderModule;		//shader module to be used by stage
+	shaderStageCreateInfo.pName = "main";		//enter point in to shader
+	shaderStageCreateInfo.pSpecializationInfo = specializationInfo->mapEntryCount > 0 ? specializationInfo : nullptr;		//Constants folded in at creation
+	return shaderStageCreateInfo;
+}
+
+//Copy of the description with everything the library part doesn't depend on reset, so equal parts share one library
+static PipelineDescription getLibraryDescription(PipelineLibraryPart part, const PipelineDescription& description)
+{
+	PipelineDescription libraryDescription;
+	libraryDescription.name = description.name;
+	libraryDescription.vertexLayout = VertexLayout::None;
+	switch (part)
+	{
+	case PipelineLibraryPart::VertexInput:
+		libraryDescription.vertexLayout = description.vertexLayout;
+		libraryDescription.state.topology = description.state.topology;
+		break;
+	case PipelineLibraryPart::PreRasterization:
+		libraryDescription.vertexShaderFile = description.vertexShaderFile;
+		libraryDescription.vertexPermutation = description.vertexPermutation;
+		libraryDescription.layout = description.layout;
+		libraryDescription.renderPass = description.renderPass;
+		libraryDescription.subpass = description.subpass;
+		libraryDescription.extent = description.extent;
+		libraryDescription.state.cullMode = description.state.cullMode;
+		libraryDescription.state.polygonMode = description.state.polygonMode;
+		break;
+	case PipelineLibraryPart::FragmentShader:
+		libraryDescription.fragmentShaderFile = description.fragmentShaderFile;
+		libraryDescription.fragmentPermutation = description.fragmentPermutation;
+		libraryDescription.layout = description.layout;
+		libraryDescription.renderPass = description.renderPass;
+		libraryDescription.subpass = description.subpass;
+		libraryDescription.state.depthTest = description.state.depthTest;
+		libraryDescription.state.depthWrite = description.state.depthWrite;
+		break;
+	case PipelineLibraryPart::FragmentOutput:
+		libraryDescription.renderPass = description.renderPass;
+		libraryDescription.subpass = description.subpass;
+		libraryDescription.state.blend = description.state.blend;
+		break;
+	default:
+		break;
+	}
+	return libraryDescription;
+}
+
+PipelineBuilder::PipelineBuilder()
+{
+}
+
+void PipelineBuilder::init(VkDevice newDevice, VkPipelineCache newCache, bool useLibraries, uint32_t threadCount)
+{
+	device = newDevice;
+	cache = newCache;
+	librariesEnabled = useLibraries;
+	threadPool.start("Pipeline Builder", threadCount);
+}
+
+void PipelineBuilder::destroy()
+{
+	//A pipeline that finishes after its owner is gone would leak, so everything in flight is waited for
+	waitIdle();
+	threadPool.stop();
+
+	//Linked pipelines don't need their libraries any more, so they can go as soon as nothing links against them
+	std::lock_guard<std::mutex> lock(libraryMutex);
+	for (auto& partLibraries : libraries)
+	{
+		for (auto& library : partLibraries)
+		{
+			//A failed library has nothing to destroy
+			try
+			{
+				vkDestroyPipeline(device, library.second.get(), nullptr);
+			}
+			catch (const std::runtime_error&)
+			{
+			}
+		}
+		partLibraries.clear();
+	}
+}
+
+void PipelineBuilder::waitIdle()
+{
+	//Jobs may submit follow-up jobs (optimised links), so keep going until nothing new was added
+	while (true)
+	{
+		std::vector<std::shared_future<VkPipeline>> waiting;
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			waiting.swap(pending);
+		}
+		if (waiting.empty()) break;
+
+		for (auto& future : waiting)
+		{
+			future.wait();
+		}
+	}
+}
+
+std::shared_future<VkPipeline> PipelineBuilder::submit(const PipelineDescription& description)
+{
+	return submitJob([this, description]() { return build(description); });
+}
+
+std::shared_future<VkPipeline> PipelineBuilder::submitJob(std::function<VkPipeline()> job)
+{
+	std::shared_future<VkPipeline> future = threadPool.submit(job).share();
+
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	pending.push_back(future);
+	return future;
+}
+
+VkShaderModule PipelineBuilder::createShaderModule(const std::string& fileName)
+{
+	std::vector<char> code = readFile(fileName);
+
+	//Shader Module creation information
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = code.size();
+	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule shaderModule;
+	VkResult result = vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to craate a shader module!");
+	}
+
+	return shaderModule;
+}
+
+VkPipeline PipelineBuilder::build(const PipelineDescription& description)
+{
+	if (librariesEnabled)
+	{
+		return link(description, false);
+	}
+	return buildComplete(description);
+}
+
+VkPipeline PipelineBuilder::buildOptimized(const PipelineDescription& description)
+{
+	if (!librariesEnabled)
+	{
+		throw std::runtime_error("Optimised links need pipeline libraries!");
+	}
+	return link(description, true);
+}
+
+VkPipeline PipelineBuilder::buildComplete(const PipelineDescription& description)
+{
+	CPU_PROFILE_ZONE("Build Pipeline");
+	int64_t buildStart = CpuProfiler::now();
+
+	//Create Shader Modules
+	VkShaderModule vertexShaderModule = createShaderModule(description.vertexShaderFile);
+	VkShaderModule fragmentShaderModule = createShaderModule(description.fragmentShaderFile);
+
+	//Put shader stage creation info into array
+	//Graphics Pipline creation info requries array of shader stage creates
+	VkSpecializationInfo vertexSpecialization = description.vertexPermutation.getSpecializationInfo();
+	VkSpecializationInfo fragmentSpecialization = description.fragmentPermutation.getSpecializationInfo();
+	VkPipelineShaderStageCreateInfo shaderStages[] = { getShaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertexShaderModule, &vertexSpecialization),
+		getShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShaderModule, &fragmentSpecialization) };
+
+	PipelineState state(description);
+
+	//--Graphic Pipeline Creation--
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = 2;		//Number of shader stage
+	pipelineCreateInfo.pStages = shaderStages;		//List of shader stages
+	pipelineCreateInfo.pVertexInputState = &state.vertexInputCreateInfo;		//All the fixed function pipline states
+	pipelineCreateInfo.pInputAssemblyState = &state.inputAssemblyCreateInfo;
+	pipelineCreateInfo.pViewportState = &state.viewportStateCreateInfo;
+	pipelineCreateInfo.pDynamicState = nullptr;
+	pipelineCreateInfo.pRasterizationState = &state.rasterizerCreateinfo;
+	pipelineCreateInfo.pMultisampleState = &state.multisamplingCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &state.colorBlendStateCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &state.depthStencilCreateInfo;
+	pipelineCreateInfo.layout = description.layout;		//Pipeline layout pipeline should use
+	pipelineCreateInfo.renderPass = description.renderPass;		//Render pass description the pipline is compatible with
+	pipelineCreateInfo.subpass = description.subpass;		//Subpass of render pass to  use with pipeline
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+
+	//Destory Shader Module, no longer needed after Pipeline created
+	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Graphics pipeline " + description.name + "!");
+	}
+
+	buildCount++;
+	totalBuildMicroseconds += (CpuProfiler::now() - buildStart) / 1000;
+	return pipeline;
+}
+
+VkPipeline PipelineBuilder::link(const PipelineDescription& description, bool optimize)
+{
+#ifdef VK_EXT_graphics_pipeline_library
+	CPU_PROFILE_ZONE(optimize ? "Link Pipeline (Optimised)" : "Link Pipeline");
+
+	//Parts shared with earlier variants are already compiled, a new material usually only adds one of them
+	VkPipeline partLibraries[] = { getLibrary(PipelineLibraryPart::VertexInput, description),
+		getLibrary(PipelineLibraryPart::PreRasterization, description),
+		getLibrary(PipelineLibraryPart::FragmentShader, description),
+		getLibrary(PipelineLibraryPart::FragmentOutput, description) };
+
+	int64_t linkStart = CpuProfiler::now();
+
+	VkPipelineLibraryCreateInfoKHR libraryCreateInfo = {};
+	libraryCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	libraryCreateInfo.libraryCount = 4;
+	libraryCreateInfo.pLibraries = partLibraries;
+
+	//Without the optimisation flag the driver only stitches the parts together, which is meant to be cheap enough to do mid-frame
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = &libraryCreateInfo;
+	pipelineCreateInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+	pipelineCreateInfo.layout = description.layout;		//Same layout as the libraries, they aren't built with independent sets
+	pipelineCreateInfo.renderPass = description.renderPass;
+	pipelineCreateInfo.subpass = description.subpass;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to link Graphics pipeline " + description.name + "!");
+	}
+
+	buildCount++;
+	totalBuildMicroseconds += (CpuProfiler::now() - linkStart) / 1000;
+	return pipeline;
+#else
+	throw std::runtime_error("Built without VK_EXT_graphics_pipeline_library headers!");
+#endif
+}
+
+VkPipeline PipelineBuilder::getLibrary(PipelineLibraryPart part, const PipelineDescription& description)
+{
+	PipelineDescription libraryDescription = getLibraryDescription(part, description);
+
+	//The first thread to ask builds the library, others asking for the same part wait for it instead of building it again
+	std::promise<VkPipeline> promise;
+	std::shared_future<VkPipeline> library;
+	bool builder = false;
+	{
+		std::lock_guard<std::mutex> lock(libraryMutex);
+		LibraryMap& partLibraries = libraries[static_cast<size_t>(part)];
+		auto found = partLibraries.find(libraryDescription);
+		if (found != partLibraries.end())
+		{
+			library = found->second;
+		}
+		else
+		{
+			library = promise.get_future().share();
+			partLibraries[libraryDescription] = library;
+			builder = true;
+		}
+	}
+
+	if (builder)
+	{
+		try
+		{
+			promise.set_value(buildLibrary(part, libraryDescription));
+		}
+		catch (...)
+		{
+			promise.set_exception(std::current_exception());
+		}
+	}
+
+	return library.get();
+}
+
+VkPipeline PipelineBuilder::buildLibrary(PipelineLibraryPart part, const PipelineDescription& libraryDescription)
+{
+#ifdef VK_EXT_graphics_pipeline_library
+	CPU_PROFILE_ZONE("Build Pipeline Library");
+	int64_t buildStart = CpuProfiler::now();
+
+	PipelineState state(libraryDescription);
+
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryCreateInfo = {};
+	libraryCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+
+	//Retained link time information lets the background link optimise across the parts
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = &libraryCreateInfo;
+	pipelineCreateInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	//Each part only gets the state it owns
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	VkPipelineShaderStageCreateInfo shaderStage = {};
+	VkSpecializationInfo vertexSpecialization = libraryDescription.vertexPermutation.getSpecializationInfo();
+	VkSpecializationInfo fragmentSpecialization = libraryDescription.fragmentPermutation.getSpecializationInfo();
+	switch (part)
+	{
+	case PipelineLibraryPart::VertexInput:
+		libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+		pipelineCreateInfo.pVertexInputState = &state.vertexInputCreateInfo;
+		pipelineCreateInfo.pInputAssemblyState = &state.inputAssemblyCreateInfo;
+		break;
+	case PipelineLibraryPart::PreRasterization:
+		libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+		shaderModule = createShaderModule(libraryDescription.vertexShaderFile);
+		shaderStage = getShaderStage(VK_SHADER_STAGE_VERTEX_BIT, shaderModule, &vertexSpecialization);
+		pipelineCreateInfo.pViewportState = &state.viewportStateCreateInfo;
+		pipelineCreateInfo.pRasterizationState = &state.rasterizerCreateinfo;
+		break;
+	case PipelineLibraryPart::FragmentShader:
+		libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+		shaderModule = createShaderModule(libraryDescription.fragmentShaderFile);
+		shaderStage = getShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, shaderModule, &fragmentSpecialization);
+		pipelineCreateInfo.pMultisampleState = &state.multisamplingCreateInfo;
+		pipelineCreateInfo.pDepthStencilState = &state.depthStencilCreateInfo;
+		break;
+	case PipelineLibraryPart::FragmentOutput:
+		libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+		pipelineCreateInfo.pMultisampleState = &state.multisamplingCreateInfo;
+		pipelineCreateInfo.pColorBlendState = &state.colorBlendStateCreateInfo;
+		break;
+	default:
+		break;
+	}
+
+	if (shaderModule != VK_NULL_HANDLE)
+	{
+		pipelineCreateInfo.stageCount = 1;
+		pipelineCreateInfo.pStages = &shaderStage;
+		pipelineCreateInfo.layout = libraryDescription.layout;
+	}
+	if (part != PipelineLibraryPart::VertexInput)
+	{
+		pipelineCreateInfo.renderPass = libraryDescription.renderPass;
+		pipelineCreateInfo.subpass = libraryDescription.subpass;
+	}
+
+	VkPipeline library;
+	VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineCreateInfo, nullptr, &library);
+
+	if (shaderModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, shaderModule, nullptr);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create pipeline library for " + libraryDescription.name + "!");
+	}
+
+	libraryCount++;
+	totalBuildMicroseconds += (CpuProfiler::now() - buildStart) / 1000;
+	return library;
+#else
+	throw std::runtime_error("Built without VK_EXT_graphics_pipeline_library headers!");
+#endif
+}
+
+PipelineBuilder::~PipelineBuilder()
+{
+}
@@ -0,0 +1,141 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<array>
+#include<unordered_map>
+#include<future>
+#include<atomic>
+#include<mutex>
+#include<functional>
+#include<stdexcept>
+#include"Utilities.h"
+#include"ThreadPool.h"
+#include"ShaderPermutation.h"
+
+enum class BlendMode
+{
+	Opaque,
+	Alpha,			//src alpha * new + (1 - src alpha) * old
+	Additive
+};
+
+enum class VertexLayout
+{
+	None,			//Vertices generated in the shader (fullscreen triangle)
+	Standard		//Vertex (pos, color, tex) from binding 0
+};
+
+//Fixed-function state that differs between material variants
+struct RenderState
+{
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;		//VK_CULL_MODE_NONE for double-sided
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;		//LINE needs the fillModeNonSolid feature
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	BlendMode blend = BlendMode::Alpha;
+	bool depthTest = true;
+	bool depthWrite = true;
+
+	bool operator==(const RenderState& other) const
+	{
+		return cullMode == other.cullMode && polygonMode == other.polygonMode && topology == other.topology &&
+			blend == other.blend && depthTest == other.depthTest && depthWrite == other.depthWrite;
+	};
+	bool operator!=(const RenderState& other) const { return !(*this == other); };
+};
+
+//Everything needed to build one graphics pipeline, copied into the job so it can be built on any thread
+struct PipelineDescription
+{
+	std::string name;
+	std::string vertexShaderFile;
+	std::string fragmentShaderFile;
+	ShaderPermutation vertexPermutation;		//Specialization constants of each stage
+	ShaderPermutation fragmentPermutation;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+	VkExtent2D extent = {};		//Static viewport and scissor
+	VertexLayout vertexLayout = VertexLayout::Standard;
+	RenderState state;
+
+	//Same value in every run for the same shaders and state (handles are only compared, never hashed)
+	uint64_t getHash() const;
+	bool operator==(const PipelineDescription& other) const;
+};
+
+struct PipelineDescriptionHasher
+{
+	size_t operator()(const PipelineDescription& description) const { return static_cast<size_t>(description.getHash()); };
+};
+
+//Parts of a graphics pipeline that VK_EXT_graphics_pipeline_library compiles on their own
+enum class PipelineLibraryPart
+{
+	VertexInput,			//Vertex layout and topology
+	PreRasterization,		//Vertex shader, viewport and rasterizer
+	FragmentShader,			//Fragment shader and depth test
+	FragmentOutput,			//Blending into the subpass attachments
+	Count
+};
+
+//Builds pipelines on a thread pool against one shared VkPipelineCache (the cache is internally synchronised)
+class PipelineBuilder
+{
+public:
+	PipelineBuilder();
+
+	//useLibraries needs VK_EXT_graphics_pipeline_library with fast linking enabled on the device
+	void init(VkDevice newDevice, VkPipelineCache newCache, bool useLibraries, uint32_t threadCount = 0);
+
+	//Waits for every submitted build and stops the workers, built pipelines stay owned by the caller (libraries don't)
+	void destroy();
+
+	//Waits for every submitted build, including jobs submitted by other jobs while waiting
+	void waitIdle();
+
+	//Returns immediately, get() on the future waits for the pipeline (and rethrows a failed build)
+	std::shared_future<VkPipeline> submit(const PipelineDescription& description);
+
+	//Any job ending in a pipeline (a build plus bookkeeping), run and waited for like submit
+	std::shared_future<VkPipeline> submitJob(std::function<VkPipeline()> job);
+
+	//Same build on the calling thread
+	//With libraries this is only a fast link of the cached parts: usable straight away, but may draw slower than a full build
+	VkPipeline build(const PipelineDescription& description);
+
+	//Link-time optimised link of the same parts, meant to replace the fast link once it is done (libraries only)
+	VkPipeline buildOptimized(const PipelineDescription& description);
+
+	bool usesLibraries() { return librariesEnabled; };
+	uint32_t getBuildCount() { return buildCount; };
+	uint32_t getLibraryCount() { return libraryCount; };
+	double getTotalBuildMs() { return totalBuildMicroseconds / 1000.0; };		//Summed over all threads
+
+	~PipelineBuilder();
+
+private:
+	typedef std::unordered_map<PipelineDescription, std::shared_future<VkPipeline>, PipelineDescriptionHasher> LibraryMap;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	ThreadPool threadPool;
+	std::mutex pendingMutex;
+	std::vector<std::shared_future<VkPipeline>> pending;
+
+	//-Pipeline Libraries (keyed by the part of the description each library depends on)
+	bool librariesEnabled = false;
+	std::mutex libraryMutex;
+	std::array<LibraryMap, static_cast<size_t>(PipelineLibraryPart::Count)> libraries;
+
+	std::atomic<uint32_t> buildCount{ 0 };
+	std::atomic<uint32_t> libraryCount{ 0 };
+	std::atomic<int64_t> totalBuildMicroseconds{ 0 };
+
+	VkPipeline buildComplete(const PipelineDescription& description);
+	VkPipeline link(const PipelineDescription& description, bool optimize);
+	VkPipeline getLibrary(PipelineLibraryPart part, const PipelineDescription& description);
+	VkPipeline buildLibrary(PipelineLibraryPart part, const PipelineDescription& libraryDescription);
+	VkShaderModule createShaderModule(const std::string& fileName);
+};
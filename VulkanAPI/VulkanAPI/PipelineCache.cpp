@@ -0,0 +1,174 @@
+#include "PipelineCache.h"
+#include "CpuProfiler.h"
+#include<fstream>
+#include<cstring>
+#include<cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include<windows.h>
+#endif
+
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x43505641;		//"AVPC"
+
+PipelineCache::PipelineCache()
+{
+}
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice newDevice, const std::string& newFileName)
+{
+	device = newDevice;
+	fileName = newFileName;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	int64_t loadStart = CpuProfiler::now();
+	std::vector<char> fileData = loadFile();
+	warm = !fileData.empty() && isCompatible(fileData);
+
+	VkPipelineCacheCreateInfo cacheCreateInfo = {};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (warm)
+	{
+		cacheCreateInfo.initialDataSize = fileData.size() - sizeof(FileHeader);
+		cacheCreateInfo.pInitialData = fileData.data() + sizeof(FileHeader);
+	}
+
+	VkResult result = vkCreatePipelineCache(device, &cacheCreateInfo, nullptr, &cache);
+	if (result != VK_SUCCESS && warm)
+	{
+		//Driver rejected data that looked valid, start over without it
+		warm = false;
+		cacheCreateInfo.initialDataSize = 0;
+		cacheCreateInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(device, &cacheCreateInfo, nullptr, &cache);
+	}
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Pipeline Cache!");
+	}
+
+	loadedBytes = warm ? cacheCreateInfo.initialDataSize : 0;
+	savedBytes = loadedBytes;
+	loadMs = (CpuProfiler::now() - loadStart) / 1000000.0;
+}
+
+std::vector<char> PipelineCache::loadFile()
+{
+	std::vector<char> fileData;
+	if (fileName.empty()) return fileData;
+
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return fileData;
+
+	fileData.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(fileData.data(), fileData.size());
+	if (!file)
+	{
+		fileData.clear();
+	}
+	return fileData;
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& fileData)
+{
+	//Own header, then the driver's header (VkPipelineCacheHeaderVersionOne)
+	const size_t driverHeaderSize = 16 + VK_UUID_SIZE;
+	if (fileData.size() < sizeof(FileHeader) + driverHeaderSize) return false;
+
+	FileHeader header;
+	memcpy(&header, fileData.data(), sizeof(FileHeader));
+	if (header.magic != PIPELINE_CACHE_MAGIC || header.driverVersion != deviceProperties.driverVersion ||
+		header.dataSize != fileData.size() - sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	const char* driverData = fileData.data() + sizeof(FileHeader);
+	uint32_t driverHeader[4];
+	memcpy(driverHeader, driverData, sizeof(driverHeader));
+	if (driverHeader[0] < driverHeaderSize || driverHeader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		driverHeader[2] != deviceProperties.vendorID || driverHeader[3] != deviceProperties.deviceID)
+	{
+		return false;
+	}
+
+	return memcmp(driverData + 16, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::update(uint64_t frameNumber)
+{
+	if (cache == VK_NULL_HANDLE || fileName.empty() || frameNumber == 0 || frameNumber % PIPELINE_CACHE_SAVE_INTERVAL != 0) return;
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, cache, &dataSize, nullptr);
+	if (dataSize != savedBytes)
+	{
+		save();
+	}
+}
+
+bool PipelineCache::save()
+{
+	if (cache == VK_NULL_HANDLE || fileName.empty()) return false;
+	CPU_PROFILE_FUNCTION();
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, cache, &dataSize, nullptr);
+	std::vector<char> data(dataSize);
+	if (dataSize == 0 || vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	FileHeader header = {};
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.driverVersion = deviceProperties.driverVersion;
+	header.dataSize = dataSize;
+
+	std::string tempFileName = fileName + ".tmp";
+	{
+		std::ofstream file(tempFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			printf("Pipeline cache not saved: failed to open %s\n", tempFileName.c_str());
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), dataSize);
+		if (!file)
+		{
+			printf("Pipeline cache not saved: failed to write %s\n", tempFileName.c_str());
+			return false;
+		}
+	}
+
+	//Replace in one step, readers see either the old or the new file
+#ifdef _WIN32
+	bool renamed = MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool renamed = std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+#endif
+	if (!renamed)
+	{
+		printf("Pipeline cache not saved: failed to replace %s\n", fileName.c_str());
+		std::remove(tempFileName.c_str());
+		return false;
+	}
+
+	savedBytes = dataSize;
+	return true;
+}
+
+void PipelineCache::destroy()
+{
+	if (cache == VK_NULL_HANDLE) return;
+
+	save();
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+PipelineCache::~PipelineCache()
+{
+}
@@ -0,0 +1,56 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<stdexcept>
+
+const uint32_t PIPELINE_CACHE_SAVE_INTERVAL = 3600;		//Frames between checks for new cache data to write
+
+//VkPipelineCache kept on disk between runs, only reused on the exact device and driver that wrote it
+class PipelineCache
+{
+public:
+	PipelineCache();
+
+	//Loads the file if it was written by this device + driver, otherwise starts empty (empty fileName = never touches disk)
+	void init(VkPhysicalDevice physicalDevice, VkDevice newDevice, const std::string& newFileName);
+
+	//Writes the cache back and destroys it
+	void destroy();
+
+	VkPipelineCache getHandle() { return cache; };
+	bool isWarm() { return warm; };		//Created from a valid file
+	size_t getLoadedBytes() { return loadedBytes; };
+	double getLoadMs() { return loadMs; };
+
+	//Periodic save, only writes when the driver added data since the last write
+	void update(uint64_t frameNumber);
+
+	//Write to a temporary file and rename it over the old one, so a crash never leaves a half written cache
+	bool save();
+
+	~PipelineCache();
+
+private:
+	//Written in front of the driver's data, because its own header doesn't contain the driver version
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t driverVersion;
+		uint64_t dataSize;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties = {};
+	std::string fileName;
+
+	bool warm = false;
+	size_t loadedBytes = 0;
+	size_t savedBytes = 0;		//Driver data size at the last write
+	double loadMs = 0.0;
+
+	std::vector<char> loadFile();
+	bool isCompatible(const std::vector<char>& fileData);
+};
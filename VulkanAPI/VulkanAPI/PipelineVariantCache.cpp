@@ -0,0 +1,167 @@
+#include "PipelineVariantCache.h"
+#include "CpuProfiler.h"
+#include<algorithm>
+
+PipelineVariantCache::PipelineVariantCache()
+{
+}
+
+void PipelineVariantCache::init(VkDevice newDevice, PipelineBuilder* newBuilder)
+{
+	device = newDevice;
+	builder = newBuilder;
+}
+
+void PipelineVariantCache::destroy()
+{
+	//Optimised links are queued by the first builds, waiting on the builder covers both
+	builder->waitIdle();
+
+	std::lock_guard<std::mutex> lock(variantMutex);
+	for (auto& variant : variants)
+	{
+		//A failed build has nothing to destroy
+		if (variant->current != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, variant->current, nullptr);
+		}
+		if (variant->replaced != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, variant->replaced, nullptr);
+		}
+	}
+	variants.clear();
+	variantIds.clear();
+}
+
+int PipelineVariantCache::request(const PipelineDescription& description)
+{
+	std::lock_guard<std::mutex> lock(variantMutex);
+
+	auto found = variantIds.find(description);
+	if (found != variantIds.end())
+	{
+		hits++;
+		variants[found->second]->hits++;
+		return found->second;
+	}
+
+	misses++;
+	std::unique_ptr<Variant> newVariant(new Variant());
+	Variant* variant = newVariant.get();
+	variant->name = description.name;
+	variant->hash = description.getHash();
+
+	//The job measures itself, so time spent queued behind other builds isn't counted as compile time
+	variant->firstBuild = builder->submitJob([this, variant, description]()
+	{
+		int64_t buildStart = CpuProfiler::now();
+		VkPipeline pipeline = builder->build(description);
+		variant->compileNs.store(CpuProfiler::now() - buildStart);
+		variant->current.store(pipeline);
+
+		//The fast link can draw now, the optimised one takes over whenever it is ready
+		if (builder->usesLibraries())
+		{
+			optimize(variant, description);
+		}
+		return pipeline;
+	});
+
+	int variantId = static_cast<int>(variants.size());
+	variants.push_back(std::move(newVariant));
+	variantIds[description] = variantId;
+	return variantId;
+}
+
+void PipelineVariantCache::optimize(Variant* variant, const PipelineDescription& description)
+{
+	builder->submitJob([this, variant, description]()
+	{
+		int64_t linkStart = CpuProfiler::now();
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		try
+		{
+			pipeline = builder->buildOptimized(description);
+		}
+		catch (const std::runtime_error& e)
+		{
+			//Not fatal, the variant keeps drawing with its fast link
+			printf("Pipeline %s not optimised: %s\n", description.name.c_str(), e.what());
+			return pipeline;
+		}
+		variant->optimizeNs.store(CpuProfiler::now() - linkStart);
+		variant->replaced.store(variant->current.exchange(pipeline));
+		return pipeline;
+	});
+}
+
+VkPipeline PipelineVariantCache::wait(int variantId)
+{
+	std::shared_future<VkPipeline> firstBuild;
+	{
+		std::lock_guard<std::mutex> lock(variantMutex);
+		firstBuild = variants[variantId]->firstBuild;
+	}
+
+	//The optimised link may already have replaced the first pipeline
+	firstBuild.get();
+	return getPipeline(variantId);
+}
+
+VkPipeline PipelineVariantCache::getPipeline(int variantId)
+{
+	std::lock_guard<std::mutex> lock(variantMutex);
+	return variants[variantId]->current.load();
+}
+
+size_t PipelineVariantCache::getVariantCount()
+{
+	std::lock_guard<std::mutex> lock(variantMutex);
+	return variants.size();
+}
+
+std::vector<PipelineVariantStats> PipelineVariantCache::getStats()
+{
+	std::vector<PipelineVariantStats> stats;
+	{
+		std::lock_guard<std::mutex> lock(variantMutex);
+		for (const auto& variant : variants)
+		{
+			PipelineVariantStats variantStats;
+			variantStats.name = variant->name;
+			variantStats.hash = variant->hash;
+			variantStats.hits = variant->hits;
+			variantStats.compileMs = variant->compileNs.load() / 1000000.0;
+			variantStats.optimizeMs = variant->optimizeNs.load() / 1000000.0;
+			stats.push_back(variantStats);
+		}
+	}
+
+	//Most expensive first, those are the ones worth merging
+	std::sort(stats.begin(), stats.end(), [](const PipelineVariantStats& a, const PipelineVariantStats& b) { return a.compileMs > b.compileMs; });
+	return stats;
+}
+
+void PipelineVariantCache::printStats()
+{
+	std::vector<PipelineVariantStats> stats = getStats();
+
+	double totalCompileMs = 0.0;
+	for (const auto& variant : stats)
+	{
+		totalCompileMs += variant.compileMs;
+	}
+
+	printf("Pipeline variants: %zu unique, %llu hits, %llu misses, %.2f ms compiling\n", stats.size(),
+		static_cast<unsigned long long>(hits.load()), static_cast<unsigned long long>(misses.load()), totalCompileMs);
+	for (const auto& variant : stats)
+	{
+		printf("  %016llx %-24s compile %8.2f ms, optimise %8.2f ms, %llu hits\n", static_cast<unsigned long long>(variant.hash),
+			variant.name.c_str(), variant.compileMs, variant.optimizeMs, static_cast<unsigned long long>(variant.hits));
+	}
+}
+
+PipelineVariantCache::~PipelineVariantCache()
+{
+}
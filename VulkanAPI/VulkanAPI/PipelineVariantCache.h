@@ -0,0 +1,80 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<unordered_map>
+#include<mutex>
+#include<future>
+#include<atomic>
+#include<memory>
+#include"PipelineBuilder.h"
+
+//One unique pipeline in the cache
+struct PipelineVariantStats
+{
+	std::string name;		//Name of the first description that created it
+	uint64_t hash = 0;
+	uint64_t hits = 0;
+	double compileMs = 0.0;		//0 until the build finished
+	double optimizeMs = 0.0;		//Background link-time optimised link, 0 without pipeline libraries or until it finished
+};
+
+//Creates each unique pipeline description once and hands out the same pipeline afterwards
+//With pipeline libraries a variant first gets a fast link and later the optimised one, so draws look the pipeline up by id
+class PipelineVariantCache
+{
+public:
+	PipelineVariantCache();
+
+	void init(VkDevice newDevice, PipelineBuilder* newBuilder);
+
+	//Waits for builds in flight and destroys every pipeline the cache created
+	void destroy();
+
+	//Blocks until the variant is usable (only the first request of a variant ever waits for a compile)
+	VkPipeline get(const PipelineDescription& description) { return wait(request(description)); };
+
+	//Builds a missing variant on the builder's threads, returns the variant id straight away
+	int request(const PipelineDescription& description);
+
+	//Blocks until the variant's first pipeline is built (rethrows a failed build)
+	VkPipeline wait(int variantId);
+
+	//Best pipeline of the variant so far, VK_NULL_HANDLE while the first build is still running
+	//A replaced fast link stays alive until destroy, command buffers in flight may still use it
+	VkPipeline getPipeline(int variantId);
+
+	uint64_t getHits() { return hits; };
+	uint64_t getMisses() { return misses; };
+	size_t getVariantCount();
+	std::vector<PipelineVariantStats> getStats();
+	void printStats();
+
+	~PipelineVariantCache();
+
+private:
+	struct Variant
+	{
+		std::shared_future<VkPipeline> firstBuild;		//Full build, or the fast link with pipeline libraries
+		std::atomic<VkPipeline> current{ VK_NULL_HANDLE };
+		std::atomic<VkPipeline> replaced{ VK_NULL_HANDLE };		//Fast link swapped out by the optimised one
+		std::string name;
+		uint64_t hash = 0;
+		uint64_t hits = 0;
+		std::atomic<int64_t> compileNs{ 0 };		//Written by the build jobs, 0 until they finished
+		std::atomic<int64_t> optimizeNs{ 0 };
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	PipelineBuilder* builder = nullptr;
+
+	//Variants never move, so build jobs keep a pointer to theirs
+	std::mutex variantMutex;
+	std::vector<std::unique_ptr<Variant>> variants;
+	std::unordered_map<PipelineDescription, int, PipelineDescriptionHasher> variantIds;
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+
+	void optimize(Variant* variant, const PipelineDescription& description);
+};
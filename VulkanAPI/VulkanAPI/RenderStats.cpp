@@ -0,0 +1,369 @@
+#include "RenderStats.h"
+
+RenderStats::RenderStats()
+{
+}
+
+void RenderStats::init(VkDevice newDevice, bool pipelineStatisticsEnabled, uint32_t newFrameSlotCount)
+{
+	device = newDevice;
+	pipelineStatistics = pipelineStatisticsEnabled;
+	frameSlotCount = newFrameSlotCount;
+	queriesPerSlot = RENDER_STATS_FIRST_MODELS + 1;
+
+	if (pipelineStatistics)
+	{
+		createQueryPool();
+	}
+
+	frameSlots.resize(frameSlotCount);
+	enabled = true;
+}
+
+void RenderStats::createQueryPool()
+{
+	//Statistics are written in bit order, collect() reads them in that same order
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	queryPoolCreateInfo.queryCount = queriesPerSlot * frameSlotCount;
+	queryPoolCreateInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	VkResult result = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Pipeline Statistics Query Pool!");
+	}
+}
+
+void RenderStats::destroy()
+{
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	enabled = false;
+}
+
+void RenderStats::setModelName(size_t modelIndex, const std::string& name)
+{
+	if (modelNames.size() <= modelIndex)
+	{
+		modelNames.resize(modelIndex + 1);
+	}
+	modelNames[modelIndex] = name;
+
+	if (!enabled || modelIndex + 1 < queriesPerSlot) return;
+
+	while (modelIndex + 1 >= queriesPerSlot)
+	{
+		queriesPerSlot = (queriesPerSlot - 1) * 2 + 1;
+	}
+
+	//In flight frames may still write the old pool, and their results can't be read back from the new one
+	if (pipelineStatistics)
+	{
+		vkDeviceWaitIdle(device);
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+		createQueryPool();
+	}
+	for (FrameSlot& slot : frameSlots)
+	{
+		slot.recorded = false;
+	}
+}
+
+void RenderStats::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameNumber)
+{
+	if (!enabled) return;
+
+	recordingSlot = frameSlot;
+	FrameSlot& slot = frameSlots[frameSlot];
+	slot.stats = FrameStats();
+	slot.stats.frameNumber = frameNumber;
+	slot.modelQueryCount = 0;
+	slot.postQueryWritten = false;
+	slot.recorded = true;
+
+	recording = &slot.stats;
+	recordingModel = -1;
+	activeQuery = -1;
+
+	//Queries must be reset before being written again (outside of a render pass)
+	if (pipelineStatistics)
+	{
+		vkCmdResetQueryPool(commandBuffer, queryPool, frameSlot * queriesPerSlot, queriesPerSlot);
+	}
+}
+
+void RenderStats::beginModelQuery(VkCommandBuffer commandBuffer, uint32_t modelIndex)
+{
+	if (!enabled || modelIndex + 1 >= queriesPerSlot) return;
+
+	FrameSlot& slot = frameSlots[recordingSlot];
+	if (recording->models.size() <= modelIndex)
+	{
+		recording->models.resize(modelIndex + 1);
+	}
+	if (modelIndex < modelNames.size())
+	{
+		recording->models[modelIndex].name = modelNames[modelIndex];
+	}
+	slot.modelQueryCount = std::max(slot.modelQueryCount, modelIndex + 1);
+	recordingModel = static_cast<int>(modelIndex);
+
+	beginQuery(commandBuffer, 1 + modelIndex);
+}
+
+void RenderStats::beginPostQuery(VkCommandBuffer commandBuffer)
+{
+	if (!enabled) return;
+
+	frameSlots[recordingSlot].postQueryWritten = true;
+	recordingModel = -1;
+
+	beginQuery(commandBuffer, 0);
+}
+
+void RenderStats::beginQuery(VkCommandBuffer commandBuffer, uint32_t queryIndex)
+{
+	if (!pipelineStatistics) return;
+
+	//Only one pipeline statistics query may be active at a time, so per model queries can't nest in a pass query
+	vkCmdBeginQuery(commandBuffer, queryPool, recordingSlot * queriesPerSlot + queryIndex, 0);
+	activeQuery = static_cast<int>(queryIndex);
+}
+
+void RenderStats::endQuery(VkCommandBuffer commandBuffer)
+{
+	if (!enabled) return;
+
+	recordingModel = -1;
+	if (activeQuery < 0) return;
+
+	vkCmdEndQuery(commandBuffer, queryPool, recordingSlot * queriesPerSlot + activeQuery);
+	activeQuery = -1;
+}
+
+void RenderStats::countDraw(uint32_t vertexCount, uint32_t instanceCount)
+{
+	if (!enabled) return;
+
+	//Every pipeline uses a triangle list topology
+	uint64_t triangles = static_cast<uint64_t>(vertexCount / 3) * instanceCount;
+	recording->drawCalls++;
+	recording->triangles += triangles;
+
+	if (recordingModel >= 0)
+	{
+		recording->models[recordingModel].drawCalls++;
+		recording->models[recordingModel].triangles += triangles;
+	}
+}
+
+void RenderStats::collect(uint32_t frameSlot)
+{
+	if (!enabled) return;
+
+	FrameSlot& slot = frameSlots[frameSlot];
+	if (!slot.recorded) return;
+
+	FrameStats& stats = slot.stats;
+
+	if (pipelineStatistics)
+	{
+		//Each query returns its statistics followed by its availability, no WAIT bit so this can never stall
+		const uint32_t stride = STATISTIC_COUNT + 1;
+		std::vector<uint64_t> results(queriesPerSlot * stride, 0);
+		uint32_t queryCount = 1 + slot.modelQueryCount;
+		VkResult result = vkGetQueryPoolResults(device, queryPool, frameSlot * queriesPerSlot, queryCount,
+			queryCount * stride * sizeof(uint64_t), results.data(), stride * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		auto readQuery = [&](uint32_t queryIndex, PipelineStatistics& statistics)
+		{
+			const uint64_t* values = &results[queryIndex * stride];
+			statistics.available = values[STATISTIC_COUNT] != 0;
+			if (!statistics.available) return;
+
+			statistics.inputPrimitives = values[0];
+			statistics.vertexInvocations = values[1];
+			statistics.clippingInvocations = values[2];
+			statistics.clippingPrimitives = values[3];
+			statistics.fragmentInvocations = values[4];
+		};
+
+		if (result == VK_SUCCESS || result == VK_NOT_READY)
+		{
+			if (slot.postQueryWritten)
+			{
+				readQuery(0, stats.postPass);
+			}
+
+			//Geometry pass total is the sum of its per model queries
+			for (size_t i = 0; i < stats.models.size(); i++)
+			{
+				PipelineStatistics& model = stats.models[i].pipeline;
+				readQuery(static_cast<uint32_t>(1 + i), model);
+				if (!model.available) continue;
+
+				stats.geometryPass.available = true;
+				stats.geometryPass.inputPrimitives += model.inputPrimitives;
+				stats.geometryPass.vertexInvocations += model.vertexInvocations;
+				stats.geometryPass.clippingInvocations += model.clippingInvocations;
+				stats.geometryPass.clippingPrimitives += model.clippingPrimitives;
+				stats.geometryPass.fragmentInvocations += model.fragmentInvocations;
+			}
+		}
+	}
+
+	lastFrame = stats;
+	history.push_back(stats);
+	if (history.size() > RENDER_STATS_WINDOW)
+	{
+		history.pop_front();
+	}
+
+	//Slot consumed, don't read it again
+	slot.recorded = false;
+	collectedFrames++;
+
+	if (logInterval > 0 && collectedFrames % logInterval == 0)
+	{
+		printStats();
+	}
+}
+
+//Add a frame's statistics to a running total
+static void accumulate(PipelineStatisticsAverage& total, const PipelineStatistics& statistics)
+{
+	total.inputPrimitives += statistics.inputPrimitives;
+	total.vertexInvocations += statistics.vertexInvocations;
+	total.clippingInvocations += statistics.clippingInvocations;
+	total.clippingPrimitives += statistics.clippingPrimitives;
+	total.fragmentInvocations += statistics.fragmentInvocations;
+}
+
+static void divide(PipelineStatisticsAverage& total, double count)
+{
+	if (count <= 0.0) return;
+
+	total.inputPrimitives /= count;
+	total.vertexInvocations /= count;
+	total.clippingInvocations /= count;
+	total.clippingPrimitives /= count;
+	total.fragmentInvocations /= count;
+}
+
+FrameStatsAverage RenderStats::getRollingAverage()
+{
+	FrameStatsAverage average;
+	average.frameCount = static_cast<uint32_t>(history.size());
+	if (history.empty()) return average;
+
+	double geometryFrames = 0.0;
+	double postFrames = 0.0;
+	std::vector<double> modelFrames;
+	std::vector<double> modelPipelineFrames;
+
+	for (const auto& stats : history)
+	{
+		average.drawCalls += stats.drawCalls;
+		average.triangles += stats.triangles;
+		average.pipelineBinds += stats.pipelineBinds;
+		average.descriptorSetBinds += stats.descriptorSetBinds;
+		average.descriptorPushes += stats.descriptorPushes;
+		average.vertexBufferBinds += stats.vertexBufferBinds;
+		average.indexBufferBinds += stats.indexBufferBinds;
+		average.pushConstantBytes += stats.pushConstantBytes;
+
+		//GPU values only count the frames whose queries were available
+		if (stats.geometryPass.available)
+		{
+			accumulate(average.geometryPass, stats.geometryPass);
+			geometryFrames++;
+		}
+		if (stats.postPass.available)
+		{
+			accumulate(average.postPass, stats.postPass);
+			postFrames++;
+		}
+
+		if (average.models.size() < stats.models.size())
+		{
+			average.models.resize(stats.models.size());
+			modelFrames.resize(stats.models.size(), 0.0);
+			modelPipelineFrames.resize(stats.models.size(), 0.0);
+		}
+		for (size_t i = 0; i < stats.models.size(); i++)
+		{
+			const ModelFrameStats& model = stats.models[i];
+			average.models[i].name = model.name;
+			average.models[i].drawCalls += model.drawCalls;
+			average.models[i].triangles += model.triangles;
+			modelFrames[i]++;
+
+			if (model.pipeline.available)
+			{
+				accumulate(average.models[i].pipeline, model.pipeline);
+				modelPipelineFrames[i]++;
+			}
+		}
+	}
+
+	double frameCount = static_cast<double>(history.size());
+	average.drawCalls /= frameCount;
+	average.triangles /= frameCount;
+	average.pipelineBinds /= frameCount;
+	average.descriptorSetBinds /= frameCount;
+	average.descriptorPushes /= frameCount;
+	average.vertexBufferBinds /= frameCount;
+	average.indexBufferBinds /= frameCount;
+	average.pushConstantBytes /= frameCount;
+	divide(average.geometryPass, geometryFrames);
+	divide(average.postPass, postFrames);
+
+	for (size_t i = 0; i < average.models.size(); i++)
+	{
+		if (modelFrames[i] > 0.0)
+		{
+			average.models[i].drawCalls /= modelFrames[i];
+			average.models[i].triangles /= modelFrames[i];
+		}
+		divide(average.models[i].pipeline, modelPipelineFrames[i]);
+	}
+
+	return average;
+}
+
+void RenderStats::printStats()
+{
+	FrameStatsAverage average = getRollingAverage();
+
+	printf("Stats (avg of %u frames) | draws %.1f, triangles %.0f, pipeline binds %.1f, descriptor binds %.1f, descriptor pushes %.1f, vertex binds %.1f, index binds %.1f, push constants %.0f B\n",
+		average.frameCount, average.drawCalls, average.triangles, average.pipelineBinds, average.descriptorSetBinds, average.descriptorPushes,
+		average.vertexBufferBinds, average.indexBufferBinds, average.pushConstantBytes);
+
+	if (!pipelineStatistics) return;
+
+	printf("Stats | geometry: vs %.0f, clip in %.0f, clip out %.0f, fs %.0f | post: fs %.0f\n",
+		average.geometryPass.vertexInvocations, average.geometryPass.clippingInvocations, average.geometryPass.clippingPrimitives,
+		average.geometryPass.fragmentInvocations, average.postPass.fragmentInvocations);
+
+	for (size_t i = 0; i < average.models.size(); i++)
+	{
+		const ModelFrameStatsAverage& model = average.models[i];
+		printf("Stats | model %zu (%s): triangles %.0f, vs %.0f, clip out %.0f, fs %.0f\n", i, model.name.c_str(),
+			model.triangles, model.pipeline.vertexInvocations, model.pipeline.clippingPrimitives, model.pipeline.fragmentInvocations);
+	}
+}
+
+RenderStats::~RenderStats()
+{
+}
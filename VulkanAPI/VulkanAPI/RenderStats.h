@@ -0,0 +1,161 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<deque>
+#include<stdexcept>
+#include"Utilities.h"
+
+const uint32_t RENDER_STATS_WINDOW = 120;		//Number of recent frames used for rolling averages
+const uint32_t RENDER_STATS_FIRST_MODELS = 16;		//Per model queries made at init, doubled whenever more models are loaded
+
+//Values of one pipeline statistics query
+struct PipelineStatistics
+{
+	bool available = false;
+	uint64_t inputPrimitives = 0;			//Primitives assembled for the vertex shader
+	uint64_t vertexInvocations = 0;
+	uint64_t clippingInvocations = 0;		//Primitives that reached the clipping stage
+	uint64_t clippingPrimitives = 0;		//Primitives output by clipping (visible geometry)
+	uint64_t fragmentInvocations = 0;
+};
+
+//Geometry pass cost of one model
+struct ModelFrameStats
+{
+	std::string name;
+	uint32_t drawCalls = 0;
+	uint64_t triangles = 0;
+	PipelineStatistics pipeline;
+};
+
+//Everything counted for one frame
+struct FrameStats
+{
+	uint64_t frameNumber = 0;
+
+	//-CPU counters (recordCommands)
+	uint32_t drawCalls = 0;
+	uint64_t triangles = 0;			//Triangles submitted by draw calls
+	uint32_t pipelineBinds = 0;
+	uint32_t descriptorSetBinds = 0;
+	uint32_t descriptorPushes = 0;		//vkCmdPushDescriptorSetKHR calls
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+	uint32_t pushConstantBytes = 0;
+
+	//-GPU pipeline statistics (only if supported)
+	PipelineStatistics geometryPass;		//Sum of all models
+	PipelineStatistics postPass;
+	std::vector<ModelFrameStats> models;
+};
+
+struct PipelineStatisticsAverage
+{
+	double inputPrimitives = 0.0;
+	double vertexInvocations = 0.0;
+	double clippingInvocations = 0.0;
+	double clippingPrimitives = 0.0;
+	double fragmentInvocations = 0.0;
+};
+
+struct ModelFrameStatsAverage
+{
+	std::string name;
+	double drawCalls = 0.0;
+	double triangles = 0.0;
+	PipelineStatisticsAverage pipeline;
+};
+
+//Per frame averages over the last RENDER_STATS_WINDOW collected frames
+struct FrameStatsAverage
+{
+	uint32_t frameCount = 0;
+	double drawCalls = 0.0;
+	double triangles = 0.0;
+	double pipelineBinds = 0.0;
+	double descriptorSetBinds = 0.0;
+	double descriptorPushes = 0.0;
+	double vertexBufferBinds = 0.0;
+	double indexBufferBinds = 0.0;
+	double pushConstantBytes = 0.0;
+	PipelineStatisticsAverage geometryPass;
+	PipelineStatisticsAverage postPass;
+	std::vector<ModelFrameStatsAverage> models;
+};
+
+class RenderStats
+{
+public:
+	RenderStats();
+
+	//Pipeline statistics need the pipelineStatisticsQuery feature, without it only CPU counters are collected
+	void init(VkDevice newDevice, bool pipelineStatisticsEnabled, uint32_t frameSlotCount);
+	void destroy();
+
+	bool isEnabled() { return enabled; };
+	void setLogInterval(uint32_t frames) { logInterval = frames; };
+	//Called for every loaded model, grows the query pool when the model count passes it (waits for the device)
+	void setModelName(size_t modelIndex, const std::string& name);
+
+	//-Record Functions (called while recording the frame's command buffer)
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameNumber);
+	void beginModelQuery(VkCommandBuffer commandBuffer, uint32_t modelIndex);
+	void beginPostQuery(VkCommandBuffer commandBuffer);
+	void endQuery(VkCommandBuffer commandBuffer);
+
+	//-Counter Functions (cheap, no-ops while disabled)
+	void countPipelineBind() { if (enabled) recording->pipelineBinds++; };
+	void countDescriptorSetBinds(uint32_t setCount) { if (enabled) recording->descriptorSetBinds += setCount; };
+	void countDescriptorPush() { if (enabled) recording->descriptorPushes++; };
+	void countVertexBufferBinds(uint32_t bufferCount) { if (enabled) recording->vertexBufferBinds += bufferCount; };
+	void countIndexBufferBind() { if (enabled) recording->indexBufferBinds++; };
+	void countPushConstants(uint32_t bytes) { if (enabled) recording->pushConstantBytes += bytes; };
+	void countDraw(uint32_t vertexCount, uint32_t instanceCount);
+
+	//-Readback Function (only call once the fence of the frame slot has signalled)
+	void collect(uint32_t frameSlot);
+
+	const FrameStats& getLastFrame() { return lastFrame; };
+	FrameStatsAverage getRollingAverage();
+	void printStats();
+
+	~RenderStats();
+
+private:
+	//Values returned per query: one per statistic bit plus availability
+	static const uint32_t STATISTIC_COUNT = 5;
+
+	struct FrameSlot
+	{
+		FrameStats stats;
+		uint32_t modelQueryCount = 0;
+		bool postQueryWritten = false;
+		bool recorded = false;
+	};
+
+	bool enabled = false;
+	bool pipelineStatistics = false;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	uint32_t queriesPerSlot = 0;		//Query 0 is the post pass, 1 + model index for the geometry pass
+	uint32_t frameSlotCount = 0;
+
+	std::vector<FrameSlot> frameSlots;
+	uint32_t recordingSlot = 0;
+	FrameStats* recording = nullptr;
+	int recordingModel = -1;		//Model whose draws are being counted (-1 outside geometry pass)
+	int activeQuery = -1;		//Query index currently begun in the recording slot
+
+	std::vector<std::string> modelNames;
+
+	FrameStats lastFrame;
+	std::deque<FrameStats> history;
+
+	uint64_t collectedFrames = 0;
+	uint32_t logInterval = 0;
+
+	void createQueryPool();
+	void beginQuery(VkCommandBuffer commandBuffer, uint32_t queryIndex);
+};
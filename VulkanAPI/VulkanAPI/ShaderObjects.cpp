@@ -0,0 +1,234 @@
+#include "ShaderObjects.h"
+#include "CpuProfiler.h"
+
+ShaderObjects::ShaderObjects()
+{
+}
+
+#ifdef VK_EXT_shader_object
+template<typename Function>
+void ShaderObjects::loadFunction(Function* function, const char* name)
+{
+	*function = reinterpret_cast<Function>(vkGetDeviceProcAddr(device, name));
+	if (*function == nullptr)
+	{
+		throw std::runtime_error(std::string("Failed to load ") + name + "!");
+	}
+}
+#endif
+
+void ShaderObjects::init(VkDevice newDevice)
+{
+	device = newDevice;
+
+#ifdef VK_EXT_shader_object
+	loadFunction(&createShadersEXT, "vkCreateShadersEXT");
+	loadFunction(&destroyShaderEXT, "vkDestroyShaderEXT");
+	loadFunction(&cmdBindShadersEXT, "vkCmdBindShadersEXT");
+	loadFunction(&cmdSetViewportWithCountEXT, "vkCmdSetViewportWithCountEXT");
+	loadFunction(&cmdSetScissorWithCountEXT, "vkCmdSetScissorWithCountEXT");
+	loadFunction(&cmdSetRasterizerDiscardEnableEXT, "vkCmdSetRasterizerDiscardEnableEXT");
+	loadFunction(&cmdSetVertexInputEXT, "vkCmdSetVertexInputEXT");
+	loadFunction(&cmdSetPrimitiveTopologyEXT, "vkCmdSetPrimitiveTopologyEXT");
+	loadFunction(&cmdSetPrimitiveRestartEnableEXT, "vkCmdSetPrimitiveRestartEnableEXT");
+	loadFunction(&cmdSetPolygonModeEXT, "vkCmdSetPolygonModeEXT");
+	loadFunction(&cmdSetRasterizationSamplesEXT, "vkCmdSetRasterizationSamplesEXT");
+	loadFunction(&cmdSetSampleMaskEXT, "vkCmdSetSampleMaskEXT");
+	loadFunction(&cmdSetAlphaToCoverageEnableEXT, "vkCmdSetAlphaToCoverageEnableEXT");
+	loadFunction(&cmdSetCullModeEXT, "vkCmdSetCullModeEXT");
+	loadFunction(&cmdSetFrontFaceEXT, "vkCmdSetFrontFaceEXT");
+	loadFunction(&cmdSetDepthTestEnableEXT, "vkCmdSetDepthTestEnableEXT");
+	loadFunction(&cmdSetDepthWriteEnableEXT, "vkCmdSetDepthWriteEnableEXT");
+	loadFunction(&cmdSetDepthCompareOpEXT, "vkCmdSetDepthCompareOpEXT");
+	loadFunction(&cmdSetDepthBiasEnableEXT, "vkCmdSetDepthBiasEnableEXT");
+	loadFunction(&cmdSetStencilTestEnableEXT, "vkCmdSetStencilTestEnableEXT");
+	loadFunction(&cmdSetColorBlendEnableEXT, "vkCmdSetColorBlendEnableEXT");
+	loadFunction(&cmdSetColorBlendEquationEXT, "vkCmdSetColorBlendEquationEXT");
+	loadFunction(&cmdSetColorWriteMaskEXT, "vkCmdSetColorWriteMaskEXT");
+#else
+	throw std::runtime_error("Built without VK_EXT_shader_object headers!");
+#endif
+}
+
+void ShaderObjects::destroy()
+{
+#ifdef VK_EXT_shader_object
+	for (auto& shaderPair : shaderPairs)
+	{
+		destroyShaderEXT(device, shaderPair.vertex, nullptr);
+		destroyShaderEXT(device, shaderPair.fragment, nullptr);
+	}
+	shaderPairs.clear();
+#endif
+}
+
+int ShaderObjects::createShaders(const PipelineDescription& description, const std::vector<VkDescriptorSetLayout>& setLayouts,
+	const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+#ifdef VK_EXT_shader_object
+	for (size_t i = 0; i < shaderPairs.size(); i++)
+	{
+		const PipelineDescription& existing = shaderPairs[i].description;
+		if (existing.vertexShaderFile == description.vertexShaderFile && existing.fragmentShaderFile == description.fragmentShaderFile &&
+			existing.vertexPermutation == description.vertexPermutation && existing.fragmentPermutation == description.fragmentPermutation &&
+			existing.vertexLayout == description.vertexLayout && existing.extent.width == description.extent.width &&
+			existing.extent.height == description.extent.height)
+		{
+			return static_cast<int>(i);
+		}
+	}
+
+	CPU_PROFILE_ZONE("Create Shader Objects");
+	int64_t createStart = CpuProfiler::now();
+
+	std::vector<char> vertexCode = readFile(description.vertexShaderFile);
+	std::vector<char> fragmentCode = readFile(description.fragmentShaderFile);
+
+	//Linked stages let the driver optimise across the interface, like a full pipeline build would
+	VkShaderCreateInfoEXT shaderCreateInfos[2] = {};
+	for (auto& shaderCreateInfo : shaderCreateInfos)
+	{
+		shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
+		shaderCreateInfo.flags = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT;
+		shaderCreateInfo.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+		shaderCreateInfo.pName = "main";
+		shaderCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		shaderCreateInfo.pSetLayouts = setLayouts.data();
+		shaderCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+		shaderCreateInfo.pPushConstantRanges = pushConstantRanges.data();
+	}
+
+	shaderCreateInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderCreateInfos[0].nextStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderCreateInfos[0].codeSize = vertexCode.size();
+	shaderCreateInfos[0].pCode = vertexCode.data();
+	VkSpecializationInfo vertexSpecialization = description.vertexPermutation.getSpecializationInfo();
+	shaderCreateInfos[0].pSpecializationInfo = description.vertexPermutation.isEmpty() ? nullptr : &vertexSpecialization;
+
+	shaderCreateInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderCreateInfos[1].codeSize = fragmentCode.size();
+	shaderCreateInfos[1].pCode = fragmentCode.data();
+	VkSpecializationInfo fragmentSpecialization = description.fragmentPermutation.getSpecializationInfo();
+	shaderCreateInfos[1].pSpecializationInfo = description.fragmentPermutation.isEmpty() ? nullptr : &fragmentSpecialization;
+
+	VkShaderEXT createdShaders[2] = {};
+	VkResult result = createShadersEXT(device, 2, shaderCreateInfos, nullptr, createdShaders);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create shader objects for " + description.name + "!");
+	}
+
+	ShaderPair shaderPair;
+	shaderPair.vertex = createdShaders[0];
+	shaderPair.fragment = createdShaders[1];
+	shaderPair.description = description;
+	shaderPairs.push_back(shaderPair);
+
+	createMicroseconds += (CpuProfiler::now() - createStart) / 1000;
+	return static_cast<int>(shaderPairs.size()) - 1;
+#else
+	throw std::runtime_error("Built without VK_EXT_shader_object headers!");
+#endif
+}
+
+void ShaderObjects::bind(VkCommandBuffer commandBuffer, int shaderId, const RenderState& state)
+{
+#ifdef VK_EXT_shader_object
+	const ShaderPair& shaderPair = shaderPairs[shaderId];
+	VkExtent2D extent = shaderPair.description.extent;
+
+	VkShaderStageFlagBits stages[] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+	VkShaderEXT shaders[] = { shaderPair.vertex, shaderPair.fragment };
+	cmdBindShadersEXT(commandBuffer, 2, stages, shaders);
+
+	//--ViewPort & Scissor (same values the pipelines bake in)
+	VkViewport viewPort = {};
+	viewPort.width = (float)extent.width;
+	viewPort.height = (float)extent.height;
+	viewPort.minDepth = 0.0f;
+	viewPort.maxDepth = 1.0f;
+	VkRect2D scissor = {};
+	scissor.extent = extent;
+	cmdSetViewportWithCountEXT(commandBuffer, 1, &viewPort);
+	cmdSetScissorWithCountEXT(commandBuffer, 1, &scissor);
+	cmdSetRasterizerDiscardEnableEXT(commandBuffer, VK_FALSE);
+
+	//--Vertex Input
+	VkVertexInputBindingDescription2EXT bindingDescription = {};
+	bindingDescription.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT;
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(Vertex);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	bindingDescription.divisor = 1;
+
+	VkVertexInputAttributeDescription2EXT attributeDescriptions[3] = {};
+	VkFormat attributeFormats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32_SFLOAT };
+	uint32_t attributeOffsets[] = { offsetof(Vertex, pos), offsetof(Vertex, color), offsetof(Vertex, tex) };
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		attributeDescriptions[i].sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT;
+		attributeDescriptions[i].location = i;
+		attributeDescriptions[i].binding = 0;
+		attributeDescriptions[i].format = attributeFormats[i];
+		attributeDescriptions[i].offset = attributeOffsets[i];
+	}
+
+	if (shaderPair.description.vertexLayout == VertexLayout::Standard)
+	{
+		cmdSetVertexInputEXT(commandBuffer, 1, &bindingDescription, 3, attributeDescriptions);
+	}
+	else
+	{
+		cmdSetVertexInputEXT(commandBuffer, 0, nullptr, 0, nullptr);
+	}
+	cmdSetPrimitiveTopologyEXT(commandBuffer, state.topology);
+	cmdSetPrimitiveRestartEnableEXT(commandBuffer, VK_FALSE);
+
+	//--Rasterizer & MultiSampling
+	VkSampleMask sampleMask = 0xFFFFFFFF;
+	cmdSetPolygonModeEXT(commandBuffer, state.polygonMode);
+	cmdSetCullModeEXT(commandBuffer, state.cullMode);
+	cmdSetFrontFaceEXT(commandBuffer, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	cmdSetDepthBiasEnableEXT(commandBuffer, VK_FALSE);
+	cmdSetRasterizationSamplesEXT(commandBuffer, VK_SAMPLE_COUNT_1_BIT);
+	cmdSetSampleMaskEXT(commandBuffer, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+	cmdSetAlphaToCoverageEnableEXT(commandBuffer, VK_FALSE);
+	if (state.polygonMode == VK_POLYGON_MODE_LINE)
+	{
+		vkCmdSetLineWidth(commandBuffer, 1.0f);
+	}
+
+	//--Depth Stencil Testing
+	cmdSetDepthTestEnableEXT(commandBuffer, state.depthTest ? VK_TRUE : VK_FALSE);
+	cmdSetDepthWriteEnableEXT(commandBuffer, state.depthWrite ? VK_TRUE : VK_FALSE);
+	cmdSetDepthCompareOpEXT(commandBuffer, VK_COMPARE_OP_LESS);
+	cmdSetStencilTestEnableEXT(commandBuffer, VK_FALSE);
+
+	//--Blending (same equations as the pipeline blend modes)
+	VkBool32 blendEnable = state.blend != BlendMode::Opaque ? VK_TRUE : VK_FALSE;
+	VkColorBlendEquationEXT blendEquation = {};
+	blendEquation.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	blendEquation.dstColorBlendFactor = state.blend == BlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendEquation.colorBlendOp = VK_BLEND_OP_ADD;
+	blendEquation.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendEquation.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	blendEquation.alphaBlendOp = VK_BLEND_OP_ADD;
+	VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	cmdSetColorBlendEnableEXT(commandBuffer, 0, 1, &blendEnable);
+	cmdSetColorBlendEquationEXT(commandBuffer, 0, 1, &blendEquation);
+	cmdSetColorWriteMaskEXT(commandBuffer, 0, 1, &writeMask);
+#endif
+}
+
+const RenderState& ShaderObjects::getDefaultState(int shaderId)
+{
+#ifdef VK_EXT_shader_object
+	return shaderPairs[shaderId].description.state;
+#else
+	throw std::runtime_error("Built without VK_EXT_shader_object headers!");
+#endif
+}
+
+ShaderObjects::~ShaderObjects()
+{
+}
@@ -0,0 +1,77 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<stdexcept>
+#include"Utilities.h"
+#include"PipelineBuilder.h"
+
+//Shader object backend (VK_EXT_shader_object): linked vertex + fragment VkShaderEXT pairs instead of pipelines,
+//all fixed-function state is set while recording, so new render states never compile anything
+class ShaderObjects
+{
+public:
+	ShaderObjects();
+
+	//Loads the extension entry points, the device must have VK_EXT_shader_object and the shaderObject feature enabled
+	void init(VkDevice newDevice);
+	void destroy();
+
+	//Set layouts and push constant ranges must match the pipeline layout used for descriptor binds and push constants
+	//The render state of the description is only the default for bind without a state, returns the id to bind
+	//Same shaders, constants, vertex layout and extent as an earlier call return that pair instead of creating another
+	int createShaders(const PipelineDescription& description, const std::vector<VkDescriptorSetLayout>& setLayouts,
+		const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+	//Binds the pair and sets every dynamic state a draw with it needs
+	void bind(VkCommandBuffer commandBuffer, int shaderId, const RenderState& state);
+	void bind(VkCommandBuffer commandBuffer, int shaderId) { bind(commandBuffer, shaderId, getDefaultState(shaderId)); };
+
+	const RenderState& getDefaultState(int shaderId);
+	double getCreateMs() { return createMicroseconds / 1000.0; };
+
+	~ShaderObjects();
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	int64_t createMicroseconds = 0;
+
+#ifdef VK_EXT_shader_object
+	struct ShaderPair
+	{
+		VkShaderEXT vertex = VK_NULL_HANDLE;
+		VkShaderEXT fragment = VK_NULL_HANDLE;
+		PipelineDescription description;
+	};
+	std::vector<ShaderPair> shaderPairs;
+
+	//-Extension Functions (not exported by the loader)
+	PFN_vkCreateShadersEXT createShadersEXT = nullptr;
+	PFN_vkDestroyShaderEXT destroyShaderEXT = nullptr;
+	PFN_vkCmdBindShadersEXT cmdBindShadersEXT = nullptr;
+	PFN_vkCmdSetViewportWithCountEXT cmdSetViewportWithCountEXT = nullptr;
+	PFN_vkCmdSetScissorWithCountEXT cmdSetScissorWithCountEXT = nullptr;
+	PFN_vkCmdSetRasterizerDiscardEnableEXT cmdSetRasterizerDiscardEnableEXT = nullptr;
+	PFN_vkCmdSetVertexInputEXT cmdSetVertexInputEXT = nullptr;
+	PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopologyEXT = nullptr;
+	PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnableEXT = nullptr;
+	PFN_vkCmdSetPolygonModeEXT cmdSetPolygonModeEXT = nullptr;
+	PFN_vkCmdSetRasterizationSamplesEXT cmdSetRasterizationSamplesEXT = nullptr;
+	PFN_vkCmdSetSampleMaskEXT cmdSetSampleMaskEXT = nullptr;
+	PFN_vkCmdSetAlphaToCoverageEnableEXT cmdSetAlphaToCoverageEnableEXT = nullptr;
+	PFN_vkCmdSetCullModeEXT cmdSetCullModeEXT = nullptr;
+	PFN_vkCmdSetFrontFaceEXT cmdSetFrontFaceEXT = nullptr;
+	PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnableEXT = nullptr;
+	PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnableEXT = nullptr;
+	PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOpEXT = nullptr;
+	PFN_vkCmdSetDepthBiasEnableEXT cmdSetDepthBiasEnableEXT = nullptr;
+	PFN_vkCmdSetStencilTestEnableEXT cmdSetStencilTestEnableEXT = nullptr;
+	PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnableEXT = nullptr;
+	PFN_vkCmdSetColorBlendEquationEXT cmdSetColorBlendEquationEXT = nullptr;
+	PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMaskEXT = nullptr;
+
+	template<typename Function>
+	void loadFunction(Function* function, const char* name);
+#endif
+};
@@ -0,0 +1,89 @@
+#include "ShaderPermutation.h"
+#include<cstring>
+
+ShaderPermutation::ShaderPermutation()
+{
+}
+
+ShaderPermutation& ShaderPermutation::setFeature(uint32_t constantId, bool enabled)
+{
+	setValue(constantId, enabled ? VK_TRUE : VK_FALSE);
+	return *this;
+}
+
+ShaderPermutation& ShaderPermutation::setInt(uint32_t constantId, int32_t value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	setValue(constantId, bits);
+	return *this;
+}
+
+ShaderPermutation& ShaderPermutation::setFloat(uint32_t constantId, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	setValue(constantId, bits);
+	return *this;
+}
+
+void ShaderPermutation::setValue(uint32_t constantId, uint32_t value)
+{
+	for (size_t i = 0; i < mapEntries.size(); i++)
+	{
+		if (mapEntries[i].constantID == constantId)
+		{
+			data[i] = value;
+			return;
+		}
+	}
+
+	VkSpecializationMapEntry mapEntry = {};
+	mapEntry.constantID = constantId;		//constant_id in the shader
+	mapEntry.offset = static_cast<uint32_t>(data.size() * sizeof(uint32_t));		//Where the value is in the data block
+	mapEntry.size = sizeof(uint32_t);
+	mapEntries.push_back(mapEntry);
+	data.push_back(value);
+}
+
+VkSpecializationInfo ShaderPermutation::getSpecializationInfo() const
+{
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+	specializationInfo.pMapEntries = mapEntries.data();
+	specializationInfo.dataSize = data.size() * sizeof(uint32_t);
+	specializationInfo.pData = data.data();
+	return specializationInfo;
+}
+
+uint64_t ShaderPermutation::getHash() const
+{
+	//FNV-1a over id/value pairs, in the order they were set
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < mapEntries.size(); i++)
+	{
+		uint32_t pair[2] = { mapEntries[i].constantID, data[i] };
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(pair);
+		for (size_t j = 0; j < sizeof(pair); j++)
+		{
+			hash ^= bytes[j];
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+bool ShaderPermutation::operator==(const ShaderPermutation& other) const
+{
+	if (mapEntries.size() != other.mapEntries.size()) return false;
+
+	for (size_t i = 0; i < mapEntries.size(); i++)
+	{
+		if (mapEntries[i].constantID != other.mapEntries[i].constantID || data[i] != other.data[i]) return false;
+	}
+	return true;
+}
+
+ShaderPermutation::~ShaderPermutation()
+{
+}
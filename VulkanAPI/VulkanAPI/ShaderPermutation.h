@@ -0,0 +1,52 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<vector>
+
+//-Specialization constant ids, must match the constant_id layouts in the shaders
+//--shader.frag
+const uint32_t GEOMETRY_TEXTURED_CONSTANT = 0;		//bool: sample the texture, white otherwise
+const uint32_t GEOMETRY_VERTEX_COLOR_CONSTANT = 1;		//bool: multiply by the vertex colour
+//--second.frag
+const uint32_t POST_DEPTH_SPLIT_CONSTANT = 0;		//bool: right half of the screen shows depth
+const uint32_t POST_SCREEN_WIDTH_CONSTANT = 1;		//int
+const uint32_t POST_DEPTH_LOWER_CONSTANT = 2;		//float: depth shown at full brightness
+const uint32_t POST_DEPTH_UPPER_CONSTANT = 3;		//float: depth shown black
+
+//Shader features of a model's material, every combination used gets its own specialised pipeline
+struct MaterialFeatures
+{
+	bool textured = true;
+	bool vertexColor = false;
+};
+
+//Specialization constant values of one shader stage, handed to VkSpecializationInfo when the pipeline is created
+//so the driver folds them in and drops dead branches. Ids a module doesn't declare are ignored.
+class ShaderPermutation
+{
+public:
+	ShaderPermutation();
+
+	//Setting an id again replaces its value
+	ShaderPermutation& setFeature(uint32_t constantId, bool enabled);
+	ShaderPermutation& setInt(uint32_t constantId, int32_t value);
+	ShaderPermutation& setFloat(uint32_t constantId, float value);
+
+	bool isEmpty() const { return mapEntries.empty(); };
+
+	//Points into this permutation, only valid while it is alive and unchanged
+	VkSpecializationInfo getSpecializationInfo() const;
+
+	//Same value in every run for the same constants
+	uint64_t getHash() const;
+	bool operator==(const ShaderPermutation& other) const;
+
+	~ShaderPermutation();
+
+private:
+	//Every constant is 4 bytes (SPIR-V bools are 32-bit), entry i reads data[i]
+	std::vector<VkSpecializationMapEntry> mapEntries;
+	std::vector<uint32_t> data;
+
+	void setValue(uint32_t constantId, uint32_t value);
+};
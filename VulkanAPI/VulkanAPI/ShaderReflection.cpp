@@ -0,0 +1,588 @@
+#include "ShaderReflection.h"
+#include<cstring>
+#include<map>
+
+namespace
+{
+	//-SPIR-V numbers used here, from the SPIR-V specification
+	const uint32_t SPIRV_MAGIC = 0x07230203;
+	const size_t SPIRV_HEADER_WORDS = 5;
+
+	enum SpirvOp : uint32_t
+	{
+		OpEntryPoint = 15,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpFunction = 54,
+		OpFunctionCall = 57,
+		OpVariable = 59,
+		OpImageTexelPointer = 60,
+		OpLoad = 61,
+		OpStore = 62,
+		OpCopyMemory = 63,
+		OpAccessChain = 65,
+		OpInBoundsAccessChain = 66,
+		OpPtrAccessChain = 67,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	enum SpirvDecoration : uint32_t
+	{
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum SpirvStorageClass : uint32_t
+	{
+		StorageClassUniformConstant = 0,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	const uint32_t SPIRV_DIM_BUFFER = 5;
+	const uint32_t SPIRV_DIM_SUBPASS_DATA = 6;
+	const uint32_t SPIRV_IMAGE_STORAGE = 2;		//"Sampled" operand of OpTypeImage: used without a sampler
+
+	//Everything the reflection needs to know about one result id
+	struct SpirvId
+	{
+		std::vector<uint32_t> words;		//Instruction that defines the id, opcode word first (empty = not a type, constant or variable)
+		uint32_t set = 0;
+		uint32_t binding = 0;
+		bool hasBinding = false;
+		bool bufferBlock = false;
+		uint32_t arrayStride = 0;
+		std::map<uint32_t, uint32_t> memberOffsets;
+		std::map<uint32_t, uint32_t> memberMatrixStrides;
+		bool used = false;		//Variable is accessed by a function
+	};
+
+	class SpirvModule
+	{
+	public:
+		SpirvModule(const std::vector<char>& code, const std::string& newFileName) : fileName(newFileName)
+		{
+			if (code.size() % sizeof(uint32_t) != 0 || code.size() < SPIRV_HEADER_WORDS * sizeof(uint32_t))
+			{
+				fail("not a SPIR-V module");
+			}
+			std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+			memcpy(words.data(), code.data(), code.size());
+			if (words[0] != SPIRV_MAGIC)
+			{
+				fail("not a SPIR-V module");
+			}
+			ids.resize(words[3]);		//Id bound
+
+			//Instructions: word count in the high 16 bits of the first word, opcode in the low 16
+			size_t offset = SPIRV_HEADER_WORDS;
+			while (offset < words.size())
+			{
+				uint32_t opcode = words[offset] & 0xFFFF;
+				uint32_t wordCount = words[offset] >> 16;
+				if (wordCount == 0 || offset + wordCount > words.size())
+				{
+					fail("truncated instruction");
+				}
+				parseInstruction(&words[offset], opcode, wordCount);
+				offset += wordCount;
+			}
+		}
+
+		VkShaderStageFlags stages = 0;
+		std::vector<SpirvId> ids;
+
+		const SpirvId& get(uint32_t id) const
+		{
+			if (id >= ids.size())
+			{
+				fail("id out of bounds");
+			}
+			return ids[id];
+		}
+
+		uint32_t getOpcode(uint32_t id) const
+		{
+			const SpirvId& spirvId = get(id);
+			return spirvId.words.empty() ? 0 : spirvId.words[0] & 0xFFFF;
+		}
+
+		uint32_t getConstant(uint32_t id) const
+		{
+			if (getOpcode(id) != OpConstant)
+			{
+				fail("array length is not a constant");
+			}
+			return get(id).words[3];
+		}
+
+		//Bytes the type takes in a block with explicit layout (Offset/ArrayStride/MatrixStride decorations)
+		uint32_t getTypeSize(uint32_t typeId, uint32_t matrixStride) const
+		{
+			const SpirvId& type = get(typeId);
+			switch (getOpcode(typeId))
+			{
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.words[2] / 8;
+			case OpTypeVector:
+				return type.words[3] * getTypeSize(type.words[2], 0);
+			case OpTypeMatrix:
+				return type.words[3] * (matrixStride != 0 ? matrixStride : getTypeSize(type.words[2], 0));
+			case OpTypeArray:
+				return getConstant(type.words[3]) * (type.arrayStride != 0 ? type.arrayStride : getTypeSize(type.words[2], matrixStride));
+			case OpTypeStruct:
+			{
+				uint32_t size = 0;
+				for (uint32_t member = 0; member + 2 < type.words.size(); member++)
+				{
+					auto offset = type.memberOffsets.find(member);
+					auto stride = type.memberMatrixStrides.find(member);
+					uint32_t memberEnd = (offset != type.memberOffsets.end() ? offset->second : 0) +
+						getTypeSize(type.words[2 + member], stride != type.memberMatrixStrides.end() ? stride->second : 0);
+					size = std::max(size, memberEnd);
+				}
+				return size;
+			}
+			default:
+				return 0;		//Runtime arrays and opaque types
+			}
+		}
+
+		//Lowest member offset of a struct, push constant blocks don't have to start at 0
+		uint32_t getFirstOffset(uint32_t typeId) const
+		{
+			const SpirvId& type = get(typeId);
+			uint32_t first = UINT32_MAX;
+			for (auto& offset : type.memberOffsets)
+			{
+				first = std::min(first, offset.second);
+			}
+			return first == UINT32_MAX ? 0 : first;
+		}
+
+		VkDescriptorType getDescriptorType(uint32_t typeId, uint32_t storageClass) const
+		{
+			if (storageClass == StorageClassStorageBuffer)
+			{
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			if (storageClass == StorageClassUniform)
+			{
+				//Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+				return get(typeId).bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			}
+
+			switch (getOpcode(typeId))
+			{
+			case OpTypeSampler:
+				return VK_DESCRIPTOR_TYPE_SAMPLER;
+			case OpTypeSampledImage:
+			{
+				uint32_t imageId = get(typeId).words[2];
+				if (getOpcode(imageId) == OpTypeImage && get(imageId).words[3] == SPIRV_DIM_BUFFER)
+				{
+					return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			}
+			case OpTypeImage:
+			{
+				const SpirvId& image = get(typeId);
+				bool storage = image.words[7] == SPIRV_IMAGE_STORAGE;
+				if (image.words[3] == SPIRV_DIM_SUBPASS_DATA)
+				{
+					return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				}
+				if (image.words[3] == SPIRV_DIM_BUFFER)
+				{
+					return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+			default:
+				fail("unsupported descriptor type");
+				return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+			}
+		}
+
+		void fail(const std::string& reason) const
+		{
+			throw std::runtime_error("Failed to reflect " + fileName + ", " + reason + "!");
+		}
+
+	private:
+		std::string fileName;
+		bool inFunction = false;
+
+		SpirvId& at(uint32_t id)
+		{
+			if (id >= ids.size())
+			{
+				fail("id out of bounds");
+			}
+			return ids[id];
+		}
+
+		void define(const uint32_t* instruction, uint32_t wordCount, uint32_t resultWord, uint32_t minWords)
+		{
+			if (wordCount < minWords)
+			{
+				fail("truncated instruction");
+			}
+			at(instruction[resultWord]).words.assign(instruction, instruction + wordCount);
+		}
+
+		void markUsed(uint32_t id)
+		{
+			if (inFunction && id < ids.size())
+			{
+				ids[id].used = true;
+			}
+		}
+
+		void parseInstruction(const uint32_t* instruction, uint32_t opcode, uint32_t wordCount)
+		{
+			switch (opcode)
+			{
+			case OpEntryPoint:
+				if (wordCount < 2) fail("truncated instruction");
+				switch (instruction[1])		//Execution model
+				{
+				case 0: stages |= VK_SHADER_STAGE_VERTEX_BIT; break;
+				case 1: stages |= VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT; break;
+				case 2: stages |= VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT; break;
+				case 3: stages |= VK_SHADER_STAGE_GEOMETRY_BIT; break;
+				case 4: stages |= VK_SHADER_STAGE_FRAGMENT_BIT; break;
+				case 5: stages |= VK_SHADER_STAGE_COMPUTE_BIT; break;
+				default: fail("unsupported execution model");
+				}
+				break;
+
+			case OpDecorate:
+			{
+				if (wordCount < 3) fail("truncated instruction");
+				SpirvId& target = at(instruction[1]);
+				uint32_t literal = wordCount > 3 ? instruction[3] : 0;
+				switch (instruction[2])
+				{
+				case DecorationBufferBlock: target.bufferBlock = true; break;
+				case DecorationArrayStride: target.arrayStride = literal; break;
+				case DecorationBinding: target.binding = literal; target.hasBinding = true; break;
+				case DecorationDescriptorSet: target.set = literal; break;
+				}
+				break;
+			}
+			case OpMemberDecorate:
+			{
+				if (wordCount < 4) fail("truncated instruction");
+				SpirvId& target = at(instruction[1]);
+				uint32_t literal = wordCount > 4 ? instruction[4] : 0;
+				if (instruction[3] == DecorationOffset) target.memberOffsets[instruction[2]] = literal;
+				if (instruction[3] == DecorationMatrixStride) target.memberMatrixStrides[instruction[2]] = literal;
+				break;
+			}
+
+			//-Types, result id in word 1
+			case OpTypeBool:
+			case OpTypeSampler:
+				define(instruction, wordCount, 1, 2);
+				break;
+			case OpTypeFloat:
+			case OpTypeSampledImage:
+			case OpTypeRuntimeArray:
+			case OpTypeStruct:
+				define(instruction, wordCount, 1, 3);
+				break;
+			case OpTypeInt:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeArray:
+			case OpTypePointer:
+				define(instruction, wordCount, 1, 4);
+				break;
+			case OpTypeImage:
+				define(instruction, wordCount, 1, 9);
+				break;
+
+			//-Constants and variables, result id in word 2
+			case OpConstant:
+			case OpVariable:
+				define(instruction, wordCount, 2, 4);
+				break;
+
+			//-Accesses, a variable only counts as used once a function reaches it
+			case OpFunction:
+				inFunction = true;
+				break;
+			case OpLoad:
+			case OpImageTexelPointer:
+			case OpAccessChain:
+			case OpInBoundsAccessChain:
+			case OpPtrAccessChain:
+				if (wordCount > 3) markUsed(instruction[3]);
+				break;
+			case OpStore:
+			case OpCopyMemory:
+				if (wordCount > 1) markUsed(instruction[1]);
+				if (wordCount > 2 && opcode == OpCopyMemory) markUsed(instruction[2]);
+				break;
+			case OpFunctionCall:
+				for (uint32_t i = 4; i < wordCount; i++)
+				{
+					markUsed(instruction[i]);
+				}
+				break;
+			}
+		}
+	};
+}
+
+std::vector<VkDescriptorPoolSize> ShaderLayout::getPoolSizes(uint32_t set, uint32_t setCount) const
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	if (set >= sets.size())
+	{
+		return poolSizes;
+	}
+
+	//One pool size per descriptor type
+	for (auto& binding : sets[set])
+	{
+		auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(),
+			[&binding](const VkDescriptorPoolSize& size) { return size.type == binding.descriptorType; });
+		if (poolSize == poolSizes.end())
+		{
+			poolSizes.push_back({ binding.descriptorType, 0 });
+			poolSize = poolSizes.end() - 1;
+		}
+		poolSize->descriptorCount += binding.descriptorCount * setCount;
+	}
+	return poolSizes;
+}
+
+std::vector<VkPushConstantRange> ShaderLayout::getPushConstantRanges() const
+{
+	if (pushConstantRange.size == 0)
+	{
+		return {};
+	}
+	return { pushConstantRange };
+}
+
+void ShaderLayout::setDescriptorCount(uint32_t set, uint32_t binding, uint32_t count)
+{
+	if (set < sets.size())
+	{
+		for (auto& layoutBinding : sets[set])
+		{
+			if (layoutBinding.binding == binding)
+			{
+				layoutBinding.descriptorCount = count;
+				return;
+			}
+		}
+	}
+	throw std::runtime_error("Failed to resize set " + std::to_string(set) + " binding " + std::to_string(binding) + ", no shader uses it!");
+}
+
+VkDescriptorSetLayout ShaderLayout::createSetLayout(VkDevice device, uint32_t set, VkDescriptorSetLayoutCreateFlags flags, const void* pNext) const
+{
+	//A set no stage uses still gets a (empty) layout, so the sets after it keep their numbers
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	if (set < sets.size())
+	{
+		bindings = sets[set];
+	}
+	for (auto& binding : bindings)
+	{
+		if (binding.descriptorCount == 0)
+		{
+			throw std::runtime_error("Failed to create a Descriptor Set Layout, runtime sized arrays need a descriptor count!");
+		}
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = pNext;
+	layoutCreateInfo.flags = flags;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout setLayout;
+	VkResult result = vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &setLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Descriptor Set Layout!");
+	}
+	return setLayout;
+}
+
+ShaderReflection::ShaderReflection()
+{
+}
+
+const ShaderLayout& ShaderReflection::getLayout(const std::vector<std::string>& fileNames)
+{
+	std::string key;
+	for (auto& fileName : fileNames)
+	{
+		key += fileName + "\n";
+	}
+
+	auto merged = mergedLayouts.find(key);
+	if (merged != mergedLayouts.end())
+	{
+		return merged->second;
+	}
+
+	ShaderLayout layout;
+	for (auto& fileName : fileNames)
+	{
+		auto module = moduleLayouts.find(fileName);
+		if (module == moduleLayouts.end())
+		{
+			module = moduleLayouts.emplace(fileName, reflect(readFile(fileName), fileName)).first;
+		}
+		merge(layout, module->second, fileName);
+	}
+	return mergedLayouts.emplace(key, layout).first->second;
+}
+
+ShaderLayout ShaderReflection::reflect(const std::vector<char>& code, const std::string& fileName)
+{
+	SpirvModule module(code, fileName);
+	ShaderLayout layout;
+
+	for (auto& variable : module.ids)
+	{
+		if (variable.words.empty() || (variable.words[0] & 0xFFFF) != OpVariable || !variable.used)
+		{
+			continue;
+		}
+
+		//OpVariable: result type (a pointer), result id, storage class
+		uint32_t storageClass = variable.words[3];
+		uint32_t pointerId = variable.words[1];
+		if (module.getOpcode(pointerId) != OpTypePointer)
+		{
+			module.fail("variable is not a pointer");
+		}
+		uint32_t typeId = module.get(pointerId).words[3];
+
+		if (storageClass == StorageClassPushConstant)
+		{
+			uint32_t first = module.getFirstOffset(typeId);
+			layout.pushConstantRange.stageFlags = module.stages;
+			layout.pushConstantRange.offset = first;
+			layout.pushConstantRange.size = module.getTypeSize(typeId, 0) - first;
+			continue;
+		}
+		if (storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform && storageClass != StorageClassStorageBuffer)
+		{
+			continue;
+		}
+		if (!variable.hasBinding)
+		{
+			module.fail("resource without a binding");
+		}
+
+		//Arrays of resources are one binding with several descriptors, runtime sized ones are left at 0 for the caller
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = variable.binding;
+		binding.descriptorCount = 1;
+		while (module.getOpcode(typeId) == OpTypeArray || module.getOpcode(typeId) == OpTypeRuntimeArray)
+		{
+			const SpirvId& array = module.get(typeId);
+			binding.descriptorCount = module.getOpcode(typeId) == OpTypeArray ? binding.descriptorCount * module.getConstant(array.words[3]) : 0;
+			typeId = array.words[2];
+		}
+		binding.descriptorType = module.getDescriptorType(typeId, storageClass);
+		binding.stageFlags = module.stages;
+		binding.pImmutableSamplers = nullptr;
+
+		if (variable.set >= layout.sets.size())
+		{
+			layout.sets.resize(variable.set + 1);
+		}
+		layout.sets[variable.set].push_back(binding);
+	}
+
+	//Merging into an empty layout sorts the bindings and catches duplicates
+	ShaderLayout sorted;
+	merge(sorted, layout, fileName);
+	return sorted;
+}
+
+void ShaderReflection::merge(ShaderLayout& target, const ShaderLayout& source, const std::string& fileName)
+{
+	if (source.sets.size() > target.sets.size())
+	{
+		target.sets.resize(source.sets.size());
+	}
+
+	for (size_t set = 0; set < source.sets.size(); set++)
+	{
+		std::vector<VkDescriptorSetLayoutBinding>& targetBindings = target.sets[set];
+		for (auto& binding : source.sets[set])
+		{
+			auto existing = std::lower_bound(targetBindings.begin(), targetBindings.end(), binding.binding,
+				[](const VkDescriptorSetLayoutBinding& a, uint32_t b) { return a.binding < b; });
+			if (existing == targetBindings.end() || existing->binding != binding.binding)
+			{
+				targetBindings.insert(existing, binding);
+				continue;
+			}
+
+			//Same binding seen in an earlier stage: one binding visible to both
+			if (existing->descriptorType != binding.descriptorType)
+			{
+				throw std::runtime_error("Failed to merge shader layouts, " + fileName + " declares set " + std::to_string(set) +
+					" binding " + std::to_string(binding.binding) + " with a different type!");
+			}
+			existing->stageFlags |= binding.stageFlags;
+			existing->descriptorCount = std::max(existing->descriptorCount, binding.descriptorCount);
+		}
+	}
+
+	//Single range covering every stage's block, pushes must then name all of its stages
+	if (source.pushConstantRange.size != 0)
+	{
+		if (target.pushConstantRange.size == 0)
+		{
+			target.pushConstantRange = source.pushConstantRange;
+		}
+		else
+		{
+			uint32_t end = std::max(target.pushConstantRange.offset + target.pushConstantRange.size,
+				source.pushConstantRange.offset + source.pushConstantRange.size);
+			target.pushConstantRange.offset = std::min(target.pushConstantRange.offset, source.pushConstantRange.offset);
+			target.pushConstantRange.size = end - target.pushConstantRange.offset;
+			target.pushConstantRange.stageFlags |= source.pushConstantRange.stageFlags;
+		}
+	}
+}
+
+ShaderReflection::~ShaderReflection()
+{
+}
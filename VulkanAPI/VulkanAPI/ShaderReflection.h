@@ -0,0 +1,45 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<unordered_map>
+#include<stdexcept>
+#include"Utilities.h"
+
+//Descriptor bindings and push constants a group of shader stages uses, merged across the stages
+struct ShaderLayout
+{
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;		//Indexed by set number, bindings sorted by binding number
+	VkPushConstantRange pushConstantRange = {};		//size 0 = no push constants
+
+	//Descriptors needed for setCount sets of the given layout
+	std::vector<VkDescriptorPoolSize> getPoolSizes(uint32_t set, uint32_t setCount) const;
+	std::vector<VkPushConstantRange> getPushConstantRanges() const;
+
+	//Runtime sized arrays are reflected with 0 descriptors, the caller picks their size
+	void setDescriptorCount(uint32_t set, uint32_t binding, uint32_t count);
+
+	//Caller owns the layout, pNext can carry e.g. binding flags
+	VkDescriptorSetLayout createSetLayout(VkDevice device, uint32_t set, VkDescriptorSetLayoutCreateFlags flags = 0, const void* pNext = nullptr) const;
+};
+
+//Reads descriptor and push constant declarations straight out of compiled SPIR-V, so layouts can't drift from the shaders
+//Only resources a stage actually reads are kept, declared but unused blocks don't cost descriptors
+class ShaderReflection
+{
+public:
+	ShaderReflection();
+
+	//Merged layout of the given modules, each file is parsed once and each combination merged once
+	const ShaderLayout& getLayout(const std::vector<std::string>& fileNames);
+
+	~ShaderReflection();
+
+private:
+	std::unordered_map<std::string, ShaderLayout> moduleLayouts;		//Per file
+	std::unordered_map<std::string, ShaderLayout> mergedLayouts;		//Per file list
+
+	static ShaderLayout reflect(const std::vector<char>& code, const std::string& fileName);
+	static void merge(ShaderLayout& target, const ShaderLayout& source, const std::string& fileName);
+};
@@ -1,5 +1,13 @@
 C:/VulkanSDK/1.2.148.0/Bin32/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.2.148.0/Bin32/glslangValidator.exe -V shader.frag
+C:/VulkanSDK/1.2.148.0/Bin32/glslangValidator.exe -o frag_bindless.spv -V shader_bindless.frag
 C:/VulkanSDK/1.2.148.0/Bin32/glslangValidator.exe -o second_vert.spv -V second.vert
 C:/VulkanSDK/1.2.148.0/Bin32/glslangValidator.exe -o second_frag.spv -V second.frag
+C:/VulkanSDK/1.2.148.0/Bin32/glslangValidator.exe -o mipmap_comp.spv -V mipmap.comp
+C:/VulkanSDK/1.2.148.0/Bin32/spirv-val.exe --target-env vulkan1.0 vert.spv
+C:/VulkanSDK/1.2.148.0/Bin32/spirv-val.exe --target-env vulkan1.0 frag.spv
+C:/VulkanSDK/1.2.148.0/Bin32/spirv-val.exe --target-env vulkan1.0 frag_bindless.spv
+C:/VulkanSDK/1.2.148.0/Bin32/spirv-val.exe --target-env vulkan1.0 second_vert.spv
+C:/VulkanSDK/1.2.148.0/Bin32/spirv-val.exe --target-env vulkan1.0 second_frag.spv
+C:/VulkanSDK/1.2.148.0/Bin32/spirv-val.exe --target-env vulkan1.0 mipmap_comp.spv
 pause
\ No newline at end of file
@@ -5,15 +5,21 @@ layout (input_attachment_index=1, binding=1) uniform subpassInput inputDepth;	//
 
 layout (location=0) out vec4 color;
 
+//Specialization constants, set per pipeline (ids must match ShaderPermutation.h)
+layout (constant_id=0) const bool DEPTH_SPLIT=true;		//Right half of the screen shows depth
+layout (constant_id=1) const int SCREEN_WIDTH=800;
+layout (constant_id=2) const float DEPTH_LOWER=0.95;		//Depth shown at full brightness
+layout (constant_id=3) const float DEPTH_UPPER=1.0;		//Depth shown black
+
 void main()
 {
 	//color=subpassLoad(inputColor).rgba;
 	//color.g=0.0f;
-	int xHalf=800/2;
-	if(gl_FragCoord.x>xHalf)
+	int xHalf=SCREEN_WIDTH/2;
+	if(DEPTH_SPLIT && gl_FragCoord.x>xHalf)
 	{
-		float lowerBound=0.95;
-		float upperBound=1;
+		float lowerBound=DEPTH_LOWER;
+		float upperBound=DEPTH_UPPER;
 		float depth=subpassLoad(inputDepth).r;
 		float depthColorScaled=1.0f-((depth-lowerBound)/(upperBound-lowerBound));
 		color=vec4(depthColorScaled*subpassLoad(inputColor).rgb,1.0f);
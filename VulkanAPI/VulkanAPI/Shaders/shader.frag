@@ -9,8 +9,16 @@ layout (set=1,binding=0) uniform sampler2D textureSampler;
 
 layout(location=0) out vec4 outcolor;	//Final output color (must also have location)
 
+//Material features, set per pipeline (ids must match ShaderPermutation.h)
+layout (constant_id=0) const bool TEXTURED=true;
+layout (constant_id=1) const bool VERTEX_COLOR=false;
+
 void main(){
 	//outcolor=vec4(fragcolor,1.0);
 	//outcolor=vec4(fragcolor,1.0);
-	outcolor=texture(textureSampler,fragTex);
+	outcolor=TEXTURED ? texture(textureSampler,fragTex) : vec4(1.0);
+	if(VERTEX_COLOR)
+	{
+		outcolor.rgb*=fragcolor;
+	}
 }
\ No newline at end of file
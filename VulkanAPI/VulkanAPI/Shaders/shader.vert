@@ -8,11 +8,6 @@ layout (set=0,binding=0) uniform UboViewProjection{
 	mat4 view;
 }uboViewProjection;
 
-//NOT IN USE, LEFT FOR REFERENCE
-layout (set=0,binding=1) uniform UboModel{
-	mat4 model;	
-}uboModel;
-
 layout(push_constant) uniform PushModel{
 	mat4 model;
 }pushModel;
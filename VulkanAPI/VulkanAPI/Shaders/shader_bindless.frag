@@ -0,0 +1,28 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location=1) in vec2 fragTex; 
+layout(location=0) in vec3 fragcolor;
+
+//Every texture, partially bound: only indices that have been registered may be sampled
+layout (set=1,binding=0) uniform sampler2D textures[];
+
+//Follows PushModel of the vertex shader in the same push constant range
+layout(push_constant) uniform PushTexture{
+	layout(offset=64) uint textureIndex;
+}pushTexture;
+
+layout(location=0) out vec4 outcolor;	//Final output color (must also have location)
+
+//Material features, set per pipeline (ids must match ShaderPermutation.h)
+layout (constant_id=0) const bool TEXTURED=true;
+layout (constant_id=1) const bool VERTEX_COLOR=false;
+
+void main(){
+	//Index is the same for the whole draw, so no nonuniformEXT needed
+	outcolor=TEXTURED ? texture(textures[pushTexture.textureIndex],fragTex) : vec4(1.0);
+	if(VERTEX_COLOR)
+	{
+		outcolor.rgb*=fragcolor;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "TextureCache.h"
+#include "Utilities.h"
+#include<algorithm>
+#include<cctype>
+
+TextureCache::TextureCache()
+{
+}
+
+void TextureCache::init(bool newHashContents)
+{
+	hashContents = newHashContents;
+}
+
+void TextureCache::destroy()
+{
+	//Images are destroyed by the renderer, only forget them
+	textures.clear();
+	pathTextures.clear();
+	contentTextures.clear();
+	hits = 0;
+	uniqueBytes = 0;
+	savedBytes = 0;
+}
+
+std::string TextureCache::getCanonicalPath(const std::string& fileName)
+{
+	std::string path = fileName;
+	std::replace(path.begin(), path.end(), '\\', '/');
+#ifdef _WIN32
+	std::transform(path.begin(), path.end(), path.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+#endif
+
+	//Drop "." and empty parts, resolve ".." against the part before it
+	std::vector<std::string> parts;
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find('/', start);
+		if (end == std::string::npos) end = path.size();
+		std::string part = path.substr(start, end - start);
+
+		if (part == "..")
+		{
+			if (!parts.empty() && parts.back() != "..") parts.pop_back();
+			else parts.push_back(part);
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back(part);
+		}
+		start = end + 1;
+	}
+
+	std::string canonicalPath = (!path.empty() && path[0] == '/') ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		canonicalPath += (i > 0 ? "/" : "") + parts[i];
+	}
+	return canonicalPath;
+}
+
+uint64_t TextureCache::getContentHash(const std::string& path) const
+{
+	if (!hashContents)
+	{
+		return 0;
+	}
+
+	std::vector<char> bytes = readFile(path);
+	uint64_t hash = 14695981039346656037ull;
+	for (char byte : bytes)
+	{
+		hash ^= static_cast<uint8_t>(byte);
+		hash *= 1099511628211ull;
+	}
+	return hash == 0 ? 1 : hash;		//0 means "not hashed"
+}
+
+int TextureCache::acquire(const std::string& path, uint64_t contentHash)
+{
+	auto pathTexture = pathTextures.find(path);
+	int textureId = pathTexture != pathTextures.end() ? pathTexture->second : -1;
+	if (textureId < 0 && contentHash != 0)
+	{
+		auto contentTexture = contentTextures.find(contentHash);
+		if (contentTexture != contentTextures.end())
+		{
+			//Same image under another name, later lookups by this name hit directly
+			textureId = contentTexture->second;
+			pathTextures[path] = textureId;
+		}
+	}
+	if (textureId < 0)
+	{
+		return -1;
+	}
+
+	CachedTexture& texture = textures.at(textureId);
+	texture.references++;
+	hits++;
+	savedBytes += texture.bytes;
+	return textureId;
+}
+
+void TextureCache::add(int textureId, const CachedTexture& texture)
+{
+	CachedTexture& newTexture = textures[textureId];
+	newTexture = texture;
+	newTexture.references = 1;
+	pathTextures[texture.path] = textureId;
+	if (texture.contentHash != 0)
+	{
+		contentTextures[texture.contentHash] = textureId;
+	}
+	uniqueBytes += texture.bytes;
+}
+
+bool TextureCache::release(int textureId, CachedTexture* releasedTexture)
+{
+	auto texture = textures.find(textureId);
+	if (texture == textures.end())
+	{
+		throw std::runtime_error("Failed to release a texture, it isn't loaded!");
+	}
+
+	if (texture->second.references > 1)
+	{
+		texture->second.references--;
+		savedBytes -= texture->second.bytes;
+		return false;
+	}
+
+	//Last reference: forget every name and the contents that led to it
+	for (auto pathTexture = pathTextures.begin(); pathTexture != pathTextures.end();)
+	{
+		pathTexture = pathTexture->second == textureId ? pathTextures.erase(pathTexture) : std::next(pathTexture);
+	}
+	contentTextures.erase(texture->second.contentHash);
+	uniqueBytes -= texture->second.bytes;
+
+	*releasedTexture = texture->second;
+	textures.erase(texture);
+	return true;
+}
+
+TextureCache::~TextureCache()
+{
+}
@@ -0,0 +1,65 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<unordered_map>
+#include<stdexcept>
+
+//One loaded texture shared by everything that referenced the same file
+struct CachedTexture
+{
+	std::string path;		//Canonical
+	uint64_t contentHash = 0;		//0 when content hashing is off
+	int image = -1;		//Index into the renderer's texture image vectors
+	VkDeviceSize bytes = 0;		//Device memory of the image
+	uint32_t references = 0;
+};
+
+//Texture ids handed out by VulkanRender::createTexture, reference counted by canonical path and optionally
+//by file contents, so materials and models naming the same image share one image, view and descriptor
+class TextureCache
+{
+public:
+	TextureCache();
+
+	//hashContents: also match identical files under different names, costs reading each file once more
+	void init(bool newHashContents);
+	void destroy();
+
+	//"Textures/./a\\b.png" and "Textures/a/b.png" give the same key (case folded on Windows)
+	static std::string getCanonicalPath(const std::string& fileName);
+
+	//FNV-1a of the whole file, 0 when hashing is off. Thread safe, texture decode jobs call it
+	uint64_t getContentHash(const std::string& path) const;
+
+	//Id of a texture already loaded from this path or contents, with one more reference. -1 when it has to be loaded
+	int acquire(const std::string& path, uint64_t contentHash);
+
+	//Newly loaded texture, starts with one reference
+	void add(int textureId, const CachedTexture& texture);
+
+	//Drops a reference, true when it was the last one: the entry is removed and copied to releasedTexture to be destroyed
+	bool release(int textureId, CachedTexture* releasedTexture);
+
+	//False once the last reference is released
+	bool isLoaded(int textureId) { return textures.count(textureId) > 0; };
+	uint32_t getReferences(int textureId) { return isLoaded(textureId) ? textures.at(textureId).references : 0; };
+
+	uint64_t getHits() { return hits; };
+	size_t getTextureCount() { return textures.size(); };
+	VkDeviceSize getUniqueBytes() { return uniqueBytes; };
+	VkDeviceSize getSavedBytes() { return savedBytes; };		//What the extra references would have allocated
+
+	~TextureCache();
+
+private:
+	bool hashContents = false;
+	std::unordered_map<int, CachedTexture> textures;		//By texture id
+	std::unordered_map<std::string, int> pathTextures;
+	std::unordered_map<uint64_t, int> contentTextures;
+
+	uint64_t hits = 0;
+	VkDeviceSize uniqueBytes = 0;
+	VkDeviceSize savedBytes = 0;
+};
@@ -0,0 +1,291 @@
+#include "TextureFile.h"
+#include "Utilities.h"
+#include<cstring>
+#include<algorithm>
+#include<cctype>
+
+namespace
+{
+	const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const size_t KTX2_LEVEL_INDEX_OFFSET = 80;		//Header (48) + index of dfd/kvd/sgd (32)
+
+	const uint32_t DDS_MAGIC = 0x20534444;		//"DDS "
+	const size_t DDS_HEADER_END = 128;		//Magic + DDS_HEADER
+	const size_t DDS_DX10_HEADER_SIZE = 20;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+	const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+
+	constexpr uint32_t fourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<unsigned char>(a)) | (static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8) |
+			(static_cast<uint32_t>(static_cast<unsigned char>(c)) << 16) | (static_cast<uint32_t>(static_cast<unsigned char>(d)) << 24);
+	}
+
+	//Little endian value at offset, throws past the end of the file
+	template<typename T>
+	T readValue(const std::vector<char>& bytes, size_t offset, const std::string& fileName)
+	{
+		if (offset + sizeof(T) > bytes.size())
+		{
+			throw std::runtime_error("Failed to read a texture file, it is truncated! (" + fileName + ")");
+		}
+		T value;
+		memcpy(&value, bytes.data() + offset, sizeof(T));
+		return value;
+	}
+
+	//The stb_image path uploads sRGB encoded pixels as UNORM, compressed textures must look the same
+	VkFormat toUnormFormat(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_SRGB: return VK_FORMAT_R8G8B8A8_UNORM;
+		case VK_FORMAT_B8G8R8A8_SRGB: return VK_FORMAT_B8G8R8A8_UNORM;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case VK_FORMAT_BC2_SRGB_BLOCK: return VK_FORMAT_BC2_UNORM_BLOCK;
+		case VK_FORMAT_BC3_SRGB_BLOCK: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case VK_FORMAT_BC7_SRGB_BLOCK: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK: return VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK: return VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK;
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK: return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: return VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_5x4_SRGB_BLOCK: return VK_FORMAT_ASTC_5x4_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_5x5_SRGB_BLOCK: return VK_FORMAT_ASTC_5x5_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_6x5_SRGB_BLOCK: return VK_FORMAT_ASTC_6x5_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_6x6_SRGB_BLOCK: return VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_8x5_SRGB_BLOCK: return VK_FORMAT_ASTC_8x5_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_8x6_SRGB_BLOCK: return VK_FORMAT_ASTC_8x6_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_8x8_SRGB_BLOCK: return VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_10x5_SRGB_BLOCK: return VK_FORMAT_ASTC_10x5_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_10x6_SRGB_BLOCK: return VK_FORMAT_ASTC_10x6_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_10x8_SRGB_BLOCK: return VK_FORMAT_ASTC_10x8_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_10x10_SRGB_BLOCK: return VK_FORMAT_ASTC_10x10_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_12x10_SRGB_BLOCK: return VK_FORMAT_ASTC_12x10_UNORM_BLOCK;
+		case VK_FORMAT_ASTC_12x12_SRGB_BLOCK: return VK_FORMAT_ASTC_12x12_UNORM_BLOCK;
+		default: return format;
+		}
+	}
+
+	//DDS only stores level sizes implicitly, 0 for formats DDS files aren't read with
+	size_t getDdsLevelSize(VkFormat format, uint32_t width, uint32_t height)
+	{
+		size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+			return blocks * 8;
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return blocks * 16;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return static_cast<size_t>(width) * height * 4;
+		default:
+			return 0;
+		}
+	}
+
+	VkFormat getDxgiFormat(uint32_t dxgiFormat)
+	{
+		switch (dxgiFormat)
+		{
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+		case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+		case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+		case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkFormat getFourCCFormat(uint32_t code)
+	{
+		switch (code)
+		{
+		case fourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;		//May use 1 bit alpha
+		case fourCC('D', 'X', 'T', '3'): return VK_FORMAT_BC2_UNORM_BLOCK;
+		case fourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+		case fourCC('A', 'T', 'I', '1'):
+		case fourCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+		case fourCC('A', 'T', 'I', '2'):
+		case fourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	TextureFile parseKtx2(const std::string& fileName, std::vector<char> bytes)
+	{
+		TextureFile texture;
+		VkFormat format = static_cast<VkFormat>(readValue<uint32_t>(bytes, 12, fileName));
+		texture.width = readValue<uint32_t>(bytes, 20, fileName);
+		texture.height = readValue<uint32_t>(bytes, 24, fileName);
+		uint32_t depth = readValue<uint32_t>(bytes, 28, fileName);
+		uint32_t layerCount = readValue<uint32_t>(bytes, 32, fileName);
+		uint32_t faceCount = readValue<uint32_t>(bytes, 36, fileName);
+		uint32_t levelCount = std::max(readValue<uint32_t>(bytes, 40, fileName), 1u);		//0 = generate levels at load
+		uint32_t supercompression = readValue<uint32_t>(bytes, 44, fileName);
+
+		//VK_FORMAT_UNDEFINED is Basis Universal, which would need transcoding
+		if (format == VK_FORMAT_UNDEFINED || supercompression != 0)
+		{
+			throw std::runtime_error("Failed to load a texture, KTX2 supercompression and Basis Universal aren't supported! (" + fileName + ")");
+		}
+		if (texture.width == 0 || texture.height == 0 || depth > 1 || layerCount > 1 || faceCount != 1)
+		{
+			throw std::runtime_error("Failed to load a texture, only single 2D KTX2 images are supported! (" + fileName + ")");
+		}
+		texture.format = toUnormFormat(format);
+
+		//Level index: byteOffset, byteLength, uncompressedByteLength per level, base level first
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			size_t entry = KTX2_LEVEL_INDEX_OFFSET + i * 3 * sizeof(uint64_t);
+			TextureLevel level;
+			level.offset = static_cast<size_t>(readValue<uint64_t>(bytes, entry, fileName));
+			level.size = static_cast<size_t>(readValue<uint64_t>(bytes, entry + sizeof(uint64_t), fileName));
+			level.width = std::max(texture.width >> i, 1u);
+			level.height = std::max(texture.height >> i, 1u);
+			if (level.size == 0 || level.offset + level.size > bytes.size())
+			{
+				throw std::runtime_error("Failed to load a texture, a KTX2 level is outside the file! (" + fileName + ")");
+			}
+			texture.levels.push_back(level);
+		}
+
+		texture.data = std::move(bytes);
+		return texture;
+	}
+
+	TextureFile parseDds(const std::string& fileName, std::vector<char> bytes)
+	{
+		TextureFile texture;
+		uint32_t flags = readValue<uint32_t>(bytes, 8, fileName);
+		texture.height = readValue<uint32_t>(bytes, 12, fileName);
+		texture.width = readValue<uint32_t>(bytes, 16, fileName);
+		uint32_t levelCount = (flags & DDSD_MIPMAPCOUNT) ? std::max(readValue<uint32_t>(bytes, 28, fileName), 1u) : 1;
+		uint32_t pixelFlags = readValue<uint32_t>(bytes, 80, fileName);
+		uint32_t code = readValue<uint32_t>(bytes, 84, fileName);
+		uint32_t caps2 = readValue<uint32_t>(bytes, 112, fileName);
+
+		size_t dataOffset = DDS_HEADER_END;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		if ((pixelFlags & DDPF_FOURCC) && code == fourCC('D', 'X', '1', '0'))
+		{
+			format = getDxgiFormat(readValue<uint32_t>(bytes, DDS_HEADER_END, fileName));
+			uint32_t arraySize = readValue<uint32_t>(bytes, DDS_HEADER_END + 12, fileName);
+			if (arraySize > 1)
+			{
+				throw std::runtime_error("Failed to load a texture, DDS arrays aren't supported! (" + fileName + ")");
+			}
+			dataOffset += DDS_DX10_HEADER_SIZE;
+		}
+		else if (pixelFlags & DDPF_FOURCC)
+		{
+			format = getFourCCFormat(code);
+		}
+		else if ((pixelFlags & DDPF_RGB) && readValue<uint32_t>(bytes, 88, fileName) == 32)
+		{
+			//32 bit RGB(A), red mask tells the channel order
+			uint32_t redMask = readValue<uint32_t>(bytes, 92, fileName);
+			format = redMask == 0x000000ff ? VK_FORMAT_R8G8B8A8_UNORM : redMask == 0x00ff0000 ? VK_FORMAT_B8G8R8A8_UNORM : VK_FORMAT_UNDEFINED;
+		}
+
+		if (format == VK_FORMAT_UNDEFINED)
+		{
+			throw std::runtime_error("Failed to load a texture, unsupported DDS format! (" + fileName + ")");
+		}
+		if (texture.width == 0 || texture.height == 0 || (caps2 & DDSCAPS2_CUBEMAP))
+		{
+			throw std::runtime_error("Failed to load a texture, only single 2D DDS images are supported! (" + fileName + ")");
+		}
+
+		//Levels follow each other right after the headers, largest first
+		size_t offset = dataOffset;
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			TextureLevel level;
+			level.offset = offset;
+			level.width = std::max(texture.width >> i, 1u);
+			level.height = std::max(texture.height >> i, 1u);
+			level.size = getDdsLevelSize(format, level.width, level.height);
+			if (level.offset + level.size > bytes.size())
+			{
+				throw std::runtime_error("Failed to load a texture, a DDS level is outside the file! (" + fileName + ")");
+			}
+			texture.levels.push_back(level);
+			offset += level.size;
+		}
+
+		texture.format = toUnormFormat(format);
+		texture.data = std::move(bytes);
+		return texture;
+	}
+
+	std::string getLowerExtension(const std::string& fileName)
+	{
+		size_t dot = fileName.find_last_of('.');
+		if (dot == std::string::npos) return "";
+
+		std::string extension = fileName.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+		return extension;
+	}
+}
+
+bool isCompressedTextureFile(const std::string& fileName)
+{
+	std::string extension = getLowerExtension(fileName);
+	return extension == ".ktx2" || extension == ".dds";
+}
+
+std::vector<std::string> getCompressedTextureNames(const std::string& fileName)
+{
+	size_t dot = fileName.find_last_of('.');
+	size_t slash = fileName.find_last_of("/\\");
+	std::string baseName = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? fileName : fileName.substr(0, dot);
+	return { baseName + ".ktx2", baseName + ".dds" };
+}
+
+TextureFile parseTextureFile(const std::string& fileName, std::vector<char> bytes)
+{
+	if (bytes.size() >= sizeof(KTX2_IDENTIFIER) && memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+	{
+		return parseKtx2(fileName, std::move(bytes));
+	}
+	if (bytes.size() >= sizeof(DDS_MAGIC) && readValue<uint32_t>(bytes, 0, fileName) == DDS_MAGIC)
+	{
+		return parseDds(fileName, std::move(bytes));
+	}
+	throw std::runtime_error("Failed to load a texture, not a KTX2 or DDS file! (" + fileName + ")");
+}
+
+TextureFile readTextureFile(const std::string& fileName)
+{
+	return parseTextureFile(fileName, readFile(fileName));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+#include<string>
+#include<vector>
+#include<stdexcept>
+
+//One stored mip level, largest first
+struct TextureLevel
+{
+	size_t offset = 0;		//Into TextureFile::data
+	size_t size = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+//Pre-compressed texture as stored on disk (KTX2 or DDS): kept in its block format with every stored mip level,
+//so it is copied to the GPU as is instead of being decoded
+struct TextureFile
+{
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<TextureLevel> levels;
+	std::vector<char> data;		//Whole file, levels are tightly packed rows / blocks inside it
+};
+
+//.ktx2 or .dds, by extension
+bool isCompressedTextureFile(const std::string& fileName);
+
+//Names of pre-compressed files that replace a decoded one (e.g. "brick.png" -> "brick.ktx2"), checked in this order
+std::vector<std::string> getCompressedTextureNames(const std::string& fileName);
+
+//KTX2 without supercompression, DDS with a FourCC (DXT1/3/5, ATI1/2) or DX10 header. Single 2D images only,
+//sRGB formats are read as their UNORM twin because decoded textures aren't linearized either. Throws on anything else.
+TextureFile parseTextureFile(const std::string& fileName, std::vector<char> bytes);
+TextureFile readTextureFile(const std::string& fileName);
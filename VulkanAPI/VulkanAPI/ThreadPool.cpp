@@ -0,0 +1,67 @@
+#include "ThreadPool.h"
+#include "CpuProfiler.h"
+#include<algorithm>
+
+ThreadPool::ThreadPool()
+{
+}
+
+void ThreadPool::start(const std::string& name, uint32_t threadCount)
+{
+	if (!workers.empty()) return;
+
+	if (threadCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+	}
+
+	threadName = name;
+	stopping = false;
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+void ThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+}
+
+void ThreadPool::workerLoop()
+{
+	//All workers of the pool show up under the same name in traces
+	CPU_PROFILE_THREAD(threadName.c_str());
+
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return stopping || !queue.empty(); });
+
+			//Queued jobs still run after stop, their futures would never be ready otherwise
+			if (queue.empty()) return;
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		job();
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	stop();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include<vector>
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<future>
+#include<memory>
+#include<string>
+
+//Fixed set of worker threads running queued jobs in submit order
+class ThreadPool
+{
+public:
+	ThreadPool();
+
+	//threadCount 0 = one per hardware thread minus the main thread (at least one)
+	void start(const std::string& name, uint32_t threadCount = 0);
+
+	//Runs the queued jobs, then joins the workers
+	void stop();
+
+	uint32_t getThreadCount() { return static_cast<uint32_t>(workers.size()); };
+
+	//Exceptions thrown by the job are rethrown by the future's get()
+	template<typename Job>
+	auto submit(Job job) -> std::future<decltype(job())>
+	{
+		typedef decltype(job()) Result;
+		std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+		std::future<Result> future = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			queue.push_back([task]() { (*task)(); });
+		}
+		queueCondition.notify_one();
+		return future;
+	}
+
+	~ThreadPool();
+
+private:
+	std::string threadName;
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> queue;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping = false;
+
+	void workerLoop();
+};
@@ -1,12 +1,30 @@
 #pragma once
 
 #include<fstream>
+#include<vector>
+#include<string>
+#include<algorithm>
 #define GLFW_INCLUED_VULKAN
 #include<GLFW/glfw3.h>
 #include<glm/glm.hpp>
+#include"MemoryStats.h"
 const int MAX_FRAME_DRAWS = 2;
-const int MAX_OBJECTS = 200;
+
+//-Compiled shaders (built from the GLSL sources by Shaders/Shaders.targets), descriptor and push constant layouts are reflected from these
+const char* const GEOMETRY_VERTEX_SHADER = "Shaders/vert.spv";
+const char* const GEOMETRY_FRAGMENT_SHADER = "Shaders/frag.spv";
+const char* const GEOMETRY_BINDLESS_FRAGMENT_SHADER = "Shaders/frag_bindless.spv";
+const char* const POST_VERTEX_SHADER = "Shaders/second_vert.spv";
+const char* const POST_FRAGMENT_SHADER = "Shaders/second_frag.spv";
+const char* const MIPMAP_COMPUTE_SHADER = "Shaders/mipmap_comp.spv";
+
 const std::vector<const char*>deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+#ifdef VK_EXT_shader_object
+//VK_EXT_shader_object and what it depends on when the device is used as Vulkan 1.0
+const std::vector<const char*> shaderObjectExtensions = { VK_KHR_MULTIVIEW_EXTENSION_NAME, VK_KHR_MAINTENANCE_2_EXTENSION_NAME,
+	VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+	VK_EXT_SHADER_OBJECT_EXTENSION_NAME };
+#endif
 
 
 struct Vertex
@@ -36,6 +54,75 @@ struct SwapChainDetails
 	std::vector<VkPresentModeKHR> presentationModes;		//How images should be presented to screen
 };
 
+//How draws get their shaders and fixed-function state
+enum class RenderBackend
+{
+	Pipelines,			//VkPipeline per render state variant
+	ShaderObjects		//VK_EXT_shader_object, state set while recording (falls back to Pipelines if unsupported)
+};
+
+static const char* getRenderBackendName(RenderBackend backend)
+{
+	return backend == RenderBackend::ShaderObjects ? "shader-objects" : "pipelines";
+}
+
+//Parse a --backend value, returns false for unknown names
+static bool parseRenderBackend(const std::string& name, RenderBackend* backend)
+{
+	if (name == "pipelines") *backend = RenderBackend::Pipelines;
+	else if (name == "shader-objects") *backend = RenderBackend::ShaderObjects;
+	else return false;
+	return true;
+}
+
+//How draws get their textures
+enum class TextureBinding
+{
+	DescriptorSets,		//Descriptor set per texture, rebound for every mesh
+	Bindless,			//One update-after-bind array of every texture bound per frame, meshes push an index (falls back to DescriptorSets if unsupported)
+	PushDescriptors		//VK_KHR_push_descriptor, each mesh writes its texture into the command buffer, no sets or pools (falls back to DescriptorSets if unsupported)
+};
+
+static const char* getTextureBindingName(TextureBinding binding)
+{
+	if (binding == TextureBinding::Bindless) return "bindless";
+	if (binding == TextureBinding::PushDescriptors) return "push";
+	return "sets";
+}
+
+//Parse a --textures value, returns false for unknown names
+static bool parseTextureBinding(const std::string& name, TextureBinding* binding)
+{
+	if (name == "sets") *binding = TextureBinding::DescriptorSets;
+	else if (name == "bindless") *binding = TextureBinding::Bindless;
+	else if (name == "push") *binding = TextureBinding::PushDescriptors;
+	else return false;
+	return true;
+}
+
+//Optional renderer features, chosen before VulkanRender::init
+struct RenderSettings
+{
+	bool collectStats = false;		//Per frame draw counters, plus pipeline statistics queries when supported
+
+	//Headless: no window, surface or swapchain, frames are rendered into device owned images
+	bool headless = false;
+	uint32_t headlessWidth = 800;
+	uint32_t headlessHeight = 600;
+
+	std::string pipelineCacheFile = "pipeline_cache.bin";		//Compiled pipelines kept between runs (empty = no file)
+	RenderBackend backend = RenderBackend::Pipelines;
+	TextureBinding textureBinding = TextureBinding::DescriptorSets;
+	uint32_t maxBindlessTextures = 65536;		//Size of the bindless texture array, lowered to the device limit
+	bool preferCompressedTextures = true;		//Load "x.ktx2" / "x.dds" next to "x.png" when the device can sample its format
+	bool hashTextureContents = false;		//Share textures of identical files under different names, reads each file once more
+
+	//Post pass shows depth on the right half of the screen, baked into its pipeline as specialization constants
+	bool depthSplit = true;
+	float depthSplitLower = 0.95f;		//Depth shown at full brightness
+	float depthSplitUpper = 1.0f;		//Depth shown black
+};
+
 struct SwapChainImage
 {
 	VkImage image;
@@ -117,7 +204,7 @@ static void createBuffer(VkPhysicalDevice physicalDevice,VkDevice device,VkDevic
 		bufferProperties);																																								
 																																																
 	//Allocate memory to given VkDeciceMemory
-	result = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, bufferMemory);
+	result = MemoryStats::allocate(device, &memoryAllocateInfo, bufferMemory);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to allcoate Vertex Buffer memory!");
@@ -190,12 +277,8 @@ static void copyBuffer(VkDevice device,VkQueue transferQueue,VkCommandPool trans
 	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-	VkBuffer scrBuffer, VkImage image, uint32_t width, uint32_t height)
+static void recordCopyImageBuffer(VkCommandBuffer commandBuffer, VkBuffer scrBuffer, VkImage image, uint32_t width, uint32_t height)
 {
-	//Create Buffer
-	VkCommandBuffer transferCommandBuffer = beginCommandBuffer(device, transferCommandPool);
-
 	VkBufferImageCopy imageRegin = {};
 	imageRegin.bufferOffset = 0;		//Offset into data
 	imageRegin.bufferRowLength = 0; //Row legth of data to calculate data spacing
@@ -208,16 +291,23 @@ static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPoo
 	imageRegin.imageExtent = { width,height,1 };
 
 	//Copy buffer to given image
-	vkCmdCopyBufferToImage(transferCommandBuffer, scrBuffer, image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,& imageRegin);
+	vkCmdCopyBufferToImage(commandBuffer, scrBuffer, image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,& imageRegin);
+}
+
+static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+	VkBuffer scrBuffer, VkImage image, uint32_t width, uint32_t height)
+{
+	//Create Buffer
+	VkCommandBuffer transferCommandBuffer = beginCommandBuffer(device, transferCommandPool);
+
+	recordCopyImageBuffer(transferCommandBuffer, scrBuffer, image, width, height);
 
 	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue,transferCommandBuffer);
 }
 
-static void transitionImageLayout(VkDevice device,VkQueue queue,VkCommandPool commandPool, VkImage image,VkImageLayout oldLayout,VkImageLayout newLayout)
+//Barrier for the first levelCount mip levels, recorded into a command buffer the caller submits
+static void recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t levelCount = 1)
 {
-	//Create buffer
-	VkCommandBuffer commandBuffer = beginCommandBuffer(device,commandPool);
-
 	VkImageMemoryBarrier imageMemoryBarrier = {};
 	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	imageMemoryBarrier.oldLayout = oldLayout;
@@ -227,7 +317,7 @@ static void transitionImageLayout(VkDevice device,VkQueue queue,VkCommandPool co
 	imageMemoryBarrier.image = image;		//image being accessed and modified as part of barriers
 	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
-	imageMemoryBarrier.subresourceRange.levelCount = 1;
+	imageMemoryBarrier.subresourceRange.levelCount = levelCount;
 	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
 	imageMemoryBarrier.subresourceRange.layerCount = 1;
 
@@ -262,7 +352,58 @@ static void transitionImageLayout(VkDevice device,VkQueue queue,VkCommandPool co
 		0, nullptr,										//Memory Barrier count+data
 		0, nullptr,										//Buffer Memory Barrier count + data
 		1, &imageMemoryBarrier);			//Image Memory Barrier count + data
+}
+
+static void transitionImageLayout(VkDevice device,VkQueue queue,VkCommandPool commandPool, VkImage image,VkImageLayout oldLayout,VkImageLayout newLayout)
+{
+	//Create buffer
+	VkCommandBuffer commandBuffer = beginCommandBuffer(device,commandPool);
+
+	recordImageLayoutTransition(commandBuffer, image, oldLayout, newLayout);
 
 	endAndSubmitCommandBuffer(device, commandPool, queue, commandBuffer);
 
 }
+
+//Get the value below which the given fraction (0-1) of samples fall, e.g. 0.99 for p99
+static double percentile(std::vector<double> samples, double fraction)
+{
+	if (samples.empty())
+	{
+		return 0.0;
+	}
+
+	//Nearest rank of the requested fraction, only that element needs to be in sorted position
+	size_t rank = static_cast<size_t>(fraction * (samples.size() - 1) + 0.5);
+	std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+
+	return samples[rank];
+}
+
+//Text with quotes, backslashes and control characters escaped for use inside a JSON string
+static std::string jsonEscape(const std::string& text)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+
+	std::string escaped;
+	for (char c : text)
+	{
+		unsigned char code = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (code < 0x20)
+		{
+			escaped += "\\u00";
+			escaped += hexDigits[code >> 4];
+			escaped += hexDigits[code & 0xF];
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+	return escaped;
+}
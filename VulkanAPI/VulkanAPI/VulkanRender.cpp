@@ -5,36 +5,68 @@ VulkanRender::VulkanRender()
 {
 }
 
-int VulkanRender::init(GLFWwindow* newWindow)
+int VulkanRender::init(GLFWwindow* newWindow, RenderSettings newSettings)
 {
 	window = newWindow;
+	settings = newSettings;
+	CPU_PROFILE_THREAD("Main");
+	int64_t initStart = CpuProfiler::now();
 
 	try
 	{
 		createInstance();
 		//createDebugCallback();
-		createSurface();
-		getPhysicalDevice();
-		createLogicalDevice();
-		createSwapChain();
+		if (settings.headless)
+		{
+			//Nothing to present to, render targets are plain device images instead of swapchain images
+			surface = VK_NULL_HANDLE;
+			swapChain = VK_NULL_HANDLE;
+			getPhysicalDevice();
+			createLogicalDevice();
+			createHeadlessTargets();
+		}
+		else
+		{
+			createSurface();
+			getPhysicalDevice();
+			createLogicalDevice();
+			createSwapChain();
+		}
+		createReadbackBuffers();
 		createRenderPass();
 		createDescriptorSetLayout();
 		createPushConstantRange();
+		pipelineCache.init(mainDevice.physicalDevice, mainDevice.logicalDevice, settings.pipelineCacheFile);
+		pipelineBuilder.init(mainDevice.logicalDevice, pipelineCache.getHandle(), graphicsPipelineLibraryEnabled);
+		pipelineVariants.init(mainDevice.logicalDevice, &pipelineBuilder);
+		int64_t pipelineStart = CpuProfiler::now();
 		createGraphicsPipeline();
+		startupTimes.pipelineMs = (CpuProfiler::now() - pipelineStart) / 1000000.0;
 		createColorBufferImage();
 		createDepthBufferImage();
 		createFramebuffers();
 		createCommandPool();
 		createCommandBuffers();
 		createTextureSampler();
+		textureCache.init(settings.hashTextureContents);
+		textureDecodePool.start("Texture Decode");
+		mipmapGenerator.init(mainDevice.physicalDevice, mainDevice.logicalDevice, getQueueFamilies(mainDevice.physicalDevice).graphicsFamily, &shaderReflection);
 		//allocateDynamicBufferTransferSpace();
 		createUniformBuffers();
-		createDescriptorPool();
+		createDescriptorAllocators();
 		createDescriptorSets();
 		createInputDescriptorSets();
 		//recordCommands();
 		createSynchronisation();
 
+		gpuProfiler.init(mainDevice.physicalDevice, mainDevice.logicalDevice, getQueueFamilies(mainDevice.physicalDevice).graphicsFamily, MAX_FRAME_DRAWS);
+		gpuProfiler.setLogInterval(600);
+
+		if (settings.collectStats)
+		{
+			renderStats.init(mainDevice.logicalDevice, pipelineStatisticsEnabled, MAX_FRAME_DRAWS);
+			renderStats.setLogInterval(600);
+		}
 
 		//int firstTexture = createTexture("flower.png");
 
@@ -90,30 +122,135 @@ int VulkanRender::init(GLFWwindow* newWindow)
 		return EXIT_FAILURE;
 	}
 
+	startupTimes.warmPipelineCache = pipelineCache.isWarm();
+	startupTimes.pipelineCacheLoadMs = pipelineCache.getLoadMs();
+	startupTimes.pipelineCacheBytes = pipelineCache.getLoadedBytes();
+	startupTimes.initMs = (CpuProfiler::now() - initStart) / 1000000.0;
+	printf("Startup (%s, %s textures): init %.1f ms, pipelines %.1f ms (%s pipeline cache, %zu bytes loaded in %.1f ms)\n",
+		getRenderBackendName(getBackend()), getTextureBindingName(getTextureBinding()), startupTimes.initMs, startupTimes.pipelineMs, startupTimes.warmPipelineCache ? "warm" : "cold", startupTimes.pipelineCacheBytes, startupTimes.pipelineCacheLoadMs);
+
 	return 0;
 }
 
+void VulkanRender::setModelRenderState(int modelId, const RenderState& state)
+{
+	if (modelId >= modelList.size())return;
+
+	PipelineDescription& description = modelPipelineDescriptions[modelId];
+	description.name = "Geometry variant";
+	description.state = state;
+	if (state.polygonMode != VK_POLYGON_MODE_FILL && !fillModeNonSolidEnabled)
+	{
+		description.state.polygonMode = VK_POLYGON_MODE_FILL;
+	}
+	updateModelPipeline(modelId);
+}
+
+void VulkanRender::setModelMaterialFeatures(int modelId, const MaterialFeatures& features)
+{
+	if (modelId >= modelList.size())return;
+
+	PipelineDescription& description = modelPipelineDescriptions[modelId];
+	description.name = "Geometry variant";
+	description.fragmentPermutation.setFeature(GEOMETRY_TEXTURED_CONSTANT, features.textured);
+	description.fragmentPermutation.setFeature(GEOMETRY_VERTEX_COLOR_CONSTANT, features.vertexColor);
+	updateModelPipeline(modelId);
+}
+
+void VulkanRender::updateModelPipeline(int modelId)
+{
+	const PipelineDescription& description = modelPipelineDescriptions[modelId];
+
+	//Render state is set while recording, only new shader constants create shader objects
+	if (shaderObjectsEnabled)
+	{
+		modelShaderObjects[modelId] = shaderObjects.createShaders(description, { descriptorSetLayout, samplerSetLayout }, geometryShaderLayout.getPushConstantRanges());
+		return;
+	}
+
+	//Same state as another model = same pipeline, only new combinations compile (just a fast link with pipeline libraries)
+	int variantId = pipelineVariants.request(description);
+	pipelineVariants.wait(variantId);
+	modelPipelineVariants[modelId] = variantId;
+}
+
 void VulkanRender::updateModel(int modelId, glm::mat4 newModel)
 {
 	if (modelId >= modelList.size())return;
 	modelList[modelId].setModel(newModel);
 }
 
+int VulkanRender::createModelInstance(int modelId, glm::mat4 newModel, int textureOverride)
+{
+	if (modelId < 0 || modelId >= modelList.size())
+	{
+		throw std::runtime_error("Failed to create a model instance, unknown model!");
+	}
+	if (textureOverride >= static_cast<int>(getTextureCount()) || (textureOverride >= 0 && !textureCache.isLoaded(textureOverride)))
+	{
+		throw std::runtime_error("Failed to create a model instance, unknown texture!");
+	}
+
+	ModelInstance instance = {};
+	instance.modelId = modelId;
+	instance.textureOverride = textureOverride;
+	instance.model = newModel;
+	instanceList.push_back(instance);
+
+	return instanceList.size() - 1;
+}
+
+void VulkanRender::updateModelInstance(int instanceId, glm::mat4 newModel)
+{
+	if (instanceId >= instanceList.size())return;
+	instanceList[instanceId].model = newModel;
+}
+
 void VulkanRender::draw()
 {
+	CPU_PROFILE_FRAME(frameNumber);
+	CPU_PROFILE_FUNCTION();
+
 	//1.Get next available image to draw and set something to signal when we are finnished with the images(a semaphore)
 
 	//--Get Next Image--
 	
-	//Wait for given fence to signal (open) from last draw before continuing
-	vkWaitForFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	//Manually reset (close) fences
-	vkResetFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame]);
+	int64_t waitStart = CpuProfiler::now();
+	{
+		CPU_PROFILE_ZONE("Wait For Fence");
+		//Wait for given fence to signal (open) from last draw before continuing
+		vkWaitForFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		//Manually reset (close) fences
+		vkResetFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame]);
+	}
+	lastWaitTimes.fenceWaitMs = (CpuProfiler::now() - waitStart) / 1000000.0;
+
+	//GPU work of the frame that last used this slot is done, so its timestamps can be read without waiting
+	gpuProfiler.collect(currentFrame);
+	renderStats.collect(currentFrame);
 
 	//Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
+	//The readback buffer of this slot is free again, hand its frame out before it gets overwritten
+	deliverReadbackFrame(currentFrame);
+
 	uint32_t imageIndex;
-	vkAcquireNextImageKHR(mainDevice.logicalDevice, swapChain, std::numeric_limits<uint64_t>::max(), imageAvailable[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	if (settings.headless)
+	{
+		//One render target per frame slot, the fence above already made it free again
+		imageIndex = currentFrame;
+		lastWaitTimes.acquireMs = 0.0;
+	}
+	else
+	{
+		waitStart = CpuProfiler::now();
+		{
+			CPU_PROFILE_ZONE("Acquire Image");
+			vkAcquireNextImageKHR(mainDevice.logicalDevice, swapChain, std::numeric_limits<uint64_t>::max(), imageAvailable[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		}
+		lastWaitTimes.acquireMs = (CpuProfiler::now() - waitStart) / 1000000.0;
+	}
 
+	int64_t submitStart = CpuProfiler::now();
 	recordCommands(imageIndex);
 	updateUniformBuffers(imageIndex);
 	
@@ -135,13 +272,40 @@ void VulkanRender::draw()
 	submitInfo.pCommandBuffers = &commandbuffers[imageIndex];		//Command buffer to submit
 	submitInfo.signalSemaphoreCount = 1;		//Number of semaphores to signal
 	submitInfo.pSignalSemaphores = &renderFinished[currentFrame];		//Semaphores to signal when command buffer finishes
+	if (settings.headless)
+	{
+		//No acquire to wait for and no present to signal, the fence alone tracks the frame
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.signalSemaphoreCount = 0;
+	}
 	//Submit command buffer to queue
-	VkResult result = vkQueueSubmit(graphicsQueue,1,&submitInfo,drawFences[currentFrame]);
+#ifdef ENABLE_CPU_PROFILER
+	//Only the trace export uses it, to line GPU scopes up with CPU zones
+	gpuProfiler.markSubmit(currentFrame, CpuProfiler::now());
+#endif
+	VkResult result;
+	{
+		CPU_PROFILE_ZONE("Queue Submit");
+		result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, drawFences[currentFrame]);
+	}
+	lastWaitTimes.submitMs = (CpuProfiler::now() - submitStart) / 1000000.0;
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to submit Command Buffer to Queue!");
 	}
 
+	//Pipelines created since the last write survive a crash
+	pipelineCache.update(frameNumber);
+
+	if (settings.headless)
+	{
+		//Frame is handed out through the readback callback once its fence signals
+		lastWaitTimes.presentMs = 0.0;
+		currentFrame = (currentFrame + 1) % MAX_FRAME_DRAWS;
+		frameNumber++;
+		return;
+	}
+
 	//3.Present image to screen when it has signalled finished rendering
 	//--Present rendered imageto screen --
 	VkPresentInfoKHR presentInfo = {};
@@ -153,7 +317,12 @@ void VulkanRender::draw()
 	presentInfo.pImageIndices = &imageIndex;		//index of images in swapchains to present
 
 	//Present image
-	result =vkQueuePresentKHR(presentationQueue,&presentInfo);
+	waitStart = CpuProfiler::now();
+	{
+		CPU_PROFILE_ZONE("Queue Present");
+		result = vkQueuePresentKHR(presentationQueue, &presentInfo);
+	}
+	lastWaitTimes.presentMs = (CpuProfiler::now() - waitStart) / 1000000.0;
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to present Image!");
@@ -161,6 +330,33 @@ void VulkanRender::draw()
 
 	//Get next frame(use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
 	currentFrame = (currentFrame + 1) % MAX_FRAME_DRAWS;
+	frameNumber++;
+}
+
+std::string VulkanRender::getDeviceName()
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
+	return deviceProperties.deviceName;
+}
+
+void VulkanRender::flushFrames()
+{
+	vkDeviceWaitIdle(mainDevice.logicalDevice);
+
+	//Oldest frame in flight is the one in the slot that would be reused next
+	for (int i = 0; i < MAX_FRAME_DRAWS; i++)
+	{
+		int frameSlot = (currentFrame + i) % MAX_FRAME_DRAWS;
+		gpuProfiler.collect(frameSlot);
+		renderStats.collect(frameSlot);
+		deliverReadbackFrame(frameSlot);
+	}
+}
+
+bool VulkanRender::writeTrace(const std::string& fileName, uint64_t firstFrame, uint64_t lastFrame)
+{
+	return CpuProfiler::get().writeChromeTrace(fileName, firstFrame, lastFrame, &gpuProfiler.getFrameHistory());
 }
 
 void VulkanRender::cleanup()
@@ -174,44 +370,47 @@ void VulkanRender::cleanup()
 	{
 		modelList[i].destroyModel();
 	}
-	vkDestroyDescriptorPool(mainDevice.logicalDevice,inputDescriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(mainDevice.logicalDevice,inputSetLayout, nullptr);
 
-	vkDestroyDescriptorPool(mainDevice.logicalDevice,samplerDescriptorPool,nullptr);
+	descriptorSetCache.destroy();
+	textureDescriptorAllocator.destroy();
 	vkDestroyDescriptorSetLayout(mainDevice.logicalDevice,samplerSetLayout,nullptr);
 
 	vkDestroySampler(mainDevice.logicalDevice, textureSampler, nullptr);
+	mipmapGenerator.destroy();
+	textureDecodePool.stop();
+	textureCache.destroy();
 
 	for (size_t i = 0; i < textureImages.size(); i++)
 	{
 		vkDestroyImageView(mainDevice.logicalDevice,textureImageViews[i],nullptr);
 		vkDestroyImage(mainDevice.logicalDevice, textureImages[i],nullptr);
-		vkFreeMemory(mainDevice.logicalDevice,textureImageMemory[i],nullptr);
+		MemoryStats::free(mainDevice.logicalDevice, textureImageMemory[i]);
 	}
 
 	for (size_t i = 0; i < depthBufferImage.size(); i++)
 	{
 		vkDestroyImageView(mainDevice.logicalDevice, depthBufferImageView[i], nullptr);
 		vkDestroyImage(mainDevice.logicalDevice, depthBufferImage[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, depthBufferImageMemory[i], nullptr);
+		MemoryStats::free(mainDevice.logicalDevice, depthBufferImageMemory[i]);
 	}
 
 	for (size_t i = 0; i < colorBufferImage.size(); i++)
 	{
 		vkDestroyImageView(mainDevice.logicalDevice, colorBufferImageView[i], nullptr);
 		vkDestroyImage(mainDevice.logicalDevice, colorBufferImage[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, colorBufferImageMemory[i], nullptr);
+		MemoryStats::free(mainDevice.logicalDevice, colorBufferImageMemory[i]);
 	}
 
 
-	vkDestroyDescriptorPool(mainDevice.logicalDevice,descriptorPool,nullptr);
+	descriptorAllocator.destroy();
 
 	vkDestroyDescriptorSetLayout(mainDevice.logicalDevice,descriptorSetLayout,nullptr);
 
 	for (size_t i = 0; i < swapChainImages.size(); i++)
 	{
 		vkDestroyBuffer(mainDevice.logicalDevice,vpUniformBuffer[i],nullptr);
-		vkFreeMemory(mainDevice.logicalDevice,vpUniformBufferMemory[i],nullptr);
+		MemoryStats::free(mainDevice.logicalDevice, vpUniformBufferMemory[i]);
 
 		//vkDestroyBuffer(mainDevice.logicalDevice, modelDUniformBuffer[i], nullptr);
 		//vkFreeMemory(mainDevice.logicalDevice, modelDUniformBufferMemory[i], nullptr);
@@ -229,22 +428,51 @@ void VulkanRender::cleanup()
 		vkDestroyFence(mainDevice.logicalDevice,drawFences[i],nullptr);
 	}
 
+	gpuProfiler.destroy();
+	renderStats.destroy();
+
 	vkDestroyCommandPool(mainDevice.logicalDevice,graphicsCommandPool,nullptr);
 	for (auto framebuffer : swapChainFramebuffers)
 	{
 		vkDestroyFramebuffer(mainDevice.logicalDevice,framebuffer,nullptr);
 	}
-	vkDestroyPipeline(mainDevice.logicalDevice, secondPipeline, nullptr);
+	if (settings.collectStats)
+	{
+		pipelineVariants.printStats();
+	}
+	pipelineVariants.destroy();
+	pipelineBuilder.destroy();
+	if (shaderObjectsEnabled)
+	{
+		shaderObjects.destroy();
+	}
 	vkDestroyPipelineLayout(mainDevice.logicalDevice, secondPipelineLayout, nullptr);
-	vkDestroyPipeline(mainDevice.logicalDevice,graphicsPipeline,nullptr);
 	vkDestroyPipelineLayout(mainDevice.logicalDevice, pipelineLayout, nullptr);
+	pipelineCache.destroy();
 	vkDestroyRenderPass(mainDevice.logicalDevice,renderPass,nullptr);
 	for (auto image : swapChainImages)
 	{
 		vkDestroyImageView(mainDevice.logicalDevice, image.imageView, nullptr);
 	}
-	vkDestroySwapchainKHR(mainDevice.logicalDevice,swapChain,nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	for (size_t i = 0; i < readbackBuffer.size(); i++)
+	{
+		vkUnmapMemory(mainDevice.logicalDevice, readbackBufferMemory[i]);
+		vkDestroyBuffer(mainDevice.logicalDevice, readbackBuffer[i], nullptr);
+		MemoryStats::free(mainDevice.logicalDevice, readbackBufferMemory[i]);
+	}
+	if (settings.headless)
+	{
+		for (size_t i = 0; i < swapChainImages.size(); i++)
+		{
+			vkDestroyImage(mainDevice.logicalDevice, swapChainImages[i].image, nullptr);
+			MemoryStats::free(mainDevice.logicalDevice, headlessImageMemory[i]);
+		}
+	}
+	else
+	{
+		vkDestroySwapchainKHR(mainDevice.logicalDevice, swapChain, nullptr);
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
 	vkDestroyDevice(mainDevice.logicalDevice,nullptr);
 	vkDestroyInstance(instance, nullptr);
 	
@@ -284,8 +512,8 @@ void VulkanRender::createInstance()
 	uint32_t glfwExtensionCount = 0;		//GLFW may require multiple extensions
 	const char** glfwExtensions;				//Extensions passed as array of cstrings, so need pointer (the array) to pointer (the cstring)
 
-	//Get GLFW extensions
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	//Get GLFW extensions (headless needs no surface, so no window system extensions either)
+	glfwExtensions = settings.headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 	//Add GLFW extensions to list of extensions
 	for (size_t i = 0; i < glfwExtensionCount; i++)
@@ -299,6 +527,13 @@ void VulkanRender::createInstance()
 		throw std::runtime_error("VkInstance does not support required extensions!");
 	}
 
+	//Optional, needed to ask the device about extension features on a 1.0 instance
+	physicalDeviceProperties2Enabled = isInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if (physicalDeviceProperties2Enabled)
+	{
+		instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
 	createInfo.enabledExtensionCount =static_cast<uint32_t>(instanceExtensions.size());
 	createInfo.ppEnabledExtensionNames = instanceExtensions.data();
 
@@ -370,14 +605,132 @@ void VulkanRender::createLogicalDevice()
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount =static_cast<uint32_t>(queueCreateInfos.size());		//Number of Queue Create Infos
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();		//List of queue create infos so device can create required queue family
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());	//Number of enabled logical device extensions
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();		//list of enabled logical device extensions
+	std::vector<const char*> requiredExtensions = getRequiredDeviceExtensions();
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());	//Number of enabled logical device extensions
+	deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();		//list of enabled logical device extensions
 
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;		//Enable  anisotropy
 
+	//Pipeline statistics are only needed for the opt-in stats, and not every device has them
+	if (settings.collectStats)
+	{
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(mainDevice.physicalDevice, &supportedFeatures);
+		pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+		if (!pipelineStatisticsEnabled)
+		{
+			printf("Pipeline statistics queries not supported, only CPU counters will be collected\n");
+		}
+	}
+	deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+
+	//Wireframe materials, drawn filled on devices without it
+	VkPhysicalDeviceFeatures availableFeatures;
+	vkGetPhysicalDeviceFeatures(mainDevice.physicalDevice, &availableFeatures);
+	fillModeNonSolidEnabled = availableFeatures.fillModeNonSolid == VK_TRUE;
+	deviceFeatures.fillModeNonSolid = fillModeNonSolidEnabled ? VK_TRUE : VK_FALSE;
+
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;		//Physical Device features Logical device will use
 
+	//Pipeline libraries are optional, without them every variant is a full pipeline build
+#ifdef VK_EXT_graphics_pipeline_library
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	graphicsPipelineLibraryEnabled = checkPipelineLibrarySupport();
+	if (graphicsPipelineLibraryEnabled)
+	{
+		requiredExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+		requiredExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
+
+		pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+		pipelineLibraryFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &pipelineLibraryFeatures;
+	}
+#endif
+
+	//Shader objects replace pipelines only when asked for, otherwise the extension chain isn't worth enabling
+#ifdef VK_EXT_shader_object
+	VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures = {};
+	shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+	if (settings.backend == RenderBackend::ShaderObjects)
+	{
+		shaderObjectsEnabled = checkShaderObjectSupport();
+		if (!shaderObjectsEnabled)
+		{
+			printf("Shader objects not supported, rendering with pipelines\n");
+		}
+	}
+	if (shaderObjectsEnabled)
+	{
+		requiredExtensions.insert(requiredExtensions.end(), shaderObjectExtensions.begin(), shaderObjectExtensions.end());
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
+
+		shaderObjectFeatures.shaderObject = VK_TRUE;
+		shaderObjectFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &shaderObjectFeatures;
+	}
+#else
+	if (settings.backend == RenderBackend::ShaderObjects)
+	{
+		printf("Shader objects not supported, rendering with pipelines\n");
+	}
+#endif
+
+	//Bindless textures need their own fragment shader, so descriptor indexing is only enabled when asked for
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+	descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (settings.textureBinding == TextureBinding::Bindless)
+	{
+		bindlessEnabled = checkDescriptorIndexingSupport();
+		if (!bindlessEnabled)
+		{
+			printf("Descriptor indexing not supported, binding a descriptor set per texture\n");
+		}
+	}
+	if (bindlessEnabled)
+	{
+		requiredExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		requiredExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
+
+		descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;		//sampler2D textures[]
+		descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;		//Unused slots stay unwritten
+		descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;		//New textures while frames are in flight
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;		//textures[pushTexture.textureIndex]
+		descriptorIndexingFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &descriptorIndexingFeatures;
+	}
+
+	//Update templates write whole descriptor sets in one call, core in 1.1 but an extension on this 1.0 instance
+	descriptorUpdateTemplatesEnabled = isDeviceExtensionAvailable(mainDevice.physicalDevice, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+	if (descriptorUpdateTemplatesEnabled)
+	{
+		requiredExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
+	}
+
+	//Push descriptors have no features to enable, only the extension
+	if (settings.textureBinding == TextureBinding::PushDescriptors)
+	{
+		pushDescriptorsEnabled = checkPushDescriptorSupport();
+		if (!pushDescriptorsEnabled)
+		{
+			printf("Push descriptors not supported, binding a descriptor set per texture\n");
+		}
+	}
+	if (pushDescriptorsEnabled)
+	{
+		requiredExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
+	}
+
 	//create the logical device for the given physical device
 	VkResult result = vkCreateDevice(mainDevice.physicalDevice, &deviceCreateInfo,nullptr,&mainDevice.logicalDevice);
 	if (result!=VK_SUCCESS)
@@ -385,6 +738,16 @@ void VulkanRender::createLogicalDevice()
 		throw std::runtime_error("Failed to Create a Logical Device!");
 	}
 
+	if (pushDescriptorsEnabled)
+	{
+		cmdPushDescriptorSetKHR = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+			vkGetDeviceProcAddr(mainDevice.logicalDevice, "vkCmdPushDescriptorSetKHR"));
+		if (cmdPushDescriptorSetKHR == nullptr)
+		{
+			throw std::runtime_error("Failed to load vkCmdPushDescriptorSetKHR!");
+		}
+	}
+
 	//Queue are Created at the same time as the device
 	// So we want handle to queues
 	//From given logical device, of given Queue Family, of given Queue Index, place reference in given vkqueue
@@ -437,6 +800,12 @@ void VulkanRender::createSwapChain()
 	swapChainCreateInfo.minImageCount = imageCount;
 	swapChainCreateInfo.imageArrayLayers = 1;
 	swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	//Frame capture copies straight out of the swapchain images, if the surface allows it
+	if (swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+	{
+		swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		readbackSupported = true;
+	}
 	swapChainCreateInfo.preTransform = swapChainDetails.surfaceCapabilities.currentTransform;
 	swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	swapChainCreateInfo.clipped = VK_TRUE;
@@ -492,6 +861,43 @@ void VulkanRender::createSwapChain()
 	}
 }
 
+void VulkanRender::createHeadlessTargets()
+{
+	//Plain RGBA8 is renderable on every implementation (including software ones) and easy to consume on the CPU
+	swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	swapChainExtent = { settings.headlessWidth, settings.headlessHeight };
+
+	//One target per frame slot, so a slot's target is free as soon as its fence signals
+	headlessImageMemory.resize(MAX_FRAME_DRAWS);
+	for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+	{
+		SwapChainImage targetImage = {};
+		targetImage.image = createImage(swapChainExtent.width, swapChainExtent.height, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &headlessImageMemory[i]);
+		targetImage.imageView = crateImageView(targetImage.image, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		swapChainImages.push_back(targetImage);
+	}
+	readbackSupported = true;
+}
+
+void VulkanRender::createReadbackBuffers()
+{
+	if (!readbackSupported) return;
+
+	//Host visible buffers the finished frames are copied to, kept mapped for the whole run
+	VkDeviceSize readbackSize = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+	readbackBuffer.resize(MAX_FRAME_DRAWS);
+	readbackBufferMemory.resize(MAX_FRAME_DRAWS);
+	readbackMapped.resize(MAX_FRAME_DRAWS);
+	readbackFrame.assign(MAX_FRAME_DRAWS, -1);
+	for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+	{
+		createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackBuffer[i], &readbackBufferMemory[i]);
+		vkMapMemory(mainDevice.logicalDevice, readbackBufferMemory[i], 0, readbackSize, 0, &readbackMapped[i]);
+	}
+}
+
 void VulkanRender::createRenderPass()
 {
 
@@ -562,6 +968,11 @@ void VulkanRender::createRenderPass()
 	//to give optimal use for certain operations
 	swapChainColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;		//Image data layout before render pass starts
 	swapChainColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;		//Image data layout after render pass(to change to)
+	if (settings.headless)
+	{
+		//Headless targets are copied out instead of presented
+		swapChainColorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
 
 
 	//Attachment reference use an attachment index that refers to index in the attachment list passed to renderPassCreateInfo
@@ -618,6 +1029,17 @@ void VulkanRender::createRenderPass()
 	subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 	subpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
 	subpassDependencies[2].dependencyFlags = 0;
+	if (settings.headless)
+	{
+		subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		subpassDependencies[2].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	}
+	else if (readbackSupported)
+	{
+		//Captured frames are copied before presenting, so the transition must also finish before the transfer stage
+		subpassDependencies[2].dstStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		subpassDependencies[2].dstAccessMask |= VK_ACCESS_TRANSFER_READ_BIT;
+	}
 
 	std::array<VkAttachmentDescription, 3> renderPassAttachments = { swapChainColorAttachment,colorAttachment,depthAttachment };
 
@@ -640,256 +1062,58 @@ void VulkanRender::createRenderPass()
 
 void VulkanRender::createDescriptorSetLayout()
 {
-	// UNIFORM VALUES DESCRIPTOR SET LAYOUT
-	//UboViewProjection Binding Info
-	VkDescriptorSetLayoutBinding vpLayoutBinding = {};
-	vpLayoutBinding.binding = 0;		//Binding point in shader
-	vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;		//Type of descriptor
-	vpLayoutBinding.descriptorCount = 1;		//Number of Descriptors for binding
-	vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;		//Shader stage to bind to
-	vpLayoutBinding.pImmutableSamplers = nullptr;
-
-	//Model Binding Info
-	//VkDescriptorSetLayoutBinding modelLayoutBinding = {};
-	//modelLayoutBinding.binding = 1;
-	//modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-	//modelLayoutBinding.descriptorCount = 1;
-	//modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	//modelLayoutBinding.pImmutableSamplers = nullptr;
-
-	std::vector<VkDescriptorSetLayoutBinding> layoutBindings = { vpLayoutBinding/*,modelLayoutBinding*/ };
-
-	//Creste Descriptor Set Layout with given bingdings
-	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
-	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount =static_cast<uint32_t>(layoutBindings.size());		//Number of binding infos;
-	layoutCreateInfo.pBindings = layoutBindings.data();		//Array of binding infos
-
-	//Create Descriptor Set Layout
-	VkResult result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &layoutCreateInfo,nullptr, &descriptorSetLayout);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create a Descriptor Set Layout!");
-	}
+	//Layouts are reflected from the compiled shaders, so they hold exactly the bindings the shaders read
+	//Bindless draws sample one texture array, with its own fragment shader
+	geometryShaderLayout = shaderReflection.getLayout({ GEOMETRY_VERTEX_SHADER, bindlessEnabled ? GEOMETRY_BINDLESS_FRAGMENT_SHADER : GEOMETRY_FRAGMENT_SHADER });
+	postShaderLayout = shaderReflection.getLayout({ POST_VERTEX_SHADER, POST_FRAGMENT_SHADER });
 
+	// UNIFORM VALUES DESCRIPTOR SET LAYOUT (set 0: UboViewProjection)
+	descriptorSetLayout = geometryShaderLayout.createSetLayout(mainDevice.logicalDevice, 0);
 
-	//CREATE TEXTURE SAMPLER DESCRIPTOR SET LAYOUT
-	//Texture binding info
-	VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-	samplerLayoutBinding.binding = 0;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
+	//CREATE TEXTURE SAMPLER DESCRIPTOR SET LAYOUT (set 1: textureSampler, or textures[] when bindless)
+	//Push descriptors: never allocated, draws write the sampler straight into the command buffer
+	if (bindlessEnabled)
+	{
+		//Partially bound: only registered slots are written, update after bind: textures can be added while frames using the set are in flight
+		geometryShaderLayout.setDescriptorCount(1, 0, bindlessTextureCapacity);
+		std::vector<VkDescriptorBindingFlagsEXT> bindingFlags(geometryShaderLayout.sets[1].size(),
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT);
 
-	// Create a Descriptor Set Layout with given bindings for texture
-	VkDescriptorSetLayoutCreateInfo textureLayoutCreateInfo = {};
-	textureLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	textureLayoutCreateInfo.bindingCount = 1;
-	textureLayoutCreateInfo.pBindings = &samplerLayoutBinding;
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo = {};
+		bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
 
-	//Create Descriptor Set Layout
-	 result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &textureLayoutCreateInfo, nullptr, &samplerSetLayout);
-	if (result != VK_SUCCESS)
+		samplerSetLayout = geometryShaderLayout.createSetLayout(mainDevice.logicalDevice, 1,
+			VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT, &bindingFlagsCreateInfo);
+	}
+	else if (pushDescriptorsEnabled)
 	{
-		throw std::runtime_error("Failed to create a Descriptor Set Layout!");
+		samplerSetLayout = geometryShaderLayout.createSetLayout(mainDevice.logicalDevice, 1, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR);
 	}
-
-	//CREATE INPUT ATTACHEMENT IMAGE DESCRIPTOR SET LAYOUT
-	//Color input Binding
-	VkDescriptorSetLayoutBinding colorInputLayoutBinding = {};
-	colorInputLayoutBinding.binding = 0;
-	colorInputLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	colorInputLayoutBinding.descriptorCount = 1;
-	colorInputLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	// Depth input Binding
-	VkDescriptorSetLayoutBinding depthInputLayoutBinding = {};
-	depthInputLayoutBinding.binding = 1;
-	depthInputLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	depthInputLayoutBinding.descriptorCount = 1;
-	depthInputLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	//Array of input attachment bindings
-	std::vector<VkDescriptorSetLayoutBinding> inputBindings = { colorInputLayoutBinding,depthInputLayoutBinding };
-
-	//Create a descriptor set layout for input attachments
-	VkDescriptorSetLayoutCreateInfo inputLayoutCreateInfo = {};
-	inputLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	inputLayoutCreateInfo.bindingCount = static_cast<uint32_t>(inputBindings.size());
-	inputLayoutCreateInfo.pBindings = inputBindings.data();
-
-	//Create Descriptor Set Layout
-	result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &inputLayoutCreateInfo, nullptr, &inputSetLayout);
-	if (result != VK_SUCCESS)
+	else
 	{
-		throw std::runtime_error("Failed to create a Descriptor Set Layout!");
+		samplerSetLayout = geometryShaderLayout.createSetLayout(mainDevice.logicalDevice, 1);
 	}
 
+	//CREATE INPUT ATTACHEMENT IMAGE DESCRIPTOR SET LAYOUT (second pass set 0: inputColor, inputDepth)
+	inputSetLayout = postShaderLayout.createSetLayout(mainDevice.logicalDevice, 0);
 }
 
 void VulkanRender::createPushConstantRange()
 {
-	//Define push constant values (no 'create' need!)
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;	//Shader stage push constant will go to
-	pushConstantRange.offset = 0;		//Offset into given data to pass to push constant
-	pushConstantRange.size = sizeof(Model);		//Size of data being passed
+	//Reflected from the push_constant blocks (no 'create' need!), recordModelDraws pushes a whole Model into it
+	//followed by the texture index when bindless
+	pushConstantRange = geometryShaderLayout.pushConstantRange;
+	uint32_t pushSize = sizeof(Model) + (bindlessEnabled ? sizeof(uint32_t) : 0);
+	if (pushConstantRange.offset != 0 || pushConstantRange.size != pushSize)
+	{
+		throw std::runtime_error("Failed to match the shader push constant block with Model!");
+	}
 }
 
 void VulkanRender::createGraphicsPipeline()
 {
-	//read in SPIR-V code of shaders
-	auto vertexShaderCode = readFile("Shaders/vert.spv");
-	auto fragmentShaderCode = readFile("Shaders/frag.spv");
-
-	//Create Shader Modules
-	VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
-	VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
-
-	//--SHADER STAGE CREATION INFORMATION --
-	// Vertex Stage creation information
-	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
-	vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;	
-	vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;		//shader stage name
-	vertexShaderCreateInfo.module = vertexShaderModule;		//shader module to be used by stage
-	vertexShaderCreateInfo.pName = "main";		//enter point in to shader
-
-	//Fragement Stage creation information
-	VkPipelineShaderStageCreateInfo fragementShaderCreateInfo = {};
-	fragementShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragementShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;		//shader stage name
-	fragementShaderCreateInfo.module = fragmentShaderModule;		//shader module to be used by stage
-	fragementShaderCreateInfo.pName = "main";		//enter point in to shader
-
-
-	//Put shader stage creation info into array
-	//Graphics Pipline creation info requries array of shader stage creates
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCreateInfo ,fragementShaderCreateInfo };
-
-	//CREATE PIPELINE
-
-	// how the data for a single vertex (including info such as position, color, texture, coords, normals, etc) is as a whole 
-	VkVertexInputBindingDescription bindingDescription = {};
-	bindingDescription.binding = 0;		//Can bind multiple streams of data, this defines which one
-	bindingDescription.stride = sizeof(Vertex);		//Size of single vertex object
-	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		//How to move between data after each vertex
-																															//VK_VERTEX_INPUT_RATE_VERTEX: Move on to the next vertex
-																															//VK_VERTEX_INPUT_RATE_INSTANCE: Move to a vertex for the next instance
-
-	std::array<VkVertexInputAttributeDescription, 3> attritubeDescriptions;
-
-	//Postion Attritube
-	attritubeDescriptions[0].binding = 0;		//Which binding the data is at (should be same as above)
-	attritubeDescriptions[0].location = 0;		//Location in shader where data will be read from
-	attritubeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;		//Format the data will take (also helps defines size of data)
-	attritubeDescriptions[0].offset = offsetof(Vertex, pos);			//Where this attritube is defined in the data for a single vertex
-
-	//Color Attribute
-	attritubeDescriptions[1].binding = 0;	
-	attritubeDescriptions[1].location = 1;
-	attritubeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attritubeDescriptions[1].offset = offsetof(Vertex, color);			
-
-	//Texture Attribute
-	attritubeDescriptions[2].binding = 0;
-	attritubeDescriptions[2].location = 2;
-	attritubeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-	attritubeDescriptions[2].offset = offsetof(Vertex, tex);
-
-	//--Vertex Input 
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
-	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-	vertexInputCreateInfo.pVertexBindingDescriptions =& bindingDescription;		//List of Vertex Binding Descriptions(data spacing/stride info)
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attritubeDescriptions.size());
-	vertexInputCreateInfo.pVertexAttributeDescriptions = attritubeDescriptions.data();		//List of Vertex Attribute Description(data format)
-
-	//--Input Assembly--
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
-	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;		//Primitive type to assemble vertices as
-	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;		//Allow overriding of "strip" topology to start new primitives
-
-	//--ViewPort & Scissor
-	//Create a viewport info struct
-	VkViewport viewPort = {};
-	viewPort.x = 0.0f;
-	viewPort.y = 0.0f;
-	viewPort.width = (float)swapChainExtent.width;
-	viewPort.height = (float)swapChainExtent.height;
-	viewPort.minDepth = 0.0f;
-	viewPort.maxDepth=1.0f;
-
-	//Create a scissor info struct
-	VkRect2D scissor = {};
-	scissor.offset = { 0,0 };		//offset to use region from
-	scissor.extent = swapChainExtent;		//extent to describe region to use, starting at offset
-
-	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
-	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewPort;
-	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
-
-	//--Dynamic States--
-	//Dynamic states to enable
-	//std::vector<VkDynamicState> dynamicStateEnables;
-	//dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);		//Dynamic Viewport: can resize in command buffer with vkCmdSetViewport(commanbuffer,0,1,&viewport)
-	//dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);		//Dynamic Scissor: can resize in command buffer with ckCmdSetScissor(commandbuffer,0,1,&scissor)
-	//
-	////Dynamic State creation info
-	//VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-	//dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	//dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-	//dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
-
-	//--Resterizer
-	VkPipelineRasterizationStateCreateInfo rasterizerCreateinfo = {};
-	rasterizerCreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizerCreateinfo.depthClampEnable = VK_FALSE;		//change if fragements beyond near/far planes are clipped (default) or clamped to plane
-	rasterizerCreateinfo.rasterizerDiscardEnable = VK_FALSE;		//Whether to discard data and skip rasterizer. Never creates fragments, only suitable for pipeline without famebuffer output
-	rasterizerCreateinfo.polygonMode = VK_POLYGON_MODE_FILL;		//How to handle filling points between vertices
-	rasterizerCreateinfo.lineWidth = 1.0f;		//How thick lines should be when drawn
-	rasterizerCreateinfo.cullMode = VK_CULL_MODE_BACK_BIT;		//which face of a tri to cull
-	rasterizerCreateinfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;		//winding to determine which side is front
-	rasterizerCreateinfo.depthBiasEnable = VK_FALSE;		//Whether to add depth bias to fragments
-
-	//--MultiSampling
-	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
-	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;		//enable multisample shading or not
-	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;		//Number of samples to use per fragment
-
-	//--Blending--
-	//Blending decides how to blend a new color being written to a fragment, with old value
-
-	//Blend Attachment State (how blending is handled)
-	VkPipelineColorBlendAttachmentState colorBlendAttachmentState = {};
-	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT		
-		| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;		//colors to apply blending to
-	colorBlendAttachmentState.blendEnable = VK_TRUE;		//enable blending
-
-
-	//Blending uses equation:(srcColorBlendFactor * new color)  color BlendOp (dstColorBlendFactor * old color)
-	colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-	//Sumarized: (new color alpha * new color)+((1- new color alpha)*old color)
-
-	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
-	//Summarized: (1* new color alpha)+(0* old alpha)=new alpha
-
-
-	VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {};
-	colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;		//Alternative to calculation is to use logical operations
-	colorBlendStateCreateInfo.attachmentCount = 1;
-	colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
-	
-
 	//--Pipeline layout --
 	std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = {descriptorSetLayout,samplerSetLayout};
 
@@ -898,8 +1122,9 @@ void VulkanRender::createGraphicsPipeline()
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutCreateInfo.setLayoutCount =static_cast<uint32_t>(descriptorSetLayouts.size());
 	pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	std::vector<VkPushConstantRange> pushConstantRanges = geometryShaderLayout.getPushConstantRanges();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRanges.data();
 
 	//Create Pipeline Layout
 	VkResult result = vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo,nullptr,&pipelineLayout);
@@ -908,79 +1133,14 @@ void VulkanRender::createGraphicsPipeline()
 		throw std::runtime_error("Failed to crate Pipeline Layout!");
 	}
 
-
-	//--Depth Stencil Testing--
-	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
-	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencilCreateInfo.depthTestEnable = VK_TRUE;		//Enable checking depth to determine fragment write
-	depthStencilCreateInfo.depthWriteEnable = VK_TRUE;		//Enable writing to depth buffer (to replace old values)
-	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;		//Comparison operation that alllows an overwrite ( is in front)
-	depthStencilCreateInfo.depthBoundsTestEnable - VK_FALSE;		//Depth Bounds Test: Does the depth value exist between two bounds
-	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;		//Enable Stencil Test
-
-	//--Graphic Pipeline Creation--
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
-	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineCreateInfo.stageCount = 2;		//Number of shader stage
-	pipelineCreateInfo.pStages = shaderStages;		//List of shader stages
-	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;		//All the fixed function pipline states
-	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	pipelineCreateInfo.pDynamicState = nullptr;
-	pipelineCreateInfo.pRasterizationState = &rasterizerCreateinfo;
-	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
-	pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
-	pipelineCreateInfo.pDepthStencilState =&depthStencilCreateInfo;
-	pipelineCreateInfo.layout = pipelineLayout;		//Pipeline layout pipeline should use
-	pipelineCreateInfo.renderPass = renderPass;		//Render pass description the pipline is compatible with
-	pipelineCreateInfo.subpass = 0;		//Subpass of render pass to  use with pipeline
-
-	//Pipeline Derivatives:can create multiple pipeline that derive from one another for optimisation
-	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;		//Exiting pipeline to derive from...
-	pipelineCreateInfo.basePipelineIndex = -1;		//or index of pipeline being created to derive from(in case craeting multiple at once)
-
-	result = vkCreateGraphicsPipelines(mainDevice.logicalDevice,VK_NULL_HANDLE,1,&pipelineCreateInfo,nullptr,&graphicsPipeline);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create Graphics pipelines");
-	}
-
-	//Destory Shader Module, no longer needed after Pipeline created
-	vkDestroyShaderModule(mainDevice.logicalDevice, vertexShaderModule,nullptr);
-	vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShaderModule, nullptr);
-
-	//CREATE SECOND PASS PIPELINE
-	//Second pass shaders
-	auto secondVertexShaderCode = readFile("Shaders/second_vert.spv");
-	auto secondFragmentShaderCode = readFile("Shaders/second_frag.spv");
-
-	//Buid shaders
-	VkShaderModule secondVertexShaderModule = createShaderModule(secondVertexShaderCode);
-	VkShaderModule secondFragmentShaderModule = createShaderModule(secondFragmentShaderCode);
-
-	//Set new shaders
-	vertexShaderCreateInfo.module = secondVertexShaderModule;
-	fragementShaderCreateInfo.module = secondFragmentShaderModule;
-
-	VkPipelineShaderStageCreateInfo secondShaderStages[] = { vertexShaderCreateInfo ,fragementShaderCreateInfo };
-
-	//No vertex data for second pass
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-	vertexInputCreateInfo.pVertexBindingDescriptions = nullptr;
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputCreateInfo.pVertexAttributeDescriptions = nullptr;
-
-
-	//Don't want to write to depth buffer
-	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
-
 	//Create new pipeline layout
 	VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo = {};
 	secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	secondPipelineLayoutCreateInfo.setLayoutCount = 1;
 	secondPipelineLayoutCreateInfo.pSetLayouts = &inputSetLayout;
-	secondPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	secondPipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+	std::vector<VkPushConstantRange> secondPushConstantRanges = postShaderLayout.getPushConstantRanges();
+	secondPipelineLayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(secondPushConstantRanges.size());
+	secondPipelineLayoutCreateInfo.pPushConstantRanges = secondPushConstantRanges.data();
 
 	result = vkCreatePipelineLayout(mainDevice.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, &secondPipelineLayout);
 	if (result != VK_SUCCESS)
@@ -988,20 +1148,48 @@ void VulkanRender::createGraphicsPipeline()
 		throw std::runtime_error("Failed to crate Pipeline Layout!");
 	}
 
-	pipelineCreateInfo.pStages = secondShaderStages;		//Update second shader stage list
-	pipelineCreateInfo.layout = secondPipelineLayout;		//Change pipeline layout for input attachment descriptor sets
-	pipelineCreateInfo.subpass = 1;										//Use second subpass
-
-	//Create second pipeline
-	result = vkCreateGraphicsPipelines(mainDevice.logicalDevice,nullptr,1,&pipelineCreateInfo,nullptr,&secondPipeline);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create Graphics pipelines");
-	}
-
-	//Destroy second shader modules
-	vkDestroyShaderModule(mainDevice.logicalDevice,secondVertexShaderModule,nullptr);
-	vkDestroyShaderModule(mainDevice.logicalDevice, secondFragmentShaderModule, nullptr);
+	//Geometry pass pipeline, also the base of every material variant
+	PipelineDescription& geometryDescription = geometryPipelineDescription;
+	geometryDescription.name = "Geometry";
+	geometryDescription.vertexShaderFile = GEOMETRY_VERTEX_SHADER;
+	geometryDescription.fragmentShaderFile = bindlessEnabled ? GEOMETRY_BINDLESS_FRAGMENT_SHADER : GEOMETRY_FRAGMENT_SHADER;
+	geometryDescription.layout = pipelineLayout;
+	geometryDescription.renderPass = renderPass;
+	geometryDescription.subpass = 0;
+	geometryDescription.extent = swapChainExtent;
+	MaterialFeatures defaultFeatures;
+	geometryDescription.fragmentPermutation.setFeature(GEOMETRY_TEXTURED_CONSTANT, defaultFeatures.textured);
+	geometryDescription.fragmentPermutation.setFeature(GEOMETRY_VERTEX_COLOR_CONSTANT, defaultFeatures.vertexColor);
+
+	//Second pass reads the input attachments, no vertex data and no depth writes
+	PipelineDescription postDescription = geometryDescription;
+	postDescription.name = "Post";
+	postDescription.vertexShaderFile = POST_VERTEX_SHADER;
+	postDescription.fragmentShaderFile = POST_FRAGMENT_SHADER;
+	postDescription.layout = secondPipelineLayout;
+	postDescription.subpass = 1;
+	postDescription.vertexLayout = VertexLayout::None;
+	postDescription.state.depthWrite = false;
+	postDescription.fragmentPermutation = ShaderPermutation();
+	postDescription.fragmentPermutation.setFeature(POST_DEPTH_SPLIT_CONSTANT, settings.depthSplit);
+	postDescription.fragmentPermutation.setInt(POST_SCREEN_WIDTH_CONSTANT, static_cast<int32_t>(swapChainExtent.width));
+	postDescription.fragmentPermutation.setFloat(POST_DEPTH_LOWER_CONSTANT, settings.depthSplitLower);
+	postDescription.fragmentPermutation.setFloat(POST_DEPTH_UPPER_CONSTANT, settings.depthSplitUpper);
+
+	//Shader objects take the same shaders and layouts, state comes from the descriptions when recording
+	if (shaderObjectsEnabled)
+	{
+		shaderObjects.init(mainDevice.logicalDevice);
+		geometryShaderObjects = shaderObjects.createShaders(geometryDescription, { descriptorSetLayout, samplerSetLayout }, pushConstantRanges);
+		postShaderObjects = shaderObjects.createShaders(postDescription, { inputSetLayout }, secondPushConstantRanges);
+		return;
+	}
+
+	//Both compile at the same time, the first frame needs both so init waits for them here
+	graphicsPipelineVariant = pipelineVariants.request(geometryDescription);
+	secondPipelineVariant = pipelineVariants.request(postDescription);
+	pipelineVariants.wait(graphicsPipelineVariant);
+	pipelineVariants.wait(secondPipelineVariant);
 }
 
 void VulkanRender::createColorBufferImage()
@@ -1169,7 +1357,7 @@ void VulkanRender::createTextureSampler()
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;				//Mipmap interpolation mode
 	samplerCreateInfo.mipLodBias = 0.0f;																				//Level of Details bias for mip level
 	samplerCreateInfo.minLod = 0.0f;																						//Minmum level of Detail to pick mip level
-	samplerCreateInfo.maxLod = 0.0f;																						//Maxmum level of Detail to pick mip level
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;																	//Maxmum level of Detail to pick mip level (every level a texture has)
 	samplerCreateInfo.anisotropyEnable = VK_TRUE;															//Enable Anisotropy
 	samplerCreateInfo.maxAnisotropy = 16;																				//Anisotropy sample level
 
@@ -1205,78 +1393,23 @@ void VulkanRender::createUniformBuffers()
 	}
 }
 
-void VulkanRender::createDescriptorPool()
+void VulkanRender::createDescriptorAllocators()
 {
-	//CREATE UNIFORM DESCRIPTOR POOL
-	//Type of descriptor + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
-	//viewProjection pool
-	VkDescriptorPoolSize vpPoolSize = {};
-	vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	vpPoolSize.descriptorCount = static_cast<uint32_t>(vpUniformBuffer.size());
-
-	//model pool(DYMANIC)
-	//VkDescriptorPoolSize modelPoolSize = {};
-	//modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	//modelPoolSize.descriptorCount = static_cast<uint32_t>(modelDUniformBuffer.size());
-
-	//List of pool sizes
-	std::vector<VkDescriptorPoolSize> descriptorPoolSize = { vpPoolSize/*,modelPoolSize*/ };
-
-	//Data to create Descriptor Pool
-	VkDescriptorPoolCreateInfo poolCreateInfo = {};
-	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCreateInfo.maxSets =static_cast<uint32_t>(swapChainImages.size());		//Maximum number of Descriptor Sets that can be created from pool
-	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSize.size());		//Amount of Pool Sizes being passed
-	poolCreateInfo.pPoolSizes = descriptorPoolSize.data();		//Pool Sizes to create pool with
-
-	//Create Descriptor Pool
-	VkResult result = vkCreateDescriptorPool(mainDevice.logicalDevice, &poolCreateInfo,nullptr,&descriptorPool);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create a Descriptor Pool!");
-	}
-
-	//CEATE SAMPLER DESCRIPTOR POOL
-	//Texture sampler pool
-	VkDescriptorPoolSize samplerPoolSize = {};
-	samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerPoolSize.descriptorCount = MAX_OBJECTS;
-
-	VkDescriptorPoolCreateInfo samplerPoolCreateInfo = {};
-	samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
-	samplerPoolCreateInfo.poolSizeCount = 1;
-	samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;
-
-	result = vkCreateDescriptorPool(mainDevice.logicalDevice, &samplerPoolCreateInfo, nullptr,&samplerDescriptorPool);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create a Descriptor Pool!");
-	}
-
-	//CREATE INPUT ATTACHMENT DESCRIPTOR POOL
-	//Color Attachment Pool Size
-	VkDescriptorPoolSize colorInputPoolSize = {};
-	colorInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	colorInputPoolSize.descriptorCount = static_cast<uint32_t>(colorBufferImageView.size());
-
-	//Depth Attachment Pool Size
-	VkDescriptorPoolSize depthInputPoolSize = {};
-	depthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	depthInputPoolSize.descriptorCount = static_cast<uint32_t>(depthBufferImageView.size());
-
-	//Array of input Pool Size
-	std::vector<VkDescriptorPoolSize> inputPoolSize = { colorInputPoolSize ,depthInputPoolSize };
-
-	VkDescriptorPoolCreateInfo inputPoolCreateInfo = {};
-	inputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	inputPoolCreateInfo.maxSets = swapChainImages.size();
-	inputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(inputPoolSize.size());
-	
-	result = vkCreateDescriptorPool(mainDevice.logicalDevice, &inputPoolCreateInfo, nullptr, &inputDescriptorPool);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create a Descriptor Pool!");
+	//Pools are made on demand and sized from the reflected layouts, nothing is pre-sized for a texture count
+	//UNIFORM + INPUT ATTACHMENT SETS, one of each per swapchain image
+	descriptorSetCache.init(mainDevice.logicalDevice, descriptorUpdateTemplatesEnabled);
+	descriptorAllocator.init(mainDevice.logicalDevice, static_cast<uint32_t>(swapChainImages.size()) * 2);
+	descriptorAllocator.registerLayout(descriptorSetLayout, geometryShaderLayout.getPoolSizes(0, 1));
+	descriptorAllocator.registerLayout(inputSetLayout, postShaderLayout.getPoolSizes(0, 1));
+
+	//TEXTURE SETS, first pool holds 64 and every further pool twice as many
+	//Bindless: a single update-after-bind set holding the whole texture array
+	textureDescriptorAllocator.init(mainDevice.logicalDevice, bindlessEnabled ? 1 : 64,
+		bindlessEnabled ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0);
+	//Push descriptor layouts can't be allocated from, so no texture pool is ever made for them
+	if (!pushDescriptorsEnabled)
+	{
+		textureDescriptorAllocator.registerLayout(samplerSetLayout, geometryShaderLayout.getPoolSizes(1, 1));
 	}
 }
 
@@ -1285,65 +1418,22 @@ void VulkanRender::createDescriptorSets()
 	//Resize Descriptor Set list so one for every buffer
 	descriptorSets.resize(swapChainImages.size());
 
-	std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), descriptorSetLayout);
-
-	//Descriptor set Allocation Info
-	VkDescriptorSetAllocateInfo setAllocInfo = {};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = descriptorPool;		//Pool to allocate Descriptor Set from
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());		//Number of sets to allocate
-	setAllocInfo.pSetLayouts = setLayouts.data();		//Layouts to use to allocate sets
-
-	//Allocate descriptor sets(multiple)
-	VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &setAllocInfo, descriptorSets.data());
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to allocate Descriptor Sets!");
-	}
-
-	//Update all of descriptor set buffer bindings
+	//One descriptor set per swap chain image, allocated and written by the cache
 	for (size_t i = 0; i < swapChainImages.size(); i++)
 	{
-
 		//VIEW PROJECTION DESCRIPTOR
-		//Buffer info and data offset info
-		VkDescriptorBufferInfo vpBufferInfo = {};
-		vpBufferInfo.buffer = vpUniformBuffer[i];		//Buffer to get data from
-		vpBufferInfo.offset = 0;		//Position of start of data
-		vpBufferInfo.range = sizeof(UboViewProjection);		//Size of data
-
-		//Data about connection between binding and buffer
-		VkWriteDescriptorSet vpSetWrite = {};
-		vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		vpSetWrite.dstSet = descriptorSets[i];		//Descriptor Set to update
-		vpSetWrite.dstBinding = 0;		//Binding to update (mateches with binding on layout)
-		vpSetWrite.dstArrayElement = 0;		//Index in array to update
-		vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;		//Type of descriptor
-		vpSetWrite.descriptorCount = 1;		//Amount to update
-		vpSetWrite.pBufferInfo =&vpBufferInfo;		//Information about buffer data to bind
-
-		//MODEL DESCRIPTOR
-		//model buffer binding Info
-		/*VkDescriptorBufferInfo modelBufferInfo = {};
-		modelBufferInfo.buffer = modelDUniformBuffer[i];
-		modelBufferInfo.offset = 0;
-		modelBufferInfo.range = modelUniformAligment;
-
-		VkWriteDescriptorSet modelSetWrite = {};
-		modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		modelSetWrite.dstSet = descriptorSets[i];
-		modelSetWrite.dstBinding = 1;
-		modelSetWrite.dstArrayElement = 0;
-		modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-		modelSetWrite.descriptorCount = 1;
-		modelSetWrite.pBufferInfo = &modelBufferInfo;*/
-
-		std::vector<VkWriteDescriptorSet> setWrites = { vpSetWrite /*, modelSetWrite*/ };
-
-		//Update the descriptor sets with new buffer/bingding info
-		vkUpdateDescriptorSets(mainDevice.logicalDevice,static_cast<uint32_t>(setWrites.size()),setWrites.data(),0,nullptr);
+		DescriptorSetContents contents;
+		contents.addBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, vpUniformBuffer[i], 0, sizeof(UboViewProjection));
+
+		descriptorSets[i] = descriptorSetCache.get(descriptorAllocator, descriptorSetLayout, contents);
 	}
 
+	//BINDLESS TEXTURE SET
+	//A single set shared by all frames: slots are only ever added, and frames in flight never read a slot that is being written
+	if (bindlessEnabled)
+	{
+		bindlessDescriptorSet = textureDescriptorAllocator.allocate(samplerSetLayout);
+	}
 }
 
 void VulkanRender::createInputDescriptorSets()
@@ -1351,72 +1441,23 @@ void VulkanRender::createInputDescriptorSets()
 	//Resize array to hold descriptor set for each swap chain image
 	inputDescriptorSets.resize(swapChainImages.size());
 
-	//Fill array of layouts ready for set creation
-	std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), inputSetLayout);
-
-	//Input Attachment Descriptor Set Allocation Info
-	VkDescriptorSetAllocateInfo setAllocInfo = {};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = inputDescriptorPool;
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-	setAllocInfo.pSetLayouts = setLayouts.data();
-
-	//Allocate Descrioptor Sets
-	VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &setAllocInfo, inputDescriptorSets.data());
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to allocate allocate Input Attachment Descriptor Sets!");
-	}
-
-	//Update each descriptor set with input attachment
+	//One per swap chain image, reading that image's attachments
 	for (size_t i = 0; i < swapChainImages.size(); i++)
 	{
-		//Color Attachment Descriptor
-		VkDescriptorImageInfo colorAttachmentDescriptor = {};
-		colorAttachmentDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		colorAttachmentDescriptor.imageView = colorBufferImageView[i];
-		colorAttachmentDescriptor.sampler = VK_NULL_HANDLE;
-
-
-		//color Attachment Descriptor Write
-		VkWriteDescriptorSet colorWrite = {};
-		colorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		colorWrite.dstSet = inputDescriptorSets[i];
-		colorWrite.dstBinding = 0;
-		colorWrite.dstArrayElement = 0;
-		colorWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-		colorWrite.descriptorCount = 1;
-		colorWrite.pImageInfo = &colorAttachmentDescriptor;
-
-		//Depth Attachment Descriptor
-		VkDescriptorImageInfo depthAttachmentDescriptor = {};
-		depthAttachmentDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		depthAttachmentDescriptor.imageView = depthBufferImageView[i];
-		depthAttachmentDescriptor.sampler = VK_NULL_HANDLE;
-
-
-		//Depth Attachment Descriptor Write
-		VkWriteDescriptorSet depthWrite = {};
-		depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		depthWrite.dstSet = inputDescriptorSets[i];
-		depthWrite.dstBinding = 1;
-		depthWrite.dstArrayElement = 0;
-		depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-		depthWrite.descriptorCount = 1;
-		depthWrite.pImageInfo = &depthAttachmentDescriptor;
-
-		//List of input descriptor set writes
-		std::vector<VkWriteDescriptorSet> setWrites = { colorWrite ,depthWrite };
-
-		//Update descriptor sets
-		vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(),0,nullptr);
+		//Color and Depth Attachment Descriptors
+		DescriptorSetContents contents;
+		contents.addImage(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, colorBufferImageView[i], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		contents.addImage(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, depthBufferImageView[i], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
+		inputDescriptorSets[i] = descriptorSetCache.get(descriptorAllocator, inputSetLayout, contents);
 	}
 
 }
 
 void VulkanRender::updateUniformBuffers(uint32_t imageIndex)
 {
+		CPU_PROFILE_FUNCTION();
+
 		//Copy VP Data
 		void* data;
 		vkMapMemory(mainDevice.logicalDevice,vpUniformBufferMemory[imageIndex],0,sizeof(UboViewProjection),0,&data);
@@ -1436,10 +1477,33 @@ void VulkanRender::updateUniformBuffers(uint32_t imageIndex)
 		//vkUnmapMemory(mainDevice.logicalDevice, modelDUniformBufferMemory[imageIndex]);
 }
 
+void VulkanRender::deliverReadbackFrame(uint32_t frameSlot)
+{
+	//Only call once the fence of the frame slot has signalled
+	if (readbackFrame[frameSlot] < 0) return;
+
+	ReadbackFrame frame;
+	frame.frameNumber = static_cast<uint64_t>(readbackFrame[frameSlot]);
+	frame.width = swapChainExtent.width;
+	frame.height = swapChainExtent.height;
+	frame.rowPitch = swapChainExtent.width * 4;
+	frame.format = swapChainImageFormat;
+	frame.pixels = static_cast<const uint8_t*>(readbackMapped[frameSlot]);
+	readbackFrame[frameSlot] = -1;
+
+	if (frameReadbackCallback)
+	{
+		CPU_PROFILE_ZONE("Frame Capture Callback");
+		frameReadbackCallback(frame);
+	}
+}
+
 
 
 void VulkanRender::recordCommands(uint32_t currebtImage)
 {
+	CPU_PROFILE_FUNCTION();
+
 	//Information about how to begin each command buffer
 	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
 	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1469,63 +1533,163 @@ void VulkanRender::recordCommands(uint32_t currebtImage)
 			throw std::runtime_error("Failed to start recording a Command buffer!");
 		} 
 
+		//Timestamps for this frame go into the query range of the current frame slot
+		gpuProfiler.beginFrame(commandbuffers[currebtImage], currentFrame, frameNumber);
+		renderStats.beginFrame(commandbuffers[currebtImage], currentFrame, frameNumber);
+		gpuProfiler.beginScope(commandbuffers[currebtImage], "Render Pass");
+
 		//Begin Render Pass
 		vkCmdBeginRenderPass(commandbuffers[currebtImage],&renderPassBeginInfo,VK_SUBPASS_CONTENTS_INLINE);
+				gpuProfiler.beginScope(commandbuffers[currebtImage], "Geometry Subpass");
 
-				//Bind Pipeline to be used in render pass
-				vkCmdBindPipeline(commandbuffers[currebtImage],VK_PIPELINE_BIND_POINT_GRAPHICS,graphicsPipeline);
-				
-				for (rsize_t j = 0; j < modelList.size(); j++)
+				//Bind Pipeline to be used in render pass, models with their own render state switch to their variant
+				int boundVariant = -1;
+				int boundShaderObjects = -1;
+				const RenderState* boundState = nullptr;
+				auto bindModelPipeline = [&](int modelId)
 				{
-					MeshModel thisModel = modelList[j];
-
-					//"Push" constants to given shader stage directly (no buffer)
-					vkCmdPushConstants(
-						commandbuffers[currebtImage],
-						pipelineLayout,
-						VK_SHADER_STAGE_VERTEX_BIT,		//Stage to push constants to
-						0,																	//Offset of push constants to update
-						sizeof(Model),												//Size of data being pushed
-						thisModel.getModel());								// Actual data being pushed (can be array)
-
-					for (size_t k = 0; k < thisModel.getMeshCount(); k++)
+					if (shaderObjectsEnabled)
 					{
+						const RenderState& state = modelPipelineDescriptions[modelId].state;
+						if (modelShaderObjects[modelId] == boundShaderObjects && *boundState == state) return;
+						boundShaderObjects = modelShaderObjects[modelId];
+						boundState = &state;
+						shaderObjects.bind(commandbuffers[currebtImage], boundShaderObjects, state);
+						renderStats.countPipelineBind();
+						return;
+					}
 
-						VkBuffer vertexBuffers[] = { thisModel.getMesh(k)->getVertexBuffer() };		//Buffers to bind
-						VkDeviceSize offsets = { 0 };													//Offsets into buffers being bound
-						vkCmdBindVertexBuffers(commandbuffers[currebtImage], 0, 1, vertexBuffers, &offsets);		//Command to bind vertex buffer before drawing with them
-
-						//Bind mesh index buffer, with 0 offset and using the uint32 type
-						vkCmdBindIndexBuffer(commandbuffers[currebtImage], thisModel.getMesh(k)->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+					if (modelPipelineVariants[modelId] == boundVariant) return;
+					boundVariant = modelPipelineVariants[modelId];
+					vkCmdBindPipeline(commandbuffers[currebtImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineVariants.getPipeline(boundVariant));
+					renderStats.countPipelineBind();
+				};
+				
+				//Bindless: uniforms and the texture array stay bound for the whole subpass, draws only push their texture index
+				if (bindlessEnabled)
+				{
+					std::array<VkDescriptorSet, 2> descriptorSetGroup = { descriptorSets[currebtImage], bindlessDescriptorSet };
+					vkCmdBindDescriptorSets(commandbuffers[currebtImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+						0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
+					renderStats.countDescriptorSetBinds(static_cast<uint32_t>(descriptorSetGroup.size()));
+				}
+				//Push descriptors: only the uniforms are a set, textures are pushed per mesh
+				else if (pushDescriptorsEnabled)
+				{
+					vkCmdBindDescriptorSets(commandbuffers[currebtImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+						0, 1, &descriptorSets[currebtImage], 0, nullptr);
+					renderStats.countDescriptorSetBinds(1);
+				}
 
-						//Dynamic Offset Amount
-						//uint32_t dynamocOffset = static_cast<uint32_t>(modelUniformAligment) * j;
+				for (rsize_t j = 0; j < modelList.size(); j++)
+				{
+					bindModelPipeline(static_cast<int>(j));
+					renderStats.beginModelQuery(commandbuffers[currebtImage], static_cast<uint32_t>(j));
+					recordModelDraws(currebtImage, &modelList[j], modelList[j].getModel(), -1);
+					renderStats.endQuery(commandbuffers[currebtImage]);
+				}
 
-
-
-						std::array<VkDescriptorSet, 2> descriptorSetGroup = { descriptorSets[currebtImage],
-							samplerDescriptorSets[thisModel.getMesh(k)->getTextId()] };
-
-						//Bind Descriptor Sets
-						vkCmdBindDescriptorSets(commandbuffers[currebtImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-							0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
-
-						//Excute pipline
-						//vkCmdDraw(commandbuffers[i],firstMesh.getVertexCount(),1,0,0);
-						vkCmdDrawIndexed(commandbuffers[currebtImage], thisModel.getMesh(k)->getIndexCount(), 1, 0, 0, 0);
-					}
+				//Instances share the meshes of their model, only the transform (and maybe texture) differs
+				for (size_t j = 0; j < instanceList.size(); j++)
+				{
+					bindModelPipeline(instanceList[j].modelId);
+					recordModelDraws(currebtImage, &modelList[instanceList[j].modelId], &instanceList[j].model, instanceList[j].textureOverride);
 				}
 
+				gpuProfiler.endScope(commandbuffers[currebtImage]);
+
 				//Start second subpass
 				vkCmdNextSubpass(commandbuffers[currebtImage],VK_SUBPASS_CONTENTS_INLINE);
+				gpuProfiler.beginScope(commandbuffers[currebtImage], "Post Subpass");
+				renderStats.beginPostQuery(commandbuffers[currebtImage]);
 
-				vkCmdBindPipeline(commandbuffers[currebtImage],VK_PIPELINE_BIND_POINT_GRAPHICS,secondPipeline);
+				if (shaderObjectsEnabled)
+				{
+					shaderObjects.bind(commandbuffers[currebtImage], postShaderObjects);
+				}
+				else
+				{
+					vkCmdBindPipeline(commandbuffers[currebtImage],VK_PIPELINE_BIND_POINT_GRAPHICS,pipelineVariants.getPipeline(secondPipelineVariant));
+				}
+				renderStats.countPipelineBind();
 				vkCmdBindDescriptorSets(commandbuffers[currebtImage], VK_PIPELINE_BIND_POINT_GRAPHICS,secondPipelineLayout,
 					0,1,&inputDescriptorSets[currebtImage],0,nullptr);
+				renderStats.countDescriptorSetBinds(1);
 				vkCmdDraw(commandbuffers[currebtImage],3,1,0,0);
+				renderStats.countDraw(3, 1);
+				renderStats.endQuery(commandbuffers[currebtImage]);
+				gpuProfiler.endScope(commandbuffers[currebtImage]);
 
 		//End Render Pass
 		vkCmdEndRenderPass(commandbuffers[currebtImage]);
+		gpuProfiler.endScope(commandbuffers[currebtImage]);
+
+		//Frames are only copied out when someone is listening, and only the ones at the capture interval
+		if (readbackSupported && frameReadbackCallback && frameNumber % readbackInterval == 0)
+		{
+			gpuProfiler.beginScope(commandbuffers[currebtImage], "Readback");
+
+			//Swapchain images leave the render pass ready to present, borrow them for the copy
+			VkImageMemoryBarrier presentBarrier = {};
+			presentBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			presentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			presentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			presentBarrier.image = swapChainImages[currebtImage].image;
+			presentBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			presentBarrier.subresourceRange.baseMipLevel = 0;
+			presentBarrier.subresourceRange.levelCount = 1;
+			presentBarrier.subresourceRange.baseArrayLayer = 0;
+			presentBarrier.subresourceRange.layerCount = 1;
+			if (!settings.headless)
+			{
+				presentBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				presentBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				presentBarrier.srcAccessMask = 0;
+				presentBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				vkCmdPipelineBarrier(commandbuffers[currebtImage], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr, 0, nullptr, 1, &presentBarrier);
+			}
+
+			VkBufferImageCopy copyRegion = {};
+			copyRegion.bufferOffset = 0;
+			copyRegion.bufferRowLength = 0;		//Tightly packed
+			copyRegion.bufferImageHeight = 0;
+			copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copyRegion.imageSubresource.mipLevel = 0;
+			copyRegion.imageSubresource.baseArrayLayer = 0;
+			copyRegion.imageSubresource.layerCount = 1;
+			copyRegion.imageOffset = { 0,0,0 };
+			copyRegion.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+			vkCmdCopyImageToBuffer(commandbuffers[currebtImage], swapChainImages[currebtImage].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				readbackBuffer[currentFrame], 1, &copyRegion);
+
+			if (!settings.headless)
+			{
+				presentBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				presentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				presentBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				presentBarrier.dstAccessMask = 0;
+				vkCmdPipelineBarrier(commandbuffers[currebtImage], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+					0, nullptr, 0, nullptr, 1, &presentBarrier);
+			}
+
+			//Make the copy visible to the host once the fence signals
+			VkBufferMemoryBarrier readbackBarrier = {};
+			readbackBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			readbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			readbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			readbackBarrier.buffer = readbackBuffer[currentFrame];
+			readbackBarrier.offset = 0;
+			readbackBarrier.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(commandbuffers[currebtImage], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+				0, nullptr, 1, &readbackBarrier, 0, nullptr);
+
+			readbackFrame[currentFrame] = static_cast<int64_t>(frameNumber);
+			gpuProfiler.endScope(commandbuffers[currebtImage]);
+		}
+		gpuProfiler.endFrame(commandbuffers[currebtImage]);
 	
 		//Stop recording to command buffer
 		result = vkEndCommandBuffer(commandbuffers[currebtImage]);
@@ -1539,6 +1703,72 @@ void VulkanRender::recordCommands(uint32_t currebtImage)
 }
 
 
+void VulkanRender::recordModelDraws(uint32_t currentImage, MeshModel* meshModel, glm::mat4* model, int textureOverride)
+{
+	//"Push" constants to given shader stage directly (no buffer)
+	vkCmdPushConstants(
+		commandbuffers[currentImage],
+		pipelineLayout,
+		pushConstantRange.stageFlags,		//Stages to push constants to (all stages of the range)
+		0,																	//Offset of push constants to update
+		sizeof(Model),												//Size of data being pushed
+		model);																// Actual data being pushed (can be array)
+	renderStats.countPushConstants(sizeof(Model));
+
+	for (size_t k = 0; k < meshModel->getMeshCount(); k++)
+	{
+		VkBuffer vertexBuffers[] = { meshModel->getMesh(k)->getVertexBuffer() };		//Buffers to bind
+		VkDeviceSize offsets = { 0 };													//Offsets into buffers being bound
+		vkCmdBindVertexBuffers(commandbuffers[currentImage], 0, 1, vertexBuffers, &offsets);		//Command to bind vertex buffer before drawing with them
+		renderStats.countVertexBufferBinds(1);
+
+		//Bind mesh index buffer, with 0 offset and using the uint32 type
+		vkCmdBindIndexBuffer(commandbuffers[currentImage], meshModel->getMesh(k)->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		renderStats.countIndexBufferBind();
+
+		//Dynamic Offset Amount
+		//uint32_t dynamocOffset = static_cast<uint32_t>(modelUniformAligment) * j;
+
+		int texId = textureOverride >= 0 ? textureOverride : meshModel->getMesh(k)->getTextId();
+		if (bindlessEnabled)
+		{
+			//Texture index goes right after the model matrix
+			uint32_t textureIndex = static_cast<uint32_t>(texId);
+			vkCmdPushConstants(commandbuffers[currentImage], pipelineLayout, pushConstantRange.stageFlags,
+				sizeof(Model), sizeof(textureIndex), &textureIndex);
+			renderStats.countPushConstants(sizeof(textureIndex));
+		}
+		else if (pushDescriptorsEnabled)
+		{
+			//Set 1 is written into the command buffer, dstSet is ignored
+			VkWriteDescriptorSet textureWrite = {};
+			textureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			textureWrite.dstBinding = 0;
+			textureWrite.dstArrayElement = 0;
+			textureWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			textureWrite.descriptorCount = 1;
+			textureWrite.pImageInfo = &pushTextureDescriptors[texId];
+			cmdPushDescriptorSetKHR(commandbuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &textureWrite);
+			renderStats.countDescriptorPush();
+		}
+		else
+		{
+			std::array<VkDescriptorSet, 2> descriptorSetGroup = { descriptorSets[currentImage],
+				samplerDescriptorSets[texId] };
+
+			//Bind Descriptor Sets
+			vkCmdBindDescriptorSets(commandbuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+				0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
+			renderStats.countDescriptorSetBinds(static_cast<uint32_t>(descriptorSetGroup.size()));
+		}
+
+		//Excute pipline
+		//vkCmdDraw(commandbuffers[i],firstMesh.getVertexCount(),1,0,0);
+		vkCmdDrawIndexed(commandbuffers[currentImage], meshModel->getMesh(k)->getIndexCount(), 1, 0, 0, 0);
+		renderStats.countDraw(meshModel->getMesh(k)->getIndexCount(), 1);
+	}
+}
+
 void VulkanRender::getPhysicalDevice()
 {
 	//Enumerate Physical devices the vkInstance can access
@@ -1556,6 +1786,7 @@ void VulkanRender::getPhysicalDevice()
 	std::vector<VkPhysicalDevice> deviceList(deviceCount);
 	vkEnumeratePhysicalDevices(instance, &deviceCount, deviceList.data());
 
+	mainDevice.physicalDevice = VK_NULL_HANDLE;
 	for (const auto &device: deviceList)
 	{
 		bool rightDeviceSuitable = false;
@@ -1566,6 +1797,10 @@ void VulkanRender::getPhysicalDevice()
 			break;
 		}
 	}
+	if (mainDevice.physicalDevice == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Cannot find a GPU with the required features!");
+	}
 	
 	//Get properties of our new device
 	VkPhysicalDeviceProperties physicalDeviceProperties;
@@ -1616,6 +1851,226 @@ bool VulkanRender::checkInstanceExtensionSupport(std::vector<const char*>* check
 	return true;
 }
 
+bool VulkanRender::isInstanceExtensionAvailable(const char* extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+	for (const auto& extension : extensions)
+	{
+		if (strcmp(extensionName, extension.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VulkanRender::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+	for (const auto& extension : extensions)
+	{
+		if (strcmp(extensionName, extension.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VulkanRender::checkPipelineLibrarySupport()
+{
+#ifdef VK_EXT_graphics_pipeline_library
+	if (!physicalDeviceProperties2Enabled ||
+		!isDeviceExtensionAvailable(mainDevice.physicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) ||
+		!isDeviceExtensionAvailable(mainDevice.physicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures = {};
+	libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &libraryFeatures;
+
+	VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties = {};
+	libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &libraryProperties;
+	if (!getPhysicalDeviceFeatures2(&features) || !getPhysicalDeviceProperties2(&properties))
+	{
+		return false;
+	}
+
+	//A slow unoptimised link would only add a second compile per variant, full builds are better then
+	if (libraryFeatures.graphicsPipelineLibrary != VK_TRUE || libraryProperties.graphicsPipelineLibraryFastLinking != VK_TRUE)
+	{
+		return false;
+	}
+
+	printf("Graphics pipeline libraries enabled, variants are fast linked and optimised in the background\n");
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool VulkanRender::checkShaderObjectSupport()
+{
+#ifdef VK_EXT_shader_object
+	//Shader objects need dynamic rendering, which on a 1.0 device brings its whole extension chain along
+	for (const char* extensionName : shaderObjectExtensions)
+	{
+		if (!isDeviceExtensionAvailable(mainDevice.physicalDevice, extensionName))
+		{
+			return false;
+		}
+	}
+
+	VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures = {};
+	shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &shaderObjectFeatures;
+	return getPhysicalDeviceFeatures2(&features) && shaderObjectFeatures.shaderObject == VK_TRUE;
+#else
+	return false;
+#endif
+}
+
+bool VulkanRender::checkDescriptorIndexingSupport()
+{
+	//Descriptor indexing is core in 1.2, on a 1.0 device it is an extension that needs maintenance3
+	if (!isDeviceExtensionAvailable(mainDevice.physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME) ||
+		!isDeviceExtensionAvailable(mainDevice.physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &indexingFeatures;
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	if (!getPhysicalDeviceFeatures2(&features) || !getPhysicalDeviceProperties2(&properties))
+	{
+		return false;
+	}
+
+	if (features.features.shaderSampledImageArrayDynamicIndexing != VK_TRUE || indexingFeatures.runtimeDescriptorArray != VK_TRUE ||
+		indexingFeatures.descriptorBindingPartiallyBound != VK_TRUE || indexingFeatures.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE)
+	{
+		return false;
+	}
+
+	//Combined image samplers count against both the sampler and the sampled image limits
+	bindlessTextureCapacity = std::min({ settings.maxBindlessTextures,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+	if (bindlessTextureCapacity == 0)
+	{
+		return false;
+	}
+
+	printf("Bindless textures enabled, up to %u textures\n", bindlessTextureCapacity);
+	return true;
+}
+
+bool VulkanRender::checkPushDescriptorSupport()
+{
+	if (!isDeviceExtensionAvailable(mainDevice.physicalDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	//The extension needs the properties2 query, and one pushed texture per draw fits any device limit
+	VkPhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProperties = {};
+	pushDescriptorProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &pushDescriptorProperties;
+	if (!getPhysicalDeviceProperties2(&properties) || pushDescriptorProperties.maxPushDescriptors == 0)
+	{
+		return false;
+	}
+
+	printf("Push descriptors enabled, up to %u per set\n", pushDescriptorProperties.maxPushDescriptors);
+	return true;
+}
+
+bool VulkanRender::checkTextureFormatSupport(VkFormat format)
+{
+	//Block formats are optional per family (BC on desktop, ETC2 / ASTC on mobile), the sampler filters linearly
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(mainDevice.physicalDevice, format, &formatProperties);
+
+	VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+bool VulkanRender::getPhysicalDeviceFeatures2(VkPhysicalDeviceFeatures2* features)
+{
+	if (!physicalDeviceProperties2Enabled)
+	{
+		return false;
+	}
+
+	//Instance is 1.0, so the KHR entry point is loaded by hand
+	PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if (getFeatures2 == nullptr)
+	{
+		return false;
+	}
+
+	getFeatures2(mainDevice.physicalDevice, features);
+	return true;
+}
+
+bool VulkanRender::getPhysicalDeviceProperties2(VkPhysicalDeviceProperties2* properties)
+{
+	if (!physicalDeviceProperties2Enabled)
+	{
+		return false;
+	}
+
+	//Instance is 1.0, so the KHR entry point is loaded by hand
+	PFN_vkGetPhysicalDeviceProperties2 getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+	if (getProperties2 == nullptr)
+	{
+		return false;
+	}
+
+	getProperties2(mainDevice.physicalDevice, properties);
+	return true;
+}
+
+std::vector<const char*> VulkanRender::getRequiredDeviceExtensions()
+{
+	//Without a surface there is nothing to present to, so the swapchain extension is not needed
+	if (settings.headless)
+	{
+		return std::vector<const char*>();
+	}
+	return deviceExtensions;
+}
+
 bool VulkanRender::checkDeviceExtensionSupport(VkPhysicalDevice device)
 {
 	//Get device extension count
@@ -1633,7 +2088,7 @@ bool VulkanRender::checkDeviceExtensionSupport(VkPhysicalDevice device)
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
 
 	//Check for extension
-	for (const auto deviceExtension: deviceExtensions)
+	for (const auto deviceExtension: getRequiredDeviceExtensions())
 	{
 		bool hasExtension = false;
 		for (const auto &extension:extensions)
@@ -1669,7 +2124,12 @@ bool VulkanRender::checkDeviceSuitable(VkPhysicalDevice device)
 	bool extensionsSupported = checkDeviceExtensionSupport(device);
 
 	bool swapChainVaild = false;
-	if (extensionsSupported)
+	if (settings.headless)
+	{
+		//No surface to check against, any device that can draw will do (software ICDs included)
+		swapChainVaild = true;
+	}
+	else if (extensionsSupported)
 	{
 		SwapChainDetails swapChainDetails = getSwapChainDetails(device);
 		swapChainVaild = !swapChainDetails.presentationModes.empty() > 0 && !swapChainDetails.formats.empty();
@@ -1740,9 +2200,16 @@ QueueFamilyIndices VulkanRender::getQueueFamilies(VkPhysicalDevice device)
 			indices.graphicsFamily = i;
 		}
 
-		//Check if Queue Family supports presentation
+		//Check if Queue Family supports presentation (headless "presents" from the graphics queue)
 		VkBool32 presentionSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device,i,surface, &presentionSupport);
+		if (settings.headless)
+		{
+			presentionSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ? VK_TRUE : VK_FALSE;
+		}
+		else
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentionSupport);
+		}
 		//Check if queue is presentation type (can be both graphics and presentation)
 		if (queueFamily.queueCount > 0 && presentionSupport)
 		{
@@ -1880,7 +2347,7 @@ VkFormat VulkanRender::chooseSupportedFormat(const std::vector<VkFormat>& format
 	throw std::runtime_error("Failed to find a matching format!");
 }
 
-VkImage VulkanRender::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlages, VkMemoryPropertyFlags propFlages, VkDeviceMemory* imageMemory)
+VkImage VulkanRender::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlages, VkMemoryPropertyFlags propFlages, VkDeviceMemory* imageMemory, uint32_t mipLevels)
 {
 	//CEATE IMAGE
 	// Image Creation Info
@@ -1890,7 +2357,7 @@ VkImage VulkanRender::createImage(uint32_t width, uint32_t height, VkFormat form
 	imageCreateInfo.extent.width = width;																//Width of image extent
 	imageCreateInfo.extent.height = height;																//Height of image extent
 	imageCreateInfo.extent.depth = 1;																		//Depth of image (just 1, no 3D aspect)
-	imageCreateInfo.mipLevels = 1;																			//Number of mipmap levels
+	imageCreateInfo.mipLevels = mipLevels;																			//Number of mipmap levels
 	imageCreateInfo.arrayLayers = 1;																		//Number of levels in image array
 	imageCreateInfo.format = format;																		//Format type of image
 	imageCreateInfo.tiling = tiling;																				//How image data should be "tiled"(arranged for optimal reading)
@@ -1918,7 +2385,7 @@ VkImage VulkanRender::createImage(uint32_t width, uint32_t height, VkFormat form
 	memoryAllocInfo.allocationSize = memoryRequirments.size;
 	memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(mainDevice.physicalDevice,memoryRequirments.memoryTypeBits, propFlages);
 
-	result = vkAllocateMemory(mainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageMemory);
+	result = MemoryStats::allocate(mainDevice.logicalDevice, &memoryAllocInfo, imageMemory);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to allocate memory for image!");
@@ -1930,7 +2397,7 @@ VkImage VulkanRender::createImage(uint32_t width, uint32_t height, VkFormat form
 	return image;
 }
 
-VkImageView VulkanRender::crateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+VkImageView VulkanRender::crateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
 {
 	VkImageViewCreateInfo viewImgeCreateInfo = {};
 	viewImgeCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1945,7 +2412,7 @@ VkImageView VulkanRender::crateImageView(VkImage image, VkFormat format, VkImage
 	//Subresources allow the view to view only a part of an image
 	viewImgeCreateInfo.subresourceRange.aspectMask = aspectFlags;		//which aspect of image to view
 	viewImgeCreateInfo.subresourceRange.baseMipLevel = 0;		//Start mipmap levels to view from
-	viewImgeCreateInfo.subresourceRange.levelCount = 1;		//number of array levels to view
+	viewImgeCreateInfo.subresourceRange.levelCount = mipLevels;		//number of mipmap levels to view
 	viewImgeCreateInfo.subresourceRange.baseArrayLayer = 0;		//Start array to view from
 	viewImgeCreateInfo.subresourceRange.layerCount = 1;		//number of array levels to view
 
@@ -1960,129 +2427,324 @@ VkImageView VulkanRender::crateImageView(VkImage image, VkFormat format, VkImage
 	return imageView;
 }
 
-VkShaderModule VulkanRender::createShaderModule(const std::vector<char>& code)
+TextureUpload VulkanRender::decodeTexture(std::string fileName)
 {
-	//Shader Module creation information
-	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
-	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderModuleCreateInfo.codeSize = code.size();
-	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+	CPU_PROFILE_FUNCTION();
 
-	VkShaderModule shaderModule;
-	VkResult result = vkCreateShaderModule(mainDevice.logicalDevice, &shaderModuleCreateInfo, nullptr, &shaderModule);
-	if (result != VK_SUCCESS)
+	TextureUpload upload;
+
+	//Pre-compressed files are copied as stored, no decode and 4-8x less memory
+	TextureFile compressedTexture;
+	stbi_uc* imageData = nullptr;
+	VkDeviceSize imageSize = 0;
+	if (loadCompressedTextureFile(fileName, &compressedTexture))
 	{
-		throw std::runtime_error("Failed to craate a shader module!");
+		upload.format = compressedTexture.format;
+		upload.width = compressedTexture.width;
+		upload.height = compressedTexture.height;
+		upload.storedLevels = static_cast<uint32_t>(compressedTexture.levels.size());
+		for (const TextureLevel& level : compressedTexture.levels)
+		{
+			imageSize += level.size;
+		}
+	}
+	else
+	{
+		//Load image file
+		int width, height;
+		imageData = loadTextureFile(fileName, &width, &height, &imageSize);
+		upload.format = VK_FORMAT_R8G8B8A8_UNORM;
+		upload.width = static_cast<uint32_t>(width);
+		upload.height = static_cast<uint32_t>(height);
+		upload.storedLevels = 1;
 	}
-
-	return shaderModule;
-}
-
-int VulkanRender::createTextureImage(std::string fileName)
-{
-	//Load image file
-	int width, height;
-	VkDeviceSize imageSize;
-	stbi_uc* imageData = loadTextureFile(fileName, &width,&height,&imageSize);
 
 	//Create staging buffer to hold loaded data, ready to copy to device
-	VkBuffer imageStagingBuffer;
-	VkDeviceMemory imageStagingBufferMemory;
-	createBuffer(mainDevice.physicalDevice,mainDevice.logicalDevice,imageSize,VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageStagingBuffer,&imageStagingBufferMemory);
+	try
+	{
+		createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&upload.stagingBuffer, &upload.stagingBufferMemory);
+	}
+	catch (...)
+	{
+		stbi_image_free(imageData);
+		throw;
+	}
+
+	//Where each level lands in the image
+	auto addCopyRegion = [&upload](VkDeviceSize bufferOffset, uint32_t mipLevel, uint32_t width, uint32_t height)
+	{
+		VkBufferImageCopy copyRegion = {};
+		copyRegion.bufferOffset = bufferOffset;
+		copyRegion.bufferRowLength = 0;		//Tightly packed
+		copyRegion.bufferImageHeight = 0;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = mipLevel;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = { 0, 0, 0 };
+		copyRegion.imageExtent = { width, height, 1 };
+		upload.copyRegions.push_back(copyRegion);
+	};
 
 	//Copy image data to staging buffer
 	void* data;
-	vkMapMemory(mainDevice.logicalDevice,imageStagingBufferMemory,0,imageSize,0,&data);
-	memcpy(data,imageData,static_cast<size_t>(imageSize));
-	vkUnmapMemory(mainDevice.logicalDevice,imageStagingBufferMemory);
+	vkMapMemory(mainDevice.logicalDevice, upload.stagingBufferMemory, 0, imageSize, 0, &data);
+	if (imageData)
+	{
+		memcpy(data, imageData, static_cast<size_t>(imageSize));
+		addCopyRegion(0, 0, upload.width, upload.height);
 
-	//Free original image data
-	stbi_image_free(imageData);
+		//Free original image data
+		stbi_image_free(imageData);
+	}
+	else
+	{
+		//Every stored level back to back, sizes are whole blocks so every offset stays block aligned
+		VkDeviceSize stagingOffset = 0;
+		for (size_t i = 0; i < compressedTexture.levels.size(); i++)
+		{
+			const TextureLevel& level = compressedTexture.levels[i];
+			memcpy(static_cast<char*>(data) + stagingOffset, compressedTexture.data.data() + level.offset, level.size);
+			addCopyRegion(stagingOffset, static_cast<uint32_t>(i), level.width, level.height);
+			stagingOffset += level.size;
+		}
+	}
+	vkUnmapMemory(mainDevice.logicalDevice, upload.stagingBufferMemory);
+
+	return upload;
+}
+
+void VulkanRender::destroyTextureUpload(const TextureUpload& upload)
+{
+	vkDestroyBuffer(mainDevice.logicalDevice, upload.stagingBuffer, nullptr);
+	MemoryStats::free(mainDevice.logicalDevice, upload.stagingBufferMemory);
+}
+
+int VulkanRender::createTextureImage(const TextureUpload& upload)
+{
+	//Stored mip chain is used as is, a single level gets one generated when the format allows it
+	bool generateMips = upload.storedLevels == 1;
+	uint32_t mipLevels = generateMips ? mipmapGenerator.getMipLevels(upload.format, upload.width, upload.height) : upload.storedLevels;
 
 	//Create image to hold final texture
-	VkImage texImage;
 	VkDeviceMemory texImageMemory;
-	texImage = createImage(width,height,VK_FORMAT_R8G8B8A8_UNORM,VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,& texImageMemory);
-
+	VkImage texImage = createImage(upload.width, upload.height, upload.format, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (generateMips ? mipmapGenerator.getImageUsage(upload.format) : 0),
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory, mipLevels);
 
 	//COPY DATA TO IMAGE
-	// Transition image to be DST for copy operation
-	transitionImageLayout(mainDevice.logicalDevice,graphicsQueue,graphicsCommandPool,
-		texImage,VK_IMAGE_LAYOUT_UNDEFINED,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	//copy Imagedata
-	copyImageBuffer(mainDevice.logicalDevice,graphicsQueue,graphicsCommandPool,imageStagingBuffer, texImage,width,height);
+	//Transitions, copy and mip generation are one submit
+	VkCommandBuffer uploadCommandBuffer = beginCommandBuffer(mainDevice.logicalDevice, graphicsCommandPool);
+
+	// Transition every level to be DST for copy operation
+	recordImageLayoutTransition(uploadCommandBuffer, texImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+	//copy every stored level
+	vkCmdCopyBufferToImage(uploadCommandBuffer, upload.stagingBuffer, texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(upload.copyRegions.size()), upload.copyRegions.data());
 
-	//Transition image to be shader readable for shader usage
-	transitionImageLayout(mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
-		texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	if (generateMips)
+	{
+		//Downsample the other levels, leaves the whole chain shader readable
+		mipmapGenerator.record(uploadCommandBuffer, texImage, upload.format, upload.width, upload.height, mipLevels);
+	}
+	else
+	{
+		recordImageLayoutTransition(uploadCommandBuffer, texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+	}
+
+	endAndSubmitCommandBuffer(mainDevice.logicalDevice, graphicsCommandPool, graphicsQueue, uploadCommandBuffer);
+	mipmapGenerator.releaseUploadResources();
 
 	//Add texture data to vector for reference
 	textureImages.push_back(texImage);
 	textureImageMemory.push_back(texImageMemory);
+	textureImageFormats.push_back(upload.format);
 
 	//Destory staging buffers
-	vkDestroyBuffer(mainDevice.logicalDevice,imageStagingBuffer,nullptr);
-	vkFreeMemory(mainDevice.logicalDevice,imageStagingBufferMemory,nullptr);
+	destroyTextureUpload(upload);
 
 	//return the index of new texture image
 	return textureImages.size() - 1;
 }
 
+int VulkanRender::acquireCachedTexture(const std::string& fileName, std::string* texturePath, uint64_t* contentHash)
+{
+	//Already loaded from this file (or one with the same contents): share its image and descriptor
+	*texturePath = TextureCache::getCanonicalPath("Textures/" + fileName);
+	*contentHash = 0;
+	int cachedTexture = textureCache.acquire(*texturePath, *contentHash);
+	if (cachedTexture < 0)
+	{
+		//Only read the file for its hash when the name alone didn't match
+		*contentHash = textureCache.getContentHash(*texturePath);
+		cachedTexture = textureCache.acquire(*texturePath, *contentHash);
+	}
+	return cachedTexture;
+}
+
 int VulkanRender::createTexture(std::string fileName)
 {
+	CPU_PROFILE_FUNCTION();
+
+	std::string texturePath;
+	uint64_t contentHash;
+	int cachedTexture = acquireCachedTexture(fileName, &texturePath, &contentHash);
+	if (cachedTexture >= 0)
+	{
+		return cachedTexture;
+	}
+
+	TextureUpload upload = decodeTexture(fileName);
+	upload.contentHash = contentHash;
+	return createTexture(upload, texturePath);
+}
+
+int VulkanRender::createTexture(const TextureUpload& upload, const std::string& texturePath)
+{
+	//Hashed while decoding: another name for a loaded image is only found now, the decode is thrown away
+	int cachedTexture = textureCache.acquire(texturePath, upload.contentHash);
+	if (cachedTexture >= 0)
+	{
+		destroyTextureUpload(upload);
+		return cachedTexture;
+	}
+
 	//Create Texture Image and get its location in array
-	int textureImageLoc = createTextureImage(fileName);
+	int textureImageLoc = createTextureImage(upload);
 
 	//Create Image view and add to list
-	VkImageView imageView = crateImageView(textureImages[textureImageLoc],VK_FORMAT_R8G8B8A8_UNORM,VK_IMAGE_ASPECT_COLOR_BIT);
+	VkImageView imageView = crateImageView(textureImages[textureImageLoc],textureImageFormats[textureImageLoc],VK_IMAGE_ASPECT_COLOR_BIT,VK_REMAINING_MIP_LEVELS);
 	textureImageViews.push_back(imageView);
 
 	//Create Descriptor
 	int decriptorLoc = createTextureDescriptor(imageView);
 
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(mainDevice.logicalDevice, textureImages[textureImageLoc], &memoryRequirements);
+
+	CachedTexture cachedEntry;
+	cachedEntry.path = texturePath;
+	cachedEntry.contentHash = upload.contentHash;
+	cachedEntry.image = textureImageLoc;
+	cachedEntry.bytes = memoryRequirements.size;
+	textureCache.add(decriptorLoc, cachedEntry);
+
 	//Return location of set with texture
 	return decriptorLoc;
 }
 
-int VulkanRender::createTextureDescriptor(VkImageView textureImage)
+void VulkanRender::releaseTexture(int textureId)
 {
-	VkDescriptorSet descriptorSet;
+	//Meshes keep drawing with their texture id, so its last reference can't go while a loaded model still uses it
+	if (textureCache.getReferences(textureId) == 1)
+	{
+		for (MeshModel& meshModel : modelList)
+		{
+			for (size_t i = 0; i < meshModel.getMeshCount(); i++)
+			{
+				if (meshModel.getMesh(i)->getTextId() == textureId)
+				{
+					throw std::runtime_error("Failed to release a texture, a loaded model still uses it!");
+				}
+			}
+		}
+	}
 
-	//Descriptor Set Allocation Info
-	VkDescriptorSetAllocateInfo setAllocInfo = {};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = samplerDescriptorPool;
-	setAllocInfo.descriptorSetCount = 1;
-	setAllocInfo.pSetLayouts = &samplerSetLayout;
+	CachedTexture texture;
+	if (!textureCache.release(textureId, &texture))
+	{
+		return;
+	}
 
-	//Allocate Descriptor Sets
-	VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice,&setAllocInfo, &descriptorSet);
-	if (result != VK_SUCCESS)
+	//Last reference gone, but frames in flight may still sample it
+	vkDeviceWaitIdle(mainDevice.logicalDevice);
+
+	//Instances overriding with it fall back to the default texture 0, or to their own textures once 0 is gone too
+	int fallbackTexture = textureCache.isLoaded(0) ? 0 : -1;
+	for (ModelInstance& instance : instanceList)
+	{
+		if (instance.textureOverride == textureId)
+		{
+			instance.textureOverride = fallbackTexture;
+		}
+	}
+
+	VkImageView imageView = textureImageViews[texture.image];
+	if (pushDescriptorsEnabled)
+	{
+		pushTextureDescriptors[textureId] = {};
+	}
+	else if (!bindlessEnabled)
 	{
-		throw std::runtime_error("Failed to allocate Texture Descriptor Sets!");
+		//The set goes back to the cache for the next texture, its location stays empty
+		descriptorSetCache.evict(imageView);
+		samplerDescriptorSets[textureId] = VK_NULL_HANDLE;
 	}
+	//Bindless slots are left as they are, the array is partially bound and nothing indexes them anymore
 
+	vkDestroyImageView(mainDevice.logicalDevice, imageView, nullptr);
+	vkDestroyImage(mainDevice.logicalDevice, textureImages[texture.image], nullptr);
+	MemoryStats::free(mainDevice.logicalDevice, textureImageMemory[texture.image]);
+	textureImageViews[texture.image] = VK_NULL_HANDLE;
+	textureImages[texture.image] = VK_NULL_HANDLE;
+	textureImageMemory[texture.image] = VK_NULL_HANDLE;
+}
+
+int VulkanRender::createTextureDescriptor(VkImageView textureImage)
+{
 	//Texture Image Info
 	VkDescriptorImageInfo imageInfo = {};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;		//Image layout when in use
 	imageInfo.imageView = textureImage;		//Image to bind to set
 	imageInfo.sampler = textureSampler;			//Sampler to use for set
 
-	//Descriptor Write Info
-	VkWriteDescriptorSet descriptorWrite = {};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite.dstSet = descriptorSet;
-	descriptorWrite.dstBinding = 0;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.pImageInfo = &imageInfo;
+	//Bindless: the next free slot of the texture array, its index is what draws push
+	if (bindlessEnabled)
+	{
+		if (bindlessTextureCount >= bindlessTextureCapacity)
+		{
+			throw std::runtime_error("Failed to add a texture, the bindless texture array is full!");
+		}
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = bindlessDescriptorSet;
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = bindlessTextureCount;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+		vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
+
+		return bindlessTextureCount++;
+	}
+
+	//Push descriptors: nothing to allocate or write yet, keep what draws will push
+	if (pushDescriptorsEnabled)
+	{
+		auto existing = std::find_if(pushTextureDescriptors.begin(), pushTextureDescriptors.end(),
+			[&imageInfo](const VkDescriptorImageInfo& info) { return info.imageView == imageInfo.imageView && info.sampler == imageInfo.sampler; });
+		if (existing != pushTextureDescriptors.end())
+		{
+			return static_cast<int>(existing - pushTextureDescriptors.begin());
+		}
+
+		pushTextureDescriptors.push_back(imageInfo);
+		return static_cast<int>(pushTextureDescriptors.size() - 1);
+	}
 
-	//Update new descriptor set
-	vkUpdateDescriptorSets(mainDevice.logicalDevice,1,&descriptorWrite,0,nullptr);
+	//Same image + sampler as an earlier texture: reuse its set and location instead of writing another
+	DescriptorSetContents contents;
+	contents.addImage(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageInfo.imageView, imageInfo.sampler, imageInfo.imageLayout);
+	VkDescriptorSet descriptorSet = descriptorSetCache.get(textureDescriptorAllocator, samplerSetLayout, contents);
+
+	auto existing = std::find(samplerDescriptorSets.begin(), samplerDescriptorSets.end(), descriptorSet);
+	if (existing != samplerDescriptorSets.end())
+	{
+		return static_cast<int>(existing - samplerDescriptorSets.begin());
+	}
 
 	//Add descriptor set to list
 	samplerDescriptorSets.push_back(descriptorSet);
@@ -2092,9 +2754,15 @@ int VulkanRender::createTextureDescriptor(VkImageView textureImage)
 
 int VulkanRender::createMeshModel(std::string modelFile)
 {
+	CPU_PROFILE_FUNCTION();
+
 	//Import model "scene"
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(modelFile,aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
+	const aiScene* scene;
+	{
+		CPU_PROFILE_ZONE("Assimp ReadFile");
+		scene = importer.ReadFile(modelFile, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
+	}
 	if (!scene)
 	{
 		throw std::runtime_error("Failed to load model! ("+ modelFile +")");
@@ -2104,29 +2772,129 @@ int VulkanRender::createMeshModel(std::string modelFile)
 	std::vector<std::string> textureNames = MeshModel::LoadMaterials(scene);
 
 	//Conversion from the materials lists IDs to our Descriptor Array IDs
-	std::vector<int> matToTex(textureNames.size());
+	//If maertai had no texture , set '0' to indicate no texture, texture 0 will be reserved for a default texture
+	std::vector<int> matToTex(textureNames.size(), 0);
+
+	//Texture not loaded yet, hashing and decoding on the pool, with every material that uses it
+	struct PendingTexture
+	{
+		std::string path;
+		std::future<TextureUpload> upload;
+		std::vector<size_t> materials;
+	};
+	std::vector<PendingTexture> pendingTextures;
 
-	//Loop over textureNmaes and create texture for them
+	//Every reference taken by this model, given back if a texture fails to load
+	std::vector<int> acquiredTextures;
+
+	//Start decoding every new texture of the model at once, each into its own staging buffer.
+	//Only names are matched here, files with the same contents are found once their hashes are back
 	for (size_t i = 0; i < textureNames.size(); i++)
 	{
-		//If maertai had no texture , set '0' to indicate no texture, texture 0 will be reserved for a default texture
 		if (textureNames[i].empty())
 		{
-			matToTex[i] = 0;
+			continue;
 		}
-		else
+
+		std::string texturePath = TextureCache::getCanonicalPath("Textures/" + textureNames[i]);
+		auto pending = std::find_if(pendingTextures.begin(), pendingTextures.end(),
+			[&texturePath](const PendingTexture& pendingTexture) { return pendingTexture.path == texturePath; });
+		if (pending != pendingTextures.end())
+		{
+			pending->materials.push_back(i);
+			continue;
+		}
+
+		int cachedTexture = textureCache.acquire(texturePath, 0);
+		if (cachedTexture >= 0)
 		{
-			// Otherwise, create texture and set value to index of new texture
-			matToTex[i] = createTexture(textureNames[i]); 
+			matToTex[i] = cachedTexture;
+			acquiredTextures.push_back(cachedTexture);
+			continue;
 		}
+
+		std::string fileName = textureNames[i];
+		PendingTexture pendingTexture;
+		pendingTexture.path = texturePath;
+		pendingTexture.upload = textureDecodePool.submit([this, fileName, texturePath]()
+		{
+			uint64_t contentHash = textureCache.getContentHash(texturePath);
+			TextureUpload upload = decodeTexture(fileName);
+			upload.contentHash = contentHash;
+			return upload;
+		});
+		pendingTexture.materials.push_back(i);
+		pendingTextures.push_back(std::move(pendingTexture));
+	}
+
+	//Meshes are extracted meanwhile, a failure still waits for the decodes below since they run against this renderer
+	std::exception_ptr loadError;
+	std::vector<MeshData> meshDataList;
+	try
+	{
+		meshDataList = MeshModel::ExtractNode(scene->mRootNode, scene);
+	}
+	catch (...)
+	{
+		loadError = std::current_exception();
+	}
+
+	//Upload in material order, a failed extraction or decode is rethrown once every staging buffer and this model's textures are freed
+	{
+		CPU_PROFILE_ZONE("Wait Texture Decodes");
+		for (PendingTexture& pendingTexture : pendingTextures)
+		{
+			try
+			{
+				TextureUpload upload = pendingTexture.upload.get();
+				if (loadError)
+				{
+					destroyTextureUpload(upload);
+					continue;
+				}
+
+				//First material owns the new (or same contents) texture, the others take a reference like any repeated file
+				int textureId = createTexture(upload, pendingTexture.path);
+				matToTex[pendingTexture.materials[0]] = textureId;
+				acquiredTextures.push_back(textureId);
+				for (size_t i = 1; i < pendingTexture.materials.size(); i++)
+				{
+					matToTex[pendingTexture.materials[i]] = textureCache.acquire(pendingTexture.path, upload.contentHash);
+					acquiredTextures.push_back(matToTex[pendingTexture.materials[i]]);
+				}
+			}
+			catch (...)
+			{
+				if (!loadError)
+				{
+					loadError = std::current_exception();
+				}
+			}
+		}
+	}
+	if (loadError)
+	{
+		for (int textureId : acquiredTextures)
+		{
+			releaseTexture(textureId);
+		}
+		std::rethrow_exception(loadError);
 	}
 
 	//Load in all our meshes
-	std::vector<Mesh> modelMeshes = MeshModel::LoadNode(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
-		scene->mRootNode, scene, matToTex);
+	std::vector<Mesh> modelMeshes;
+	for (MeshData& meshData : meshDataList)
+	{
+		modelMeshes.push_back(Mesh(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
+			&meshData.vertices, &meshData.indices, matToTex[meshData.materialIndex]));
+	}
 
 	MeshModel meshModel = MeshModel(modelMeshes);
 	modelList.push_back(meshModel);
+	modelPipelineVariants.push_back(graphicsPipelineVariant);
+	modelPipelineDescriptions.push_back(geometryPipelineDescription);
+	modelShaderObjects.push_back(geometryShaderObjects);
+	renderStats.setModelName(modelList.size() - 1, modelFile);
 
 	return modelList.size() - 1;
 }
@@ -2149,3 +2917,40 @@ stbi_uc* VulkanRender::loadTextureFile(std::string fileNmae, int* width, int* he
 	*imageSize = *width * *height * 4;
 	return image;
 }
+
+bool VulkanRender::loadCompressedTextureFile(std::string fileName, TextureFile* texture)
+{
+	//Referenced directly: there is nothing to fall back to
+	if (isCompressedTextureFile(fileName))
+	{
+		*texture = readTextureFile("Textures/" + fileName);
+		if (!checkTextureFormatSupport(texture->format))
+		{
+			throw std::runtime_error("Failed to load a Texture file, the device can't sample its format! (" + fileName + ")");
+		}
+		return true;
+	}
+
+	if (!settings.preferCompressedTextures)
+	{
+		return false;
+	}
+
+	//Sibling of a decodable file, only taken when the device can sample it (e.g. no BC on most mobile GPUs)
+	for (const std::string& compressedName : getCompressedTextureNames(fileName))
+	{
+		std::string fileloc = "Textures/" + compressedName;
+		if (!std::ifstream(fileloc, std::ios::binary).is_open())
+		{
+			continue;
+		}
+
+		TextureFile candidate = readTextureFile(fileloc);
+		if (checkTextureFormatSupport(candidate.format))
+		{
+			*texture = std::move(candidate);
+			return true;
+		}
+	}
+	return false;
+}
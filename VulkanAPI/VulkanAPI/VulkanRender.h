@@ -15,34 +15,153 @@
 #include<vector>
 #include<algorithm>
 #include<array>
+#include<functional>
 #include"stb_image.h"
 #include "VulkanValidation.h"
 #include"Utilities.h"
 #include"Mesh.h"
 #include"MeshModel.h"
+#include"GpuProfiler.h"
+#include"CpuProfiler.h"
+#include"RenderStats.h"
+#include"PipelineCache.h"
+#include"PipelineBuilder.h"
+#include"PipelineVariantCache.h"
+#include"ShaderObjects.h"
+#include"ShaderReflection.h"
+#include"DescriptorAllocator.h"
+#include"DescriptorSetCache.h"
+#include"MipmapGenerator.h"
+#include"TextureFile.h"
+#include"TextureCache.h"
+#include"ThreadPool.h"
+
+//CPU time the last draw() spent blocked on the GPU or presentation engine, in milliseconds
+struct FrameWaitTimes
+{
+	double fenceWaitMs = 0.0;
+	double acquireMs = 0.0;
+	double presentMs = 0.0;
+	double submitMs = 0.0;		//Not a wait: recording, uniform updates and vkQueueSubmit
+};
+
+//Finished frame copied back from the GPU, pixels are only valid during the callback
+struct ReadbackFrame
+{
+	uint64_t frameNumber = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t rowPitch = 0;		//Bytes per row of pixels
+	VkFormat format = VK_FORMAT_UNDEFINED;		//Swapchain format (often BGRA) or RGBA8 when headless
+	const uint8_t* pixels = nullptr;
+};
+
+typedef std::function<void(const ReadbackFrame&)> FrameReadbackCallback;
+
+//Texture decoded (or parsed) into its own staging buffer, ready to be copied into an image
+struct TextureUpload
+{
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t storedLevels = 1;		//More than one: the file's own mip chain, nothing is generated
+	std::vector<VkBufferImageCopy> copyRegions;		//One per stored level
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+	uint64_t contentHash = 0;		//Of the file, 0 when content hashing is off
+};
+
+//Time spent in init, printed at startup so cold and warm pipeline cache runs can be compared
+struct StartupTimes
+{
+	double initMs = 0.0;
+	double pipelineMs = 0.0;		//createGraphicsPipeline (pipelines or shader objects)
+	double pipelineCacheLoadMs = 0.0;
+	size_t pipelineCacheBytes = 0;		//Loaded from disk (0 when cold)
+	bool warmPipelineCache = false;
+};
+
 class VulkanRender
 {
 public:
 	VulkanRender();
 
-	int init(GLFWwindow* newWindow);
+	//newWindow may be nullptr when settings.headless is set
+	int init(GLFWwindow* newWindow, RenderSettings newSettings = RenderSettings());
 
 	int createMeshModel(std::string modelFile);
 	void updateModel(int modelId, glm::mat4 newModel);
+
+	//Cull, blend, depth and fill mode of a model and its instances (transparent, double-sided, wireframe...)
+	void setModelRenderState(int modelId, const RenderState& state);
+
+	//Texture sampling and vertex colour of a model, compiled into its pipeline as specialization constants
+	void setModelMaterialFeatures(int modelId, const MaterialFeatures& features);
+
+	//Extra placement of a loaded model sharing its meshes, textureOverride >= 0 replaces the texture of every mesh
+	int createModelInstance(int modelId, glm::mat4 newModel, int textureOverride = -1);
+	void updateModelInstance(int instanceId, glm::mat4 newModel);
+
+	//Drops one reference to a texture id from a model, the image and its descriptor go with the last one
+	//Throws instead of dropping the last reference while a mesh of a loaded model still uses the id
+	void releaseTexture(int textureId);
+	size_t getTextureCount() { return bindlessEnabled ? bindlessTextureCount : pushDescriptorsEnabled ? pushTextureDescriptors.size() : samplerDescriptorSets.size(); };
+	size_t getDescriptorPoolCount() { return descriptorAllocator.getPoolCount() + textureDescriptorAllocator.getPoolCount(); };
+	DescriptorSetCache& getDescriptorSetCache() { return descriptorSetCache; };
+	TextureCache& getTextureCache() { return textureCache; };
 	void draw();
 	void cleanup();
 
+	GpuProfiler& getGpuProfiler() { return gpuProfiler; };
+	RenderStats& getRenderStats() { return renderStats; };
+	PipelineVariantCache& getPipelineVariants() { return pipelineVariants; };
+	uint64_t getFrameNumber() { return frameNumber; };
+	const FrameWaitTimes& getLastWaitTimes() { return lastWaitTimes; };
+	const StartupTimes& getStartupTimes() { return startupTimes; };
+	RenderBackend getBackend() { return shaderObjectsEnabled ? RenderBackend::ShaderObjects : RenderBackend::Pipelines; };
+	TextureBinding getTextureBinding() { return bindlessEnabled ? TextureBinding::Bindless :
+		pushDescriptorsEnabled ? TextureBinding::PushDescriptors : TextureBinding::DescriptorSets; };
+	std::string getDeviceName();
+	bool isHeadless() { return settings.headless; };
+
+	//Receive every n-th finished frame once its fence has signalled (a few frames after draw), without waiting for the device
+	//Setting a callback adds a copy to a host visible buffer at the end of those frames, the others are not copied
+	void setFrameReadbackCallback(FrameReadbackCallback callback, uint32_t frameInterval = 1) {
+		frameReadbackCallback = callback; readbackInterval = frameInterval > 0 ? frameInterval : 1; };
+	bool isReadbackSupported() { return readbackSupported; };		//False if the swapchain images can't be copied from
+
+	//Wait for all submitted frames and collect their profiling results
+	void flushFrames();
+
+	//Export CPU zones and GPU scopes of the given frames to a Chrome trace file
+	bool writeTrace(const std::string& fileName, uint64_t firstFrame, uint64_t lastFrame);
+
 
 	~VulkanRender();
 
 private:
 	GLFWwindow* window;
+	RenderSettings settings;
 
 	int currentFrame = 0;
+	uint64_t frameNumber = 0;		//Total frames drawn, used to tag profiling data
+	FrameWaitTimes lastWaitTimes;
+	StartupTimes startupTimes;
 
 	//Scene Objects
 	 //std::vector<Mesh> meshList;
 	std::vector<MeshModel> modelList;
+	std::vector<int> modelPipelineVariants;		//Geometry pipeline variant of each model (pipelines owned by pipelineVariants)
+	std::vector<PipelineDescription> modelPipelineDescriptions;		//Render state and shader constants of each model
+	std::vector<int> modelShaderObjects;		//Shader pair of each model when drawing with shader objects
+
+	struct ModelInstance
+	{
+		int modelId;
+		int textureOverride;
+		glm::mat4 model;
+	};
+	std::vector<ModelInstance> instanceList;
 	
 	//Scene Settings
 	 struct UboViewProjection
@@ -66,7 +185,8 @@ private:
 	VkSurfaceKHR surface;
 	VkSwapchainKHR swapChain;
 
-	std::vector<SwapChainImage> swapChainImages;
+	std::vector<SwapChainImage> swapChainImages;		//Device owned render targets when headless
+	std::vector<VkDeviceMemory> headlessImageMemory;
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 	std::vector<VkCommandBuffer> commandbuffers;
 
@@ -86,13 +206,19 @@ private:
 	VkDescriptorSetLayout samplerSetLayout;
 	VkDescriptorSetLayout inputSetLayout;
 	VkPushConstantRange pushConstantRange;
+	ShaderReflection shaderReflection;
+	MipmapGenerator mipmapGenerator;		//Fills texture mip chains during upload
+	ShaderLayout geometryShaderLayout;		//Reflected from the geometry pass shaders
+	ShaderLayout postShaderLayout;		//Reflected from the second pass shaders
 
 
-	VkDescriptorPool descriptorPool;
-	VkDescriptorPool samplerDescriptorPool;
-	VkDescriptorPool inputDescriptorPool;
+	DescriptorAllocator descriptorAllocator;		//Uniform and input attachment sets
+	DescriptorAllocator textureDescriptorAllocator;		//Texture sets, grows with the textures loaded
+	DescriptorSetCache descriptorSetCache;		//Every non-bindless set, shared between identical requests
 	std::vector<VkDescriptorSet> descriptorSets;
 	std::vector<VkDescriptorSet> samplerDescriptorSets;
+	VkDescriptorSet bindlessDescriptorSet = VK_NULL_HANDLE;		//Every texture, replaces samplerDescriptorSets in bindless mode
+	std::vector<VkDescriptorImageInfo> pushTextureDescriptors;		//Pushed per mesh, replaces samplerDescriptorSets in push descriptor mode
 	std::vector<VkDescriptorSet> inputDescriptorSets;
 
 	std::vector<VkBuffer> vpUniformBuffer;		//viewProjection uniform buffer
@@ -111,15 +237,35 @@ private:
 	std::vector<VkImage> textureImages;
 	std::vector<VkDeviceMemory> textureImageMemory;
 	std::vector<VkImageView> textureImageViews;
+	std::vector<VkFormat> textureImageFormats;		//Pre-compressed textures keep their block format
+	TextureCache textureCache;		//Texture ids by file, released entries are left VK_NULL_HANDLE above
+	ThreadPool textureDecodePool;		//Decodes the textures of a model while its meshes are extracted
 
 	//-PipeLine
-	VkPipeline graphicsPipeline;
+	int graphicsPipelineVariant = -1;		//Pipelines are looked up per frame, an optimised link may replace them
 	VkPipelineLayout pipelineLayout;
 
-	VkPipeline secondPipeline;
+	int secondPipelineVariant = -1;
 	VkPipelineLayout secondPipelineLayout;
 
 	VkRenderPass renderPass;
+	PipelineCache pipelineCache;
+	PipelineBuilder pipelineBuilder;		//Compiles pipelines on worker threads against pipelineCache
+	PipelineVariantCache pipelineVariants;		//Owns every graphics pipeline
+	PipelineDescription geometryPipelineDescription;		//Base of the material variants
+	bool fillModeNonSolidEnabled = false;
+	bool physicalDeviceProperties2Enabled = false;		//VK_KHR_get_physical_device_properties2, to query extension features
+	bool graphicsPipelineLibraryEnabled = false;		//Variants link from pre-built parts instead of compiling in full
+	bool shaderObjectsEnabled = false;		//RenderBackend::ShaderObjects requested and supported, no pipelines are built
+	ShaderObjects shaderObjects;
+	int geometryShaderObjects = -1;
+	int postShaderObjects = -1;
+	bool bindlessEnabled = false;		//TextureBinding::Bindless requested and supported
+	uint32_t bindlessTextureCapacity = 0;		//Size of the texture array
+	uint32_t bindlessTextureCount = 0;		//Slots written so far, textures are never removed
+	bool pushDescriptorsEnabled = false;		//TextureBinding::PushDescriptors requested and supported
+	bool descriptorUpdateTemplatesEnabled = false;		//Cached descriptor sets are written through one template per layout
+	PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSetKHR = nullptr;
 
 
 	//-Pools
@@ -136,6 +282,20 @@ private:
 	std::vector<VkSemaphore> renderFinished;
 	std::vector<VkFence> drawFences;
 
+	//-Frame Readback (one buffer per frame slot, collected when the slot's fence signals)
+	bool readbackSupported = false;
+	FrameReadbackCallback frameReadbackCallback;
+	uint32_t readbackInterval = 1;		//Only frames whose number is a multiple of this are copied
+	std::vector<VkBuffer> readbackBuffer;
+	std::vector<VkDeviceMemory> readbackBufferMemory;
+	std::vector<void*> readbackMapped;
+	std::vector<int64_t> readbackFrame;		//Frame copied into each slot's buffer (-1 = none pending)
+
+	//-Profiling
+	GpuProfiler gpuProfiler;
+	RenderStats renderStats;
+	bool pipelineStatisticsEnabled = false;		//Device feature enabled for RenderStats queries
+
 	//Vulkan Functions
 	//-Create Function
 	void createInstance();
@@ -143,6 +303,8 @@ private:
 	void createLogicalDevice();
 	void createSurface();
 	void createSwapChain();
+	void createHeadlessTargets();
+	void createReadbackBuffers();
 	void createRenderPass();
 	void createDescriptorSetLayout();
 	void createPushConstantRange();
@@ -156,18 +318,24 @@ private:
 	void createTextureSampler();
 
 	void createUniformBuffers();
-	void createDescriptorPool();
+	void createDescriptorAllocators();
 	void createDescriptorSets();
 	void createInputDescriptorSets();
 
 	void updateUniformBuffers(uint32_t imageIndex);
+	void deliverReadbackFrame(uint32_t frameSlot);
 
 	//-Record Functions
 	void recordCommands(uint32_t currebtImage);
+	void updateModelPipeline(int modelId);
+	void recordModelDraws(uint32_t currentImage, MeshModel* meshModel, glm::mat4* model, int textureOverride);
 
 	//-Get Functions
 	void getPhysicalDevice();
 
+	//--Get Functions
+	std::vector<const char*> getRequiredDeviceExtensions();
+
 	//-Allocate Functions
 	void allocateDynamicBufferTransferSpace();
 
@@ -177,6 +345,15 @@ private:
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 	bool checkValidationLayerSupport();
 	bool checkDeviceSuitable(VkPhysicalDevice device);
+	bool checkPipelineLibrarySupport();
+	bool checkShaderObjectSupport();
+	bool checkDescriptorIndexingSupport();
+	bool checkPushDescriptorSupport();
+	bool checkTextureFormatSupport(VkFormat format);
+	bool getPhysicalDeviceFeatures2(VkPhysicalDeviceFeatures2* features);
+	bool getPhysicalDeviceProperties2(VkPhysicalDeviceProperties2* properties);
+	bool isInstanceExtensionAvailable(const char* extensionName);
+	bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
 	
 
 	//--Getter Functions
@@ -191,16 +368,22 @@ private:
 
 	//--Create Functions
 	VkImage createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlages,
-		VkMemoryPropertyFlags propFlages, VkDeviceMemory* imageMemory);
-	VkImageView crateImageView(VkImage image,VkFormat format,VkImageAspectFlags aspectFlags);
-	VkShaderModule createShaderModule(const std::vector<char>& code);
+		VkMemoryPropertyFlags propFlages, VkDeviceMemory* imageMemory, uint32_t mipLevels = 1);
+	VkImageView crateImageView(VkImage image,VkFormat format,VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
 
-	int createTextureImage(std::string fileName);
+	int createTextureImage(const TextureUpload& upload);		//Frees the upload's staging buffer
+	int acquireCachedTexture(const std::string& fileName, std::string* texturePath, uint64_t* contentHash);
 	int createTexture(std::string fileName);
+	int createTexture(const TextureUpload& upload, const std::string& texturePath);		//Frees the upload, shares a texture with the same contents
 	int createTextureDescriptor(VkImageView textureImage);
 	
 
 	//--Loader Functions
 	stbi_uc* loadTextureFile(std::string fileNmae, int * width, int* height, VkDeviceSize* imageSize);
+	bool loadCompressedTextureFile(std::string fileName, TextureFile* texture);
+
+	//Thread safe: only touches the device to create and fill the staging buffer
+	TextureUpload decodeTexture(std::string fileName);
+	void destroyTextureUpload(const TextureUpload& upload);
 };
 
@@ -14,7 +14,10 @@
 #include<stdexcept>
 #include<vector>
 #include <iostream>
+#include <cmath>
 #include "VulkanRender.h"
+#include "Benchmark.h"
+#include "FrameCapture.h"
 
 GLFWwindow* window;
 VulkanRender vulkanRender;
@@ -31,16 +34,220 @@ void initWindow(std::string wName="Test Window", const int width=800,const int h
     window = glfwCreateWindow(width, height, wName.c_str(),nullptr,nullptr);
 }
 
-int main() {
+void printUsage()
+{
+    printf("Usage: VulkanAPI [--stats] [--headless [<width>x<height>]] [--benchmark <scene>] [--warmup <frames>]\n");
+    printf("                 [--frames <frames>] [--timestep <seconds>] [--output <file.json>] [--trace <file.json>]\n");
+    printf("                 [--capture <file.y4m | png prefix>] [--capture-every <frames>] [--backend pipelines|shader-objects]\n");
+    printf("                 [--no-depth-split] [--textures sets|bindless|push] [--no-compressed-textures]\n");
+    printf("                 [--hash-textures]\n");
+    printf("Benchmark scenes:");
+    for (const auto& scene : Benchmark::getScenes())
+    {
+        printf(" %s", scene.name.c_str());
+    }
+    printf("\n");
+}
+
+//Fill settings and benchmark options from the command line, returns false on bad arguments
+bool parseArguments(int argc, char** argv, RenderSettings* settings, bool* benchmark, BenchmarkOptions* benchmarkOptions,
+    CaptureSettings* captureSettings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--stats")
+        {
+            settings->collectStats = true;
+        }
+        else if (arg == "--headless")
+        {
+            settings->headless = true;
+            if (hasValue && argv[i + 1][0] != '-')
+            {
+                std::string size = argv[++i];
+                size_t separator = size.find('x');
+                if (separator == std::string::npos)
+                {
+                    printf("Headless size must look like 1280x720: %s\n", size.c_str());
+                    return false;
+                }
+                settings->headlessWidth = static_cast<uint32_t>(std::stoul(size.substr(0, separator)));
+                settings->headlessHeight = static_cast<uint32_t>(std::stoul(size.substr(separator + 1)));
+            }
+        }
+        else if (arg == "--benchmark")
+        {
+            *benchmark = true;
+            if (hasValue && argv[i + 1][0] != '-')
+            {
+                benchmarkOptions->scene = argv[++i];
+            }
+        }
+        else if (arg == "--warmup" && hasValue)
+        {
+            benchmarkOptions->warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            benchmarkOptions->measuredFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--timestep" && hasValue)
+        {
+            benchmarkOptions->timestep = std::stod(argv[++i]);
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            benchmarkOptions->outputFile = argv[++i];
+        }
+        else if (arg == "--trace" && hasValue)
+        {
+            benchmarkOptions->traceFile = argv[++i];
+        }
+        else if (arg == "--capture" && hasValue)
+        {
+            captureSettings->output = argv[++i];
+        }
+        else if (arg == "--capture-every" && hasValue)
+        {
+            captureSettings->frameInterval = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--no-depth-split")
+        {
+            settings->depthSplit = false;
+        }
+        else if (arg == "--no-compressed-textures")
+        {
+            settings->preferCompressedTextures = false;
+        }
+        else if (arg == "--hash-textures")
+        {
+            settings->hashTextureContents = true;
+        }
+        else if (arg == "--backend" && hasValue)
+        {
+            if (!parseRenderBackend(argv[++i], &settings->backend))
+            {
+                printf("Unknown backend: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (arg == "--textures" && hasValue)
+        {
+            if (!parseTextureBinding(argv[++i], &settings->textureBinding))
+            {
+                printf("Unknown texture binding: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else
+        {
+            printf("Unknown or incomplete argument: %s\n", arg.c_str());
+            return false;
+        }
+    }
 
-    //create window
-    initWindow("Vulkan Test Window",800,600);
+    return benchmarkOptions->measuredFrames > 0 && benchmarkOptions->timestep > 0.0 &&
+        settings->headlessWidth > 0 && settings->headlessHeight > 0;
+}
+
+int main(int argc, char** argv) {
+
+    //Optional renderer features from the command line
+    RenderSettings settings;
+    bool benchmark = false;
+    BenchmarkOptions benchmarkOptions;
+    CaptureSettings captureSettings;
+    try
+    {
+        if (!parseArguments(argc, argv, &settings, &benchmark, &benchmarkOptions, &captureSettings))
+        {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    //create window (headless renders without one, e.g. on CI machines with a software driver)
+    window = nullptr;
+    if (!settings.headless)
+    {
+        initWindow("Vulkan Test Window", 800, 600);
+    }
 
     //create Vulkan Render instance
-    if (vulkanRender.init(window) == EXIT_FAILURE)
+    if (vulkanRender.init(window, settings) == EXIT_FAILURE)
     {
         return EXIT_FAILURE;
     }
+
+    //Captured frames are encoded on a worker thread, the render loop only copies them out of the readback buffers
+    FrameCapture frameCapture;
+    if (!captureSettings.output.empty())
+    {
+        if (!vulkanRender.isReadbackSupported())
+        {
+            printf("Capture not started: swapchain images can't be copied on this device\n");
+        }
+        else if (frameCapture.start(captureSettings))
+        {
+            vulkanRender.setFrameReadbackCallback([&frameCapture](const ReadbackFrame& frame) { frameCapture.submit(frame); },
+                captureSettings.frameInterval);
+        }
+    }
+
+    //Benchmark renders a fixed number of frames and exits
+    if (benchmark)
+    {
+        Benchmark benchmarkRun(&vulkanRender, window, benchmarkOptions);
+        int result = benchmarkRun.run();
+
+        frameCapture.stop();
+        vulkanRender.cleanup();
+        if (window != nullptr)
+        {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
+
+        return result;
+    }
+
+    //Headless without a benchmark renders --frames frames of the default scene and exits
+    if (settings.headless)
+    {
+        //Frames are only read back when capturing, the callback set above handles them
+        int result = EXIT_SUCCESS;
+        try
+        {
+            int modelIndex = vulkanRender.createMeshModel("Models/chopper.obj");
+            for (uint32_t i = 0; i < benchmarkOptions.measuredFrames; i++)
+            {
+                float angle = static_cast<float>(std::fmod(10.0 * i * benchmarkOptions.timestep, 360.0));
+                vulkanRender.updateModel(modelIndex, glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f)));
+                vulkanRender.draw();
+            }
+            vulkanRender.flushFrames();
+
+            printf("Rendered %u headless frames at %ux%u on %s\n", benchmarkOptions.measuredFrames,
+                settings.headlessWidth, settings.headlessHeight, vulkanRender.getDeviceName().c_str());
+        }
+        catch (const std::runtime_error& e)
+        {
+            printf("ERROR: %s \n", e.what());
+            result = EXIT_FAILURE;
+        }
+
+        frameCapture.stop();
+        vulkanRender.cleanup();
+        return result;
+    }
     
     float angle = 0.0f;
     float deltaTime = 0.0f;
@@ -67,6 +274,8 @@ int main() {
         vulkanRender.draw();
     }
 
+    vulkanRender.flushFrames();
+    frameCapture.stop();
     vulkanRender.cleanup();
     //Detory GLFW window and stop GLFW
     glfwDestroyWindow(window);
@@ -0,0 +1,412 @@
+#define STB_IMAGE_IMPLEMENTATION
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLFW_INCLUDE_VULKAN
+#include<GLFW/glfw3.h>
+
+#include<stdexcept>
+#include<vector>
+#include<string>
+#include<sstream>
+#include "VulkanRender.h"
+#include "Benchmark.h"
+#include "LoaderBench.h"
+#include "RegressionRunner.h"
+
+//Scene scaling suite: every model x instance count x texture order x transform mode, each on a fresh headless renderer
+struct SuiteOptions
+{
+	std::vector<std::string> models = { "chopper", "tree" };
+	std::vector<uint32_t> instanceCounts = { 1, 100, 1000, 10000, 100000 };
+	uint32_t maxInstances = 100000;
+	std::string filter;		//Only run scenes whose name contains this
+	bool compareTextureBindings = false;		//Run every scene with descriptor sets and push descriptors
+	RenderSettings settings;
+	BenchmarkOptions benchmark;
+};
+
+void printUsage()
+{
+	printf("Usage: VulkanBench [--models chopper,tree] [--counts 1,100,1000,10000,100000] [--max-instances <n>]\n");
+	printf("                   [--filter <text>] [--size <width>x<height>] [--warmup <frames>] [--frames <frames>]\n");
+	printf("                   [--timestep <seconds>] [--output <file.json>] [--backend pipelines|shader-objects]\n");
+	printf("                   [--textures sets|bindless|push] [--compare-textures] [--no-compressed-textures] [--hash-textures]\n");
+	printf("       VulkanBench --loader [--model-dir <dir>] [--texture-dir <dir>] [--iterations <n>] [--output <file.json>]\n");
+	printf("                   (CPU only loader stages, no Vulkan device needed)\n");
+	printf("       VulkanBench --regress [--record] [--baseline <file.json>] [--golden <dir>] [--images <dir>]\n");
+	printf("                   [--tolerance <fraction>] [--pixel-threshold <0-255>] [--max-changed <fraction>]\n");
+}
+
+std::vector<std::string> splitList(const std::string& list)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		if (!item.empty()) items.push_back(item);
+	}
+	return items;
+}
+
+//Fill suite options from the command line, returns false on bad arguments
+bool parseArguments(int argc, char** argv, SuiteOptions* options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--models" && hasValue)
+		{
+			options->models = splitList(argv[++i]);
+		}
+		else if (arg == "--counts" && hasValue)
+		{
+			options->instanceCounts.clear();
+			for (const auto& count : splitList(argv[++i]))
+			{
+				options->instanceCounts.push_back(static_cast<uint32_t>(std::stoul(count)));
+			}
+		}
+		else if (arg == "--max-instances" && hasValue)
+		{
+			options->maxInstances = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--filter" && hasValue)
+		{
+			options->filter = argv[++i];
+		}
+		else if (arg == "--size" && hasValue)
+		{
+			std::string size = argv[++i];
+			size_t separator = size.find('x');
+			if (separator == std::string::npos) return false;
+			options->settings.headlessWidth = static_cast<uint32_t>(std::stoul(size.substr(0, separator)));
+			options->settings.headlessHeight = static_cast<uint32_t>(std::stoul(size.substr(separator + 1)));
+		}
+		else if (arg == "--warmup" && hasValue)
+		{
+			options->benchmark.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--frames" && hasValue)
+		{
+			options->benchmark.measuredFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--timestep" && hasValue)
+		{
+			options->benchmark.timestep = std::stod(argv[++i]);
+		}
+		else if (arg == "--output" && hasValue)
+		{
+			options->benchmark.outputFile = argv[++i];
+		}
+		else if (arg == "--backend" && hasValue)
+		{
+			if (!parseRenderBackend(argv[++i], &options->settings.backend))
+			{
+				printf("Unknown backend: %s\n", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--textures" && hasValue)
+		{
+			if (!parseTextureBinding(argv[++i], &options->settings.textureBinding))
+			{
+				printf("Unknown texture binding: %s\n", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--compare-textures")
+		{
+			options->compareTextureBindings = true;
+		}
+		else if (arg == "--no-compressed-textures")
+		{
+			options->settings.preferCompressedTextures = false;
+		}
+		else if (arg == "--hash-textures")
+		{
+			options->settings.hashTextureContents = true;
+		}
+		else
+		{
+			printf("Unknown or incomplete argument: %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return options->benchmark.measuredFrames > 0 && options->benchmark.timestep > 0.0 && !options->models.empty();
+}
+
+//Fill loader options from the command line (after --loader), returns false on bad arguments
+bool parseLoaderArguments(int argc, char** argv, LoaderBenchOptions* options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--model-dir" && hasValue)
+		{
+			options->modelDirectory = argv[++i];
+		}
+		else if (arg == "--texture-dir" && hasValue)
+		{
+			options->textureDirectory = argv[++i];
+		}
+		else if (arg == "--iterations" && hasValue)
+		{
+			options->iterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--output" && hasValue)
+		{
+			options->outputFile = argv[++i];
+		}
+		else
+		{
+			printf("Unknown or incomplete argument: %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return options->iterations > 0;
+}
+
+//Fill regression options from the command line (after --regress), returns false on bad arguments
+bool parseRegressionArguments(int argc, char** argv, RegressionOptions* options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--record")
+		{
+			options->record = true;
+		}
+		else if (arg == "--baseline" && hasValue)
+		{
+			options->baselineFile = argv[++i];
+		}
+		else if (arg == "--golden" && hasValue)
+		{
+			options->goldenDirectory = argv[++i];
+		}
+		else if (arg == "--images" && hasValue)
+		{
+			options->outputDirectory = argv[++i];
+		}
+		else if (arg == "--tolerance" && hasValue)
+		{
+			options->tolerance = std::stod(argv[++i]);
+		}
+		else if (arg == "--pixel-threshold" && hasValue)
+		{
+			options->pixelThreshold = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--max-changed" && hasValue)
+		{
+			options->maxChangedPixels = std::stod(argv[++i]);
+		}
+		else
+		{
+			printf("Unknown or incomplete argument: %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return options->maxChangedPixels >= 0.0;
+}
+
+//All scene variations selected by the options
+std::vector<BenchmarkScene> buildScenes(const SuiteOptions& options)
+{
+	std::vector<BenchmarkScene> scenes;
+	for (const auto& modelName : options.models)
+	{
+		//Single model scenes of the standard benchmark provide the files
+		const BenchmarkScene* baseScene = nullptr;
+		for (const auto& candidate : Benchmark::getScenes())
+		{
+			if (candidate.name == modelName) baseScene = &candidate;
+		}
+		if (baseScene == nullptr)
+		{
+			throw std::runtime_error("Unknown model \"" + modelName + "\"!");
+		}
+
+		for (uint32_t count : options.instanceCounts)
+		{
+			if (count == 0 || count > options.maxInstances) continue;
+
+			for (int randomTextures = 0; randomTextures < 2; randomTextures++)
+			{
+				for (int animated = 0; animated < 2; animated++)
+				{
+					BenchmarkScene scene = *baseScene;
+					scene.instanceCount = count;
+					scene.randomTextures = randomTextures == 1;
+					scene.animated = animated == 1;
+					scene.name = modelName + "_n" + std::to_string(count) + (scene.randomTextures ? "_random" : "_sorted")
+						+ (scene.animated ? "_animated" : "_static");
+
+					if (options.filter.empty() || scene.name.find(options.filter) != std::string::npos)
+					{
+						scenes.push_back(scene);
+					}
+				}
+			}
+		}
+	}
+	return scenes;
+}
+
+int main(int argc, char** argv)
+{
+	//Loader microbenchmarks never touch the renderer
+	if (argc > 1 && std::string(argv[1]) == "--loader")
+	{
+		LoaderBenchOptions loaderOptions;
+		try
+		{
+			if (!parseLoaderArguments(argc, argv, &loaderOptions))
+			{
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		catch (const std::logic_error&)
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		LoaderBench loaderBench(loaderOptions);
+		return loaderBench.run();
+	}
+
+	//Fixed size and frame counts so runs are comparable with the stored baseline
+	if (argc > 1 && std::string(argv[1]) == "--regress")
+	{
+		RegressionOptions regressionOptions;
+		regressionOptions.settings.headless = true;
+		regressionOptions.benchmark.warmupFrames = 30;
+		regressionOptions.benchmark.measuredFrames = 300;
+		try
+		{
+			if (!parseRegressionArguments(argc, argv, &regressionOptions))
+			{
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		catch (const std::logic_error&)
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		RegressionRunner regressionRunner(regressionOptions);
+		return regressionRunner.run();
+	}
+
+	SuiteOptions options;
+	options.settings.headless = true;
+	options.benchmark.warmupFrames = 20;
+	options.benchmark.measuredFrames = 200;
+	options.benchmark.outputFile = "bench_results.json";
+
+	std::vector<BenchmarkScene> scenes;
+	try
+	{
+		if (!parseArguments(argc, argv, &options))
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+		scenes = buildScenes(options);
+	}
+	catch (const std::logic_error&)
+	{
+		printUsage();
+		return EXIT_FAILURE;
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("ERROR: %s \n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	//Texture binding modes every scene runs with
+	std::vector<TextureBinding> textureBindings = { options.settings.textureBinding };
+	if (options.compareTextureBindings)
+	{
+		textureBindings = { TextureBinding::DescriptorSets, TextureBinding::PushDescriptors };
+	}
+
+	std::vector<BenchmarkResult> results;
+	std::vector<std::vector<size_t>> sceneResults(scenes.size());		//Indices into results, one per texture binding that ran
+	std::string deviceName;
+	int exitCode = EXIT_SUCCESS;
+
+	printf("%-32s %8s %8s %12s %12s %12s %12s %12s %12s\n", "scene", "objects", "textures", "startup ms", "cpu ms", "submit ms", "gpu ms", "device MB", "process MB");
+	for (size_t i = 0; i < scenes.size(); i++)
+	{
+		for (TextureBinding textureBinding : textureBindings)
+		{
+			//Fresh renderer per scene so memory and caches don't carry over
+			RenderSettings settings = options.settings;
+			settings.textureBinding = textureBinding;
+			VulkanRender* renderer = new VulkanRender();
+			MemoryStats::resetPeak();
+			if (renderer->init(nullptr, settings) == EXIT_FAILURE)
+			{
+				delete renderer;
+				return EXIT_FAILURE;
+			}
+			deviceName = renderer->getDeviceName();
+
+			Benchmark benchmark(renderer, nullptr, options.benchmark);
+			if (benchmark.run(scenes[i]) == EXIT_SUCCESS)
+			{
+				const BenchmarkResult& result = benchmark.getResult();
+				sceneResults[i].push_back(results.size());
+				results.push_back(result);
+				printf("%-32s %8u %8s %12.1f %12.3f %12.3f %12.3f %12.1f %12.1f\n", result.scene.c_str(), result.objectCount,
+					result.textureBinding.c_str(), result.startupMs, result.cpuFrame.mean, result.cpuSubmit.mean, result.gpuFrame.mean,
+					result.deviceMemory.peakBytes / (1024.0 * 1024.0), result.processMemoryBytes / (1024.0 * 1024.0));
+			}
+			else
+			{
+				exitCode = EXIT_FAILURE;
+			}
+
+			renderer->cleanup();
+			delete renderer;
+		}
+	}
+
+	//Side by side, the binding names are the ones actually used so a device without push descriptors shows "sets" twice
+	if (options.compareTextureBindings)
+	{
+		printf("\n%-32s %8s %8s %12s %12s %12s %12s %12s %12s\n", "scene", "first", "second", "cpu ms", "cpu ms", "submit ms", "submit ms", "gpu ms", "gpu ms");
+		for (size_t i = 0; i < scenes.size(); i++)
+		{
+			if (sceneResults[i].size() < 2) continue;
+
+			const BenchmarkResult& first = results[sceneResults[i][0]];
+			const BenchmarkResult& second = results[sceneResults[i][1]];
+			printf("%-32s %8s %8s %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n", scenes[i].name.c_str(),
+				first.textureBinding.c_str(), second.textureBinding.c_str(), first.cpuFrame.mean, second.cpuFrame.mean,
+				first.cpuSubmit.mean, second.cpuSubmit.mean, first.gpuFrame.mean, second.gpuFrame.mean);
+		}
+	}
+
+	if (!Benchmark::writeResults(options.benchmark.outputFile, deviceName, options.benchmark, results))
+	{
+		return EXIT_FAILURE;
+	}
+	printf("%zu scene results written to %s\n", results.size(), options.benchmark.outputFile.c_str());
+
+	return exitCode;
+}
@@ -0,0 +1,221 @@
+#include "JsonValue.h"
+#include<fstream>
+#include<sstream>
+#include<stdexcept>
+#include<cstdlib>
+#include<cstring>
+
+JsonValue::JsonValue()
+{
+}
+
+static std::runtime_error syntaxError(const char* message, size_t position)
+{
+	return std::runtime_error(std::string("JSON syntax error: ") + message + " at offset " + std::to_string(position));
+}
+
+JsonValue JsonValue::parse(const std::string& text)
+{
+	size_t position = 0;
+	JsonValue value = parseValue(text, &position);
+	skipWhitespace(text, &position);
+	if (position != text.size())
+	{
+		throw syntaxError("trailing characters", position);
+	}
+	return value;
+}
+
+JsonValue JsonValue::parseFile(const std::string& fileName)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open JSON file! (" + fileName + ")");
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return parse(contents.str());
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+	for (const auto& member : members)
+	{
+		if (member.first == key)
+		{
+			return &member.second;
+		}
+	}
+	return nullptr;
+}
+
+void JsonValue::skipWhitespace(const std::string& source, size_t* position)
+{
+	while (*position < source.size() && strchr(" \t\r\n", source[*position]) != nullptr && source[*position] != '\0')
+	{
+		(*position)++;
+	}
+}
+
+std::string JsonValue::parseString(const std::string& source, size_t* position)
+{
+	//Caller checked the opening quote
+	(*position)++;
+
+	std::string result;
+	while (*position < source.size() && source[*position] != '"')
+	{
+		char c = source[(*position)++];
+		if (c == '\\')
+		{
+			if (*position >= source.size()) break;
+			char escaped = source[(*position)++];
+			switch (escaped)
+			{
+			case 'n': result += '\n'; break;
+			case 't': result += '\t'; break;
+			case 'r': result += '\r'; break;
+			case 'b': result += '\b'; break;
+			case 'f': result += '\f'; break;
+			case 'u':
+				//Only ASCII is ever written by the benchmarks, anything else becomes '?'
+				if (*position + 4 > source.size()) throw syntaxError("bad unicode escape", *position);
+				{
+					long code = strtol(source.substr(*position, 4).c_str(), nullptr, 16);
+					result += code < 0x80 ? static_cast<char>(code) : '?';
+				}
+				*position += 4;
+				break;
+			default: result += escaped; break;
+			}
+		}
+		else
+		{
+			result += c;
+		}
+	}
+
+	if (*position >= source.size())
+	{
+		throw syntaxError("unterminated string", *position);
+	}
+	(*position)++;
+	return result;
+}
+
+JsonValue JsonValue::parseValue(const std::string& source, size_t* position)
+{
+	skipWhitespace(source, position);
+	if (*position >= source.size())
+	{
+		throw syntaxError("unexpected end", *position);
+	}
+
+	JsonValue value;
+	char c = source[*position];
+	if (c == '{')
+	{
+		value.type = Object;
+		(*position)++;
+		skipWhitespace(source, position);
+		if (*position < source.size() && source[*position] == '}')
+		{
+			(*position)++;
+			return value;
+		}
+		while (true)
+		{
+			skipWhitespace(source, position);
+			if (*position >= source.size() || source[*position] != '"')
+			{
+				throw syntaxError("expected member name", *position);
+			}
+			std::string key = parseString(source, position);
+
+			skipWhitespace(source, position);
+			if (*position >= source.size() || source[*position] != ':')
+			{
+				throw syntaxError("expected ':'", *position);
+			}
+			(*position)++;
+			value.members.emplace_back(key, parseValue(source, position));
+
+			skipWhitespace(source, position);
+			if (*position < source.size() && source[*position] == ',')
+			{
+				(*position)++;
+				continue;
+			}
+			if (*position < source.size() && source[*position] == '}')
+			{
+				(*position)++;
+				return value;
+			}
+			throw syntaxError("expected ',' or '}'", *position);
+		}
+	}
+	if (c == '[')
+	{
+		value.type = Array;
+		(*position)++;
+		skipWhitespace(source, position);
+		if (*position < source.size() && source[*position] == ']')
+		{
+			(*position)++;
+			return value;
+		}
+		while (true)
+		{
+			value.items.push_back(parseValue(source, position));
+
+			skipWhitespace(source, position);
+			if (*position < source.size() && source[*position] == ',')
+			{
+				(*position)++;
+				continue;
+			}
+			if (*position < source.size() && source[*position] == ']')
+			{
+				(*position)++;
+				return value;
+			}
+			throw syntaxError("expected ',' or ']'", *position);
+		}
+	}
+	if (c == '"')
+	{
+		value.type = String;
+		value.text = parseString(source, position);
+		return value;
+	}
+	if (source.compare(*position, 4, "true") == 0 || source.compare(*position, 5, "false") == 0)
+	{
+		value.type = Bool;
+		value.boolean = c == 't';
+		*position += value.boolean ? 4 : 5;
+		return value;
+	}
+	if (source.compare(*position, 4, "null") == 0)
+	{
+		*position += 4;
+		return value;
+	}
+
+	//Anything else has to be a number
+	const char* start = source.c_str() + *position;
+	char* end = nullptr;
+	value.number = strtod(start, &end);
+	if (end == start)
+	{
+		throw syntaxError("unexpected character", *position);
+	}
+	value.type = Number;
+	*position += end - start;
+	return value;
+}
+
+JsonValue::~JsonValue()
+{
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<utility>
+
+//Minimal JSON document, enough to read back the files the benchmarks write
+class JsonValue
+{
+public:
+	enum Type { Null, Bool, Number, String, Array, Object };
+
+	JsonValue();
+
+	//Throws std::runtime_error with the offset of the first syntax error
+	static JsonValue parse(const std::string& text);
+	static JsonValue parseFile(const std::string& fileName);
+
+	Type getType() const { return type; };
+	bool isObject() const { return type == Object; };
+
+	double asNumber(double fallback = 0.0) const { return type == Number ? number : fallback; };
+	bool asBool(bool fallback = false) const { return type == Bool ? boolean : fallback; };
+	const std::string& asString() const { return text; };
+
+	const std::vector<JsonValue>& getItems() const { return items; };
+	const std::vector<std::pair<std::string, JsonValue>>& getMembers() const { return members; };
+
+	//Member of an object, nullptr if missing (or not an object)
+	const JsonValue* find(const std::string& key) const;
+
+	~JsonValue();
+
+private:
+	Type type = Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string text;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	static JsonValue parseValue(const std::string& source, size_t* position);
+	static std::string parseString(const std::string& source, size_t* position);
+	static void skipWhitespace(const std::string& source, size_t* position);
+};
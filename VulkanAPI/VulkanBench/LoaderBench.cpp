@@ -0,0 +1,365 @@
+#include "LoaderBench.h"
+#include<filesystem>
+#include<fstream>
+#include<iomanip>
+#include<algorithm>
+#include<cstring>
+#include<stdexcept>
+#include<future>
+
+#include<assimp/Importer.hpp>
+#include<assimp/scene.h>
+#include<assimp/postprocess.h>
+
+#include "MeshModel.h"
+#include "CpuProfiler.h"
+#include "stb_image.h"
+#include "TextureFile.h"
+
+LoaderBench::LoaderBench(LoaderBenchOptions newOptions)
+{
+	options = newOptions;
+}
+
+//Files of a directory whose extension is in the list, sorted by name
+static std::vector<std::string> listFiles(const std::string& directory, const std::vector<std::string>& extensions)
+{
+	std::vector<std::string> files;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file()) continue;
+
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+		if (std::find(extensions.begin(), extensions.end(), extension) != extensions.end())
+		{
+			files.push_back(entry.path().string());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+//CPU side of VulkanRender::decodeTexture: read + decode (or parse), returns the bytes it would stage
+static uint64_t decodeTextureFile(const std::string& fileName)
+{
+	if (isCompressedTextureFile(fileName))
+	{
+		TextureFile texture = readTextureFile(fileName);
+		return texture.data.size();
+	}
+
+	int width = 0, height = 0, channels = 0;
+	stbi_uc* pixels = stbi_load(fileName.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		throw std::runtime_error("Failed to decode a texture! (" + fileName + ")");
+	}
+	stbi_image_free(pixels);
+	return static_cast<uint64_t>(width) * height * 4;
+}
+
+static std::vector<char> readWholeFile(const std::string& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open a file! (" + fileName + ")");
+	}
+
+	std::vector<char> bytes(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(bytes.data(), bytes.size());
+	return bytes;
+}
+
+int LoaderBench::run()
+{
+	std::vector<std::string> models = listFiles(options.modelDirectory, { ".obj", ".fbx", ".dae", ".gltf", ".glb" });
+	std::vector<std::string> textures = listFiles(options.textureDirectory, { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".ktx2", ".dds" });
+	if (models.empty() && textures.empty())
+	{
+		printf("ERROR: No models in %s and no textures in %s \n", options.modelDirectory.c_str(), options.textureDirectory.c_str());
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		decodePool.start("Texture Decode");
+		for (const auto& model : models)
+		{
+			benchmarkModel(model);
+		}
+
+		//Every texture of the directory as one many-texture model
+		if (textures.size() > 1)
+		{
+			benchmarkTextureSet(options.textureDirectory, textures, []() {});
+		}
+		for (const auto& texture : textures)
+		{
+			if (isCompressedTextureFile(texture))
+			{
+				benchmarkCompressedTexture(texture);
+			}
+			else
+			{
+				benchmarkTexture(texture);
+			}
+		}
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("ERROR: %s \n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	printResults();
+	return writeResults() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+template<typename Stage>
+void LoaderBench::timeStage(const std::string& file, const std::string& stageName, uint64_t bytes, uint64_t vertices, Stage stage)
+{
+	LoaderStageResult result;
+	result.file = file;
+	result.stage = stageName;
+	result.bytes = bytes;
+	result.vertices = vertices;
+	result.bestMs = 1e30;
+
+	double totalMs = 0.0;
+	for (uint32_t i = 0; i < options.iterations; i++)
+	{
+		int64_t start = CpuProfiler::now();
+		stage();
+		double ms = (CpuProfiler::now() - start) / 1000000.0;
+		result.bestMs = std::min(result.bestMs, ms);
+		totalMs += ms;
+	}
+	result.meanMs = totalMs / options.iterations;
+
+	results.push_back(result);
+}
+
+void LoaderBench::benchmarkModel(const std::string& fileName)
+{
+	std::vector<char> fileBytes = readWholeFile(fileName);
+	timeStage(fileName, "read file", fileBytes.size(), 0, [&]() { fileBytes = readWholeFile(fileName); });
+
+	//Same flags as VulkanRender::createMeshModel
+	const unsigned int importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices;
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(fileName, importFlags);
+	if (!scene)
+	{
+		throw std::runtime_error("Failed to load model! (" + fileName + ")");
+	}
+
+	uint64_t vertexCount = 0;
+	for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+	{
+		vertexCount += scene->mMeshes[i]->mNumVertices;
+	}
+
+	//Parsing from memory keeps disk I/O out of the Assimp number (material libraries can't be resolved from memory, which is fine here)
+	std::string hint = std::filesystem::path(fileName).extension().string().substr(1);
+	timeStage(fileName, "assimp parse", fileBytes.size(), vertexCount, [&]()
+	{
+		Assimp::Importer stageImporter;
+		if (!stageImporter.ReadFileFromMemory(fileBytes.data(), fileBytes.size(), importFlags, hint.c_str()))
+		{
+			throw std::runtime_error("Failed to parse model! (" + fileName + ")");
+		}
+	});
+
+	timeStage(fileName, "load materials", 0, 0, [&]() { MeshModel::LoadMaterials(scene); });
+
+	std::vector<MeshData> meshData;
+	timeStage(fileName, "extract meshes", 0, vertexCount, [&]() { meshData = MeshModel::ExtractNode(scene->mRootNode, scene); });
+
+	//Each texture the materials name once, skipped when it isn't in the texture directory
+	std::vector<std::string> textureFiles;
+	for (const auto& textureName : MeshModel::LoadMaterials(scene))
+	{
+		std::string textureFile = (std::filesystem::path(options.textureDirectory) / textureName).string();
+		if (!textureName.empty() && std::filesystem::exists(textureFile) &&
+			std::find(textureFiles.begin(), textureFiles.end(), textureFile) == textureFiles.end())
+		{
+			textureFiles.push_back(textureFile);
+		}
+	}
+	if (!textureFiles.empty())
+	{
+		benchmarkTextureSet(fileName, textureFiles, [&]() { MeshModel::ExtractNode(scene->mRootNode, scene); });
+	}
+
+	//Stub for Mesh::createVertexBuffer/createIndexBuffer: the memcpy into mapped staging memory, without the device
+	uint64_t uploadBytes = 0;
+	for (const auto& mesh : meshData)
+	{
+		uploadBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+	}
+	std::vector<char> staging(static_cast<size_t>(uploadBytes));
+	timeStage(fileName, "staging copy", uploadBytes, vertexCount, [&]()
+	{
+		size_t offset = 0;
+		for (const auto& mesh : meshData)
+		{
+			memcpy(staging.data() + offset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+			offset += mesh.vertices.size() * sizeof(Vertex);
+			memcpy(staging.data() + offset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+			offset += mesh.indices.size() * sizeof(uint32_t);
+		}
+	});
+}
+
+void LoaderBench::benchmarkTexture(const std::string& fileName)
+{
+	std::vector<char> fileBytes = readWholeFile(fileName);
+	timeStage(fileName, "read file", fileBytes.size(), 0, [&]() { fileBytes = readWholeFile(fileName); });
+
+	//Decode to RGBA like VulkanRender::loadTextureFile, but from memory
+	int width = 0, height = 0, channels = 0;
+	stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(fileBytes.data()), static_cast<int>(fileBytes.size()),
+		&width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		printf("Skipping %s: %s\n", fileName.c_str(), stbi_failure_reason());
+		return;
+	}
+	uint64_t imageSize = static_cast<uint64_t>(width) * height * 4;
+
+	timeStage(fileName, "decode", fileBytes.size(), 0, [&]()
+	{
+		int stageWidth, stageHeight, stageChannels;
+		stbi_uc* stagePixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(fileBytes.data()), static_cast<int>(fileBytes.size()),
+			&stageWidth, &stageHeight, &stageChannels, STBI_rgb_alpha);
+		stbi_image_free(stagePixels);
+	});
+
+	//Stub for VulkanRender::createTextureImage: the memcpy into mapped staging memory, without the device
+	std::vector<stbi_uc> staging(static_cast<size_t>(imageSize));
+	timeStage(fileName, "staging copy", imageSize, 0, [&]() { memcpy(staging.data(), pixels, static_cast<size_t>(imageSize)); });
+
+	stbi_image_free(pixels);
+}
+
+void LoaderBench::benchmarkCompressedTexture(const std::string& fileName)
+{
+	std::vector<char> fileBytes = readWholeFile(fileName);
+	timeStage(fileName, "read file", fileBytes.size(), 0, [&]() { fileBytes = readWholeFile(fileName); });
+
+	//Header parse replaces decode, the blocks are uploaded as stored
+	TextureFile texture;
+	try
+	{
+		texture = parseTextureFile(fileName, fileBytes);
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("Skipping %s: %s\n", fileName.c_str(), e.what());
+		return;
+	}
+	timeStage(fileName, "parse", fileBytes.size(), 0, [&]() { parseTextureFile(fileName, fileBytes); });
+
+	//Stub for VulkanRender::createCompressedTextureImage: every stored level into staging memory
+	uint64_t imageSize = 0;
+	for (const TextureLevel& level : texture.levels)
+	{
+		imageSize += level.size;
+	}
+	std::vector<char> staging(static_cast<size_t>(imageSize));
+	timeStage(fileName, "staging copy", imageSize, 0, [&]()
+	{
+		size_t offset = 0;
+		for (const TextureLevel& level : texture.levels)
+		{
+			memcpy(staging.data() + offset, texture.data.data() + level.offset, level.size);
+			offset += level.size;
+		}
+	});
+}
+
+void LoaderBench::benchmarkTextureSet(const std::string& name, const std::vector<std::string>& textureFiles, const std::function<void()>& otherWork)
+{
+	uint64_t decodedBytes = 0;
+	for (const auto& textureFile : textureFiles)
+	{
+		decodedBytes += decodeTextureFile(textureFile);
+	}
+
+	std::string setName = name + " (" + std::to_string(textureFiles.size()) + " textures)";
+	timeStage(setName, "decode serial", decodedBytes, 0, [&]()
+	{
+		for (const auto& textureFile : textureFiles)
+		{
+			decodeTextureFile(textureFile);
+		}
+		otherWork();
+	});
+
+	//Should approach the slowest single decode once there are enough workers
+	timeStage(setName, "decode pool", decodedBytes, 0, [&]()
+	{
+		std::vector<std::future<uint64_t>> decodes;
+		for (const auto& textureFile : textureFiles)
+		{
+			decodes.push_back(decodePool.submit([textureFile]() { return decodeTextureFile(textureFile); }));
+		}
+		otherWork();
+		for (auto& decode : decodes)
+		{
+			decode.get();
+		}
+	});
+}
+
+void LoaderBench::printResults()
+{
+	printf("%-40s %-16s %10s %10s %12s %14s\n", "file", "stage", "best ms", "mean ms", "MB/s", "vertices/s");
+	for (const auto& result : results)
+	{
+		double seconds = std::max(result.bestMs, 1e-6) / 1000.0;
+		double megabytesPerSecond = result.bytes / (1024.0 * 1024.0) / seconds;
+		double verticesPerSecond = result.vertices / seconds;
+		printf("%-40s %-16s %10.3f %10.3f %12.1f %14.0f\n", result.file.c_str(), result.stage.c_str(), result.bestMs, result.meanMs,
+			megabytesPerSecond, verticesPerSecond);
+	}
+}
+
+bool LoaderBench::writeResults()
+{
+	std::ofstream file(options.outputFile, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("ERROR: Failed to open loader benchmark output %s \n", options.outputFile.c_str());
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "\t\"iterations\": " << options.iterations << ",\n";
+	file << "\t\"stages\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const LoaderStageResult& result = results[i];
+		double seconds = std::max(result.bestMs, 1e-6) / 1000.0;
+
+		file << "\t\t{ \"file\": \"" << jsonEscape(result.file) << "\", \"stage\": \"" << jsonEscape(result.stage) << "\", \"bestMs\": " << result.bestMs
+			<< ", \"meanMs\": " << result.meanMs << ", \"bytes\": " << result.bytes << ", \"vertices\": " << result.vertices
+			<< ", \"mbPerSecond\": " << result.bytes / (1024.0 * 1024.0) / seconds << ", \"verticesPerSecond\": " << result.vertices / seconds
+			<< " }" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "\t]\n";
+	file << "}\n";
+	file.close();
+
+	printf("Loader results written to %s\n", options.outputFile.c_str());
+	return true;
+}
+
+LoaderBench::~LoaderBench()
+{
+}
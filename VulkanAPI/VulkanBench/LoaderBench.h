@@ -0,0 +1,61 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<cstdint>
+#include<functional>
+
+#include "ThreadPool.h"
+
+//Command line selected loader microbenchmark
+struct LoaderBenchOptions
+{
+	std::string modelDirectory = "Models";
+	std::string textureDirectory = "Textures";
+	uint32_t iterations = 5;                        //Each stage is timed this often, the fastest run counts
+	std::string outputFile = "loader_results.json";
+};
+
+//Timing of one loading stage for one file
+struct LoaderStageResult
+{
+	std::string file;
+	std::string stage;
+	double bestMs = 0.0;                //Fastest iteration
+	double meanMs = 0.0;
+	uint64_t bytes = 0;                 //Bytes the stage consumes (file size, decoded size, copied size)
+	uint64_t vertices = 0;              //Vertices produced (0 for texture stages)
+};
+
+//Times every CPU stage of model and texture loading without a Vulkan device,
+//the GPU upload is replaced by the host side staging copy it would do
+class LoaderBench
+{
+public:
+	LoaderBench(LoaderBenchOptions newOptions);
+
+	//Returns EXIT_SUCCESS/EXIT_FAILURE
+	int run();
+
+	~LoaderBench();
+
+private:
+	LoaderBenchOptions options;
+	std::vector<LoaderStageResult> results;
+	ThreadPool decodePool;                          //Same pool shape as VulkanRender's texture decodes
+
+	void benchmarkModel(const std::string& fileName);
+	void benchmarkTexture(const std::string& fileName);
+	void benchmarkCompressedTexture(const std::string& fileName);     //.ktx2 / .dds, parsed instead of decoded
+
+	//Textures loaded together like VulkanRender::createMeshModel, one after another vs all at once on decodePool,
+	//with otherWork (mesh extraction) done on the calling thread in both
+	void benchmarkTextureSet(const std::string& name, const std::vector<std::string>& textureFiles, const std::function<void()>& otherWork);
+
+	//Run stage options.iterations times and store its timing
+	template<typename Stage>
+	void timeStage(const std::string& file, const std::string& stageName, uint64_t bytes, uint64_t vertices, Stage stage);
+
+	void printResults();
+	bool writeResults();
+};
@@ -0,0 +1,335 @@
+#include "RegressionRunner.h"
+#include<filesystem>
+#include<fstream>
+#include<iomanip>
+#include<cmath>
+#include<cstring>
+
+#include "ImageWriter.h"
+#include "stb_image.h"
+
+RegressionRunner::RegressionRunner(RegressionOptions newOptions)
+{
+	options = newOptions;
+}
+
+std::vector<BenchmarkScene> RegressionRunner::getScenes()
+{
+	//Named scenes plus an instanced one per texture order, small enough for software drivers
+	std::vector<BenchmarkScene> scenes = Benchmark::getScenes();
+
+	BenchmarkScene sorted = scenes[0];
+	sorted.name = "chopper_n1000_sorted_animated";
+	sorted.instanceCount = 1000;
+	scenes.push_back(sorted);
+
+	BenchmarkScene random = scenes[1];
+	random.name = "tree_n1000_random_static";
+	random.instanceCount = 1000;
+	random.randomTextures = true;
+	random.animated = false;
+	scenes.push_back(random);
+
+	return scenes;
+}
+
+int RegressionRunner::run()
+{
+	try
+	{
+		loadBaseline();
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("ERROR: %s \n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(options.outputDirectory, error);
+	if (options.record)
+	{
+		std::filesystem::create_directories(options.goldenDirectory, error);
+	}
+
+	bool passed = true;
+	std::string deviceName;
+	for (const auto& scene : getScenes())
+	{
+		passed = runScene(scene, &deviceName) && passed;
+	}
+
+	if (options.record)
+	{
+		return writeBaseline(deviceName) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	printf("\nRegression check %s\n", passed ? "PASSED" : "FAILED");
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void RegressionRunner::loadBaseline()
+{
+	if (!std::filesystem::exists(options.baselineFile))
+	{
+		//Nothing to compare with until a baseline has been recorded on the reference machine
+		if (!options.record)
+		{
+			throw std::runtime_error("No baseline at " + options.baselineFile + ", record one with --regress --record first");
+		}
+		return;
+	}
+
+	baseline = JsonValue::parseFile(options.baselineFile);
+
+	const JsonValue* tolerance = baseline.find("tolerance");
+	if (tolerance != nullptr)
+	{
+		defaultTolerance = tolerance->asNumber(defaultTolerance);
+	}
+	const JsonValue* perMetric = baseline.find("metricTolerance");
+	if (perMetric != nullptr)
+	{
+		for (const auto& member : perMetric->getMembers())
+		{
+			metricTolerance[member.first] = member.second.asNumber(defaultTolerance);
+		}
+	}
+
+	//Command line wins over everything in the file
+	if (options.tolerance >= 0.0)
+	{
+		defaultTolerance = options.tolerance;
+		metricTolerance.clear();
+	}
+}
+
+RegressionMetrics RegressionRunner::collectMetrics(const BenchmarkResult& result)
+{
+	RegressionMetrics metrics;
+	metrics.values["loadMs"] = result.loadMs;
+	metrics.values["cpuFrameP50"] = result.cpuFrame.p50;
+	metrics.values["cpuFrameP95"] = result.cpuFrame.p95;
+	metrics.values["cpuSubmitP50"] = result.cpuSubmit.p50;
+	metrics.values["gpuFrameP50"] = result.gpuFrame.p50;
+	metrics.values["gpuFrameP95"] = result.gpuFrame.p95;
+	metrics.values["devicePeakMB"] = result.deviceMemory.peakBytes / (1024.0 * 1024.0);
+	return metrics;
+}
+
+bool RegressionRunner::runScene(const BenchmarkScene& scene, std::string* deviceName)
+{
+	printf("\n== %s ==\n", scene.name.c_str());
+
+	//Fresh renderer per scene so memory and load times don't depend on the previous scene
+	VulkanRender* renderer = new VulkanRender();
+	MemoryStats::resetPeak();
+	if (renderer->init(nullptr, options.settings) == EXIT_FAILURE)
+	{
+		delete renderer;
+		return false;
+	}
+	*deviceName = renderer->getDeviceName();
+
+	Benchmark benchmark(renderer, nullptr, options.benchmark);
+	bool rendered = benchmark.run(scene) == EXIT_SUCCESS;
+
+	//One more frame of the final scene state, read back for the image check
+	std::vector<uint8_t> pixels;
+	uint32_t width = 0, height = 0;
+	if (rendered)
+	{
+		renderer->setFrameReadbackCallback([&](const ReadbackFrame& frame)
+		{
+			width = frame.width;
+			height = frame.height;
+			pixels.resize(static_cast<size_t>(frame.width) * frame.height * 4);
+			for (uint32_t y = 0; y < frame.height; y++)
+			{
+				memcpy(pixels.data() + static_cast<size_t>(y) * frame.width * 4, frame.pixels + static_cast<size_t>(y) * frame.rowPitch, frame.width * 4);
+			}
+		});
+		renderer->draw();
+		renderer->flushFrames();
+		renderer->setFrameReadbackCallback(nullptr);
+	}
+
+	renderer->cleanup();
+	delete renderer;
+
+	if (!rendered || pixels.empty())
+	{
+		printf("FAILED: scene did not render\n");
+		return false;
+	}
+
+	RegressionMetrics metrics = collectMetrics(benchmark.getResult());
+	sceneMetrics.emplace_back(scene.name, metrics);
+
+	std::string imageFile = options.outputDirectory + "/" + scene.name + ".png";
+	std::string goldenFile = options.goldenDirectory + "/" + scene.name + ".png";
+	ImageWriter::writePng(imageFile, width, height, pixels.data(), width * 4);
+
+	if (options.record)
+	{
+		if (!ImageWriter::writePng(goldenFile, width, height, pixels.data(), width * 4))
+		{
+			printf("FAILED: could not write golden image %s\n", goldenFile.c_str());
+			return false;
+		}
+		printf("Recorded %s\n", goldenFile.c_str());
+		return true;
+	}
+
+	bool passed = compareMetrics(scene.name, metrics);
+
+	ImageComparison image = compareImage(imageFile, goldenFile);
+	if (!image.hasGolden)
+	{
+		printf("  image: no golden image at %s (run with --record)             FAILED\n", goldenFile.c_str());
+		passed = false;
+	}
+	else if (!image.sizeMatches)
+	{
+		printf("  image: size differs from golden image                               FAILED\n");
+		passed = false;
+	}
+	else
+	{
+		bool imagePassed = image.changedFraction <= options.maxChangedPixels;
+		printf("  image: %.4f%% of pixels changed (max channel difference %u, allowed %.4f%%)   %s\n",
+			image.changedFraction * 100.0, image.maxChannelDifference, options.maxChangedPixels * 100.0, imagePassed ? "ok" : "FAILED");
+		if (!imagePassed)
+		{
+			printf("         compare %s with %s\n", imageFile.c_str(), goldenFile.c_str());
+		}
+		passed = passed && imagePassed;
+	}
+
+	return passed;
+}
+
+bool RegressionRunner::compareMetrics(const std::string& sceneName, const RegressionMetrics& metrics)
+{
+	const JsonValue* scenes = baseline.find("scenes");
+	const JsonValue* sceneBaseline = scenes != nullptr ? scenes->find(sceneName) : nullptr;
+	if (sceneBaseline == nullptr)
+	{
+		printf("  no baseline for this scene (run with --record)                      FAILED\n");
+		return false;
+	}
+
+	//A metric the baseline doesn't know yet can't be checked, so it fails like a missing scene
+	bool passed = true;
+	printf("  %-14s %12s %12s %9s %9s\n", "metric", "baseline", "current", "change", "allowed");
+	for (const auto& metric : metrics.values)
+	{
+		const JsonValue* baselineValue = sceneBaseline->find(metric.first);
+		if (baselineValue == nullptr || baselineValue->getType() != JsonValue::Number)
+		{
+			printf("  %-14s %12s %12.3f %9s %9s   FAILED\n", metric.first.c_str(), "-", metric.second, "-", "-");
+			passed = false;
+			continue;
+		}
+
+		double tolerance = metricTolerance.count(metric.first) ? metricTolerance[metric.first] : defaultTolerance;
+		double before = baselineValue->asNumber();
+		double change = before > 0.0 ? (metric.second - before) / before : 0.0;
+		bool regressed = change > tolerance;
+		passed = passed && !regressed;
+
+		printf("  %-14s %12.3f %12.3f %+8.1f%% %8.1f%%   %s\n", metric.first.c_str(), before, metric.second, change * 100.0,
+			tolerance * 100.0, regressed ? "REGRESSED" : (change < -tolerance ? "improved" : "ok"));
+	}
+
+	return passed;
+}
+
+ImageComparison RegressionRunner::compareImage(const std::string& imageFile, const std::string& goldenFile)
+{
+	ImageComparison comparison;
+
+	int goldenWidth, goldenHeight, goldenChannels;
+	stbi_uc* golden = stbi_load(goldenFile.c_str(), &goldenWidth, &goldenHeight, &goldenChannels, STBI_rgb_alpha);
+	if (!golden)
+	{
+		return comparison;
+	}
+	comparison.hasGolden = true;
+
+	int width, height, channels;
+	stbi_uc* image = stbi_load(imageFile.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (image && width == goldenWidth && height == goldenHeight)
+	{
+		comparison.sizeMatches = true;
+
+		//Drivers may round differently, so small differences per channel are ignored
+		size_t pixelCount = static_cast<size_t>(width) * height;
+		size_t changedPixels = 0;
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			uint32_t pixelDifference = 0;
+			for (size_t c = 0; c < 4; c++)
+			{
+				uint32_t difference = static_cast<uint32_t>(std::abs(static_cast<int>(image[i * 4 + c]) - static_cast<int>(golden[i * 4 + c])));
+				pixelDifference = std::max(pixelDifference, difference);
+			}
+			comparison.maxChannelDifference = std::max(comparison.maxChannelDifference, pixelDifference);
+			if (pixelDifference > options.pixelThreshold)
+			{
+				changedPixels++;
+			}
+		}
+		comparison.changedFraction = pixelCount > 0 ? static_cast<double>(changedPixels) / pixelCount : 0.0;
+	}
+
+	stbi_image_free(image);
+	stbi_image_free(golden);
+	return comparison;
+}
+
+bool RegressionRunner::writeBaseline(const std::string& deviceName)
+{
+	std::ofstream file(options.baselineFile, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("ERROR: Failed to open baseline %s \n", options.baselineFile.c_str());
+		return false;
+	}
+
+	//Tolerances of the existing file are kept, only the measured values are replaced
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "\t\"device\": \"" << jsonEscape(deviceName) << "\",\n";
+	file << "\t\"warmupFrames\": " << options.benchmark.warmupFrames << ",\n";
+	file << "\t\"measuredFrames\": " << options.benchmark.measuredFrames << ",\n";
+	file << "\t\"tolerance\": " << defaultTolerance << ",\n";
+	file << "\t\"metricTolerance\": {";
+	size_t index = 0;
+	for (const auto& tolerance : metricTolerance)
+	{
+		file << (index++ > 0 ? ", " : " ") << "\"" << tolerance.first << "\": " << tolerance.second;
+	}
+	file << (metricTolerance.empty() ? "},\n" : " },\n");
+	file << "\t\"scenes\": {\n";
+	for (size_t i = 0; i < sceneMetrics.size(); i++)
+	{
+		file << "\t\t\"" << jsonEscape(sceneMetrics[i].first) << "\": {";
+		size_t metricIndex = 0;
+		for (const auto& metric : sceneMetrics[i].second.values)
+		{
+			file << (metricIndex++ > 0 ? ", " : " ") << "\"" << metric.first << "\": " << metric.second;
+		}
+		file << " }" << (i + 1 < sceneMetrics.size() ? ",\n" : "\n");
+	}
+	file << "\t}\n";
+	file << "}\n";
+	file.close();
+
+	printf("Baseline of %zu scenes written to %s\n", sceneMetrics.size(), options.baselineFile.c_str());
+	return true;
+}
+
+RegressionRunner::~RegressionRunner()
+{
+}
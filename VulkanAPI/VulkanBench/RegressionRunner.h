@@ -0,0 +1,67 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<map>
+#include "Benchmark.h"
+#include "JsonValue.h"
+
+//Command line selected regression run
+struct RegressionOptions
+{
+	std::string baselineFile = "../VulkanBench/baselines/baseline.json";        //Relative to the asset directory
+	std::string goldenDirectory = "../VulkanBench/baselines/golden";
+	std::string outputDirectory = "regression_output";                          //Images of this run
+	bool record = false;                    //Overwrite baseline and golden images with this run
+	double tolerance = -1.0;                //Allowed relative slowdown, < 0 uses the baseline file's value
+	uint32_t pixelThreshold = 8;            //Channel difference a pixel may have before it counts as changed
+	double maxChangedPixels = 0.001;        //Fraction of changed pixels allowed before the image fails
+	RenderSettings settings;
+	BenchmarkOptions benchmark;
+};
+
+//Metrics compared against the baseline, all lower-is-better
+struct RegressionMetrics
+{
+	std::map<std::string, double> values;
+};
+
+//Outcome of one rendered image against its golden image
+struct ImageComparison
+{
+	bool hasGolden = false;
+	bool sizeMatches = false;
+	double changedFraction = 0.0;
+	uint32_t maxChannelDifference = 0;
+};
+
+//Renders a fixed set of headless scenes and compares frame time, load time, memory and the image with stored baselines
+class RegressionRunner
+{
+public:
+	RegressionRunner(RegressionOptions newOptions);
+
+	static std::vector<BenchmarkScene> getScenes();
+
+	//Returns EXIT_SUCCESS when nothing regressed (or when recording)
+	int run();
+
+	~RegressionRunner();
+
+private:
+	RegressionOptions options;
+
+	JsonValue baseline;
+	double defaultTolerance = 0.10;
+	std::map<std::string, double> metricTolerance = { { "cpuFrameP95", 0.20 }, { "gpuFrameP95", 0.20 }, { "loadMs", 0.25 } };      //Per metric overrides, the baseline file may replace them
+
+	std::vector<std::pair<std::string, RegressionMetrics>> sceneMetrics;        //In run order, for recording
+
+	void loadBaseline();
+	bool runScene(const BenchmarkScene& scene, std::string* deviceName);
+	bool compareMetrics(const std::string& sceneName, const RegressionMetrics& metrics);
+	ImageComparison compareImage(const std::string& imageFile, const std::string& goldenFile);
+	bool writeBaseline(const std::string& deviceName);
+
+	static RegressionMetrics collectMetrics(const BenchmarkResult& result);
+};